@@ -1,37 +1,12 @@
 #include "asm_emitter.h"
 #include "glib.h"
+#include "x86_encoder.h"
 #include <assert.h>
+#include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
-
-static const char *REGISTER_NAMES[] = {
-	"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8",
-	"r9",  "r10", "r11", "r12", "r13", "r14", "r15", "xmm0"};
-
-const char *reg_to_string(enum Register reg)
-{
-	assert(reg < REG_COUNT && "Invalid register enum value.");
-	return REGISTER_NAMES[reg];
-}
-
-static void format_and_emit_text(AsmFileWriter *writer,
-								 const char *instruction,
-								 const char *comment_fmt,
-								 va_list args)
-{
-	if (comment_fmt)
-	{
-		char comment_buffer[256];
-		vsnprintf(comment_buffer, sizeof(comment_buffer), comment_fmt,
-				  args);
-		asm_file_writer_write_text(writer, "%s ; %s", instruction,
-								   comment_buffer);
-	}
-	else
-	{
-		asm_file_writer_write_text(writer, "%s", instruction);
-	}
-}
+#include <stdlib.h>
+#include <string.h>
 
 static void format_and_emit_data(AsmFileWriter *writer,
 								 const char *instruction,
@@ -54,8 +29,7 @@ static void format_and_emit_data(AsmFileWriter *writer,
 
 #define INSTRUCTION_BUFFER_SIZE 128
 
-// I know they say 'don't be clever' but I ain't writing all that
-#define IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, instr_fmt, ...)  \
+#define IMPLEMENT_DATA_EMITTER(writer, comment_fmt, instr_fmt, ...)  \
 	do                                                               \
 	{                                                                \
 		char instruction_buffer[INSTRUCTION_BUFFER_SIZE];            \
@@ -64,23 +38,164 @@ static void format_and_emit_data(AsmFileWriter *writer,
                                                                      \
 		va_list comment_args;                                        \
 		va_start(comment_args, comment_fmt);                         \
-		format_and_emit_text(writer, instruction_buffer,             \
+		/* Pass the data file stream */                              \
+		format_and_emit_data(writer, instruction_buffer,             \
 							 comment_fmt, comment_args);             \
 		va_end(comment_args);                                        \
 	} while (0)
 
-#define IMPLEMENT_DATA_EMITTER(writer, comment_fmt, instr_fmt, ...)  \
+// Object writers get the encoded data instead of its text.
+#define ENCODE_IN_OBJECT(writer, encoder, ...)                       \
+	do                                                               \
+	{                                                                \
+		if ((writer)->object)                                        \
+		{                                                            \
+			encoder((writer)->object, ##__VA_ARGS__);                \
+			return;                                                  \
+		}                                                            \
+	} while (0)
+
+// A label operand as the emitters take it: a number, a name, or
+// "name + offset".
+typedef struct
+{
+	char *name; // NULL for a plain number
+	int64_t value;
+} SymbolicOperand;
+
+static SymbolicOperand parse_operand(const char *operand)
+{
+	SymbolicOperand parsed = {0};
+	const char *end = operand;
+	if (*operand == '-' || isdigit((unsigned char)*operand))
+	{
+		parsed.value = strtoll(operand, (char **)&end, 0);
+		assert(*end == '\0' && "Malformed numeric operand");
+		return parsed;
+	}
+	end = operand + strcspn(operand, " +");
+	parsed.name = g_strndup(operand, end - operand);
+	end += strspn(end, " ");
+	if (*end == '+')
+	{
+		parsed.value = strtoll(end + 1, NULL, 0);
+	}
+	return parsed;
+}
+
+// Appends one quadword, a number or a label's address, to the
+// current data section.
+static void object_data_quad(ObjectFile *obj, const char *operand)
+{
+	SymbolicOperand parsed = parse_operand(operand);
+	if (parsed.name)
+	{
+		object_file_append_reloc(obj, obj->data_section,
+								 OBJECT_RELOC_ABS64, parsed.name,
+								 parsed.value);
+	}
+	else
+	{
+		object_file_append(obj, obj->data_section, &parsed.value,
+						   sizeof(parsed.value));
+	}
+	g_free(parsed.name);
+}
+
+// Defines label in the current data section and appends len bytes
+// after it.
+static void object_data_define(ObjectFile *obj,
+						   const char *label,
+						   const void *bytes,
+						   size_t len)
+{
+	object_file_define(obj, obj->data_section, label);
+	object_file_append(obj, obj->data_section, bytes, len);
+}
+
+static const AsmOperand NO_OPERAND = {ASM_OPERAND_NONE};
+
+static AsmOperand reg_operand(enum Register reg)
+{
+	return (AsmOperand){.kind = ASM_OPERAND_REG, .reg = reg};
+}
+
+static AsmOperand imm_operand(int64_t value)
+{
+	return (AsmOperand){.kind = ASM_OPERAND_IMM, .value = value};
+}
+
+static AsmOperand membase_operand(enum Register base, int offset)
+{
+	return (AsmOperand){
+		.kind = ASM_OPERAND_MEMBASE, .reg = base, .value = offset};
+}
+
+// A label, "label + offset", or a plain number, which becomes an
+// immediate. Names are interned in the writer.
+static AsmOperand label_operand(AsmFileWriter *writer,
+								const char *label)
+{
+	AsmOperand operand = {.kind = ASM_OPERAND_LABEL};
+	if (!strchr(label, '+') && !isdigit((unsigned char)*label) &&
+		*label != '-')
+	{
+		operand.label =
+			g_string_chunk_insert_const(writer->strings, label);
+		return operand;
+	}
+	SymbolicOperand parsed = parse_operand(label);
+	if (!parsed.name)
+	{
+		return imm_operand(parsed.value);
+	}
+	operand.value = parsed.value;
+	operand.label =
+		g_string_chunk_insert_const(writer->strings, parsed.name);
+	g_free(parsed.name);
+	return operand;
+}
+
+// [label] or [label + offset]
+static AsmOperand mem_label_operand(AsmFileWriter *writer,
+									const char *label)
+{
+	AsmOperand operand = label_operand(writer, label);
+	assert(operand.kind == ASM_OPERAND_LABEL &&
+		   "Memory operand needs a label");
+	operand.kind = ASM_OPERAND_MEM_LABEL;
+	return operand;
+}
+
+// Records one instruction. Comments only matter to the text output,
+// so object writers never format them.
+static void append_instruction(AsmFileWriter *writer,
+							   AsmOpcode opcode,
+							   AsmOperand dest,
+							   AsmOperand src,
+							   const char *comment_fmt,
+							   va_list args)
+{
+	AsmInstr instr = {
+		.opcode = opcode, .dest = dest, .src = src, .comment = NULL};
+	if (comment_fmt && *comment_fmt && !writer->object)
+	{
+		char comment_buffer[256];
+		vsnprintf(comment_buffer, sizeof(comment_buffer), comment_fmt,
+				  args);
+		instr.comment =
+			g_string_chunk_insert(writer->strings, comment_buffer);
+	}
+	asm_file_writer_append(writer, &instr);
+}
+
+#define EMIT_INSTRUCTION(writer, comment_fmt, opcode, dest, src)     \
 	do                                                               \
 	{                                                                \
-		char instruction_buffer[INSTRUCTION_BUFFER_SIZE];            \
-		snprintf(instruction_buffer, sizeof(instruction_buffer),     \
-				 instr_fmt, ##__VA_ARGS__);                          \
-                                                                     \
 		va_list comment_args;                                        \
 		va_start(comment_args, comment_fmt);                         \
-		/* Pass the data file stream */                              \
-		format_and_emit_data(writer, instruction_buffer,             \
-							 comment_fmt, comment_args);             \
+		append_instruction(writer, opcode, dest, src, comment_fmt,   \
+						   comment_args);                            \
 		va_end(comment_args);                                        \
 	} while (0)
 
@@ -89,8 +204,8 @@ void emit_push_reg(AsmFileWriter *writer,
 				   const char *comment_fmt,
 				   ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "push %s",
-						   reg_to_string(reg));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_PUSH, reg_operand(reg),
+					 NO_OPERAND);
 }
 
 void emit_push_imm(AsmFileWriter *writer,
@@ -98,7 +213,9 @@ void emit_push_imm(AsmFileWriter *writer,
 				   const char *comment_fmt,
 				   ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "push %lld", imm);
+	assert(imm == (int32_t)imm && "push takes a 32-bit immediate");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_PUSH, imm_operand(imm),
+					 NO_OPERAND);
 }
 
 void emit_push_global(AsmFileWriter *writer,
@@ -106,9 +223,8 @@ void emit_push_global(AsmFileWriter *writer,
 					  const char *comment_fmt,
 					  ...)
 {
-	// "qword" is specified to remove size ambiguity for the assembler
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "push qword [%s]",
-						   label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_PUSH,
+					 mem_label_operand(writer, label), NO_OPERAND);
 }
 
 void emit_pop_reg(AsmFileWriter *writer,
@@ -116,8 +232,8 @@ void emit_pop_reg(AsmFileWriter *writer,
 				  const char *comment_fmt,
 				  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "pop %s",
-						   reg_to_string(reg));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_POP, reg_operand(reg),
+					 NO_OPERAND);
 }
 
 void emit_mov_reg_reg(AsmFileWriter *writer,
@@ -126,8 +242,8 @@ void emit_mov_reg_reg(AsmFileWriter *writer,
 					  const char *comment_fmt,
 					  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov %s, %s",
-						   reg_to_string(dest), reg_to_string(src));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV, reg_operand(dest),
+					 reg_operand(src));
 }
 
 void emit_mov_reg_imm(AsmFileWriter *writer,
@@ -136,8 +252,8 @@ void emit_mov_reg_imm(AsmFileWriter *writer,
 					  const char *comment_fmt,
 					  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov %s, %lld",
-						   reg_to_string(dest), immediate);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV, reg_operand(dest),
+					 imm_operand(immediate));
 }
 
 void emit_mov_reg_global(AsmFileWriter *writer,
@@ -146,8 +262,8 @@ void emit_mov_reg_global(AsmFileWriter *writer,
 						 const char *comment_fmt,
 						 ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov %s, [%s]",
-						   reg_to_string(dest), label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV, reg_operand(dest),
+					 mem_label_operand(writer, label));
 }
 
 void emit_mov_reg_label(AsmFileWriter *writer,
@@ -156,8 +272,8 @@ void emit_mov_reg_label(AsmFileWriter *writer,
 						const char *comment_fmt,
 						...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov %s, %s",
-						   reg_to_string(dest), label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV, reg_operand(dest),
+					 label_operand(writer, label));
 }
 
 void emit_mov_global_reg(AsmFileWriter *writer,
@@ -166,8 +282,9 @@ void emit_mov_global_reg(AsmFileWriter *writer,
 						 const char *comment_fmt,
 						 ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov [%s], %s", label,
-						   reg_to_string(src));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV,
+					 mem_label_operand(writer, label),
+					 reg_operand(src));
 }
 
 void emit_mov_reg_membase(AsmFileWriter *writer,
@@ -177,9 +294,8 @@ void emit_mov_reg_membase(AsmFileWriter *writer,
 						  const char *comment_fmt,
 						  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov %s, [%s + %d]",
-						   reg_to_string(dest), reg_to_string(base),
-						   offset);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV, reg_operand(dest),
+					 membase_operand(base, offset));
 }
 
 void emit_mov_membase_reg(AsmFileWriter *writer,
@@ -189,10 +305,20 @@ void emit_mov_membase_reg(AsmFileWriter *writer,
 						  const char *comment_fmt,
 						  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "mov [%s + %d], %s",
-						   reg_to_string(base), offset,
-						   reg_to_string(src));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOV,
+					 membase_operand(base, offset), reg_operand(src));
+}
+void emit_lea_reg_membase(AsmFileWriter *writer,
+						  enum Register dest,
+						  enum Register base,
+						  int offset,
+						  const char *comment_fmt,
+						  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_LEA, reg_operand(dest),
+					 membase_operand(base, offset));
 }
+
 void emit_movsd_reg_global(AsmFileWriter *writer,
 						   enum Register dest,
 						   const char *label,
@@ -202,8 +328,9 @@ void emit_movsd_reg_global(AsmFileWriter *writer,
 	// You could add an assert here to ensure dest is an XMM register
 	assert(dest >= REG_XMM0 &&
 		   "Destination for movsd must be an XMM register");
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "movsd %s, [%s]",
-						   reg_to_string(dest), label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOVSD,
+					 reg_operand(dest),
+					 mem_label_operand(writer, label));
 }
 
 void emit_movsd_membase_reg(AsmFileWriter *writer,
@@ -215,9 +342,82 @@ void emit_movsd_membase_reg(AsmFileWriter *writer,
 {
 	assert(src >= REG_XMM0 &&
 		   "Source for movsd must be an XMM register");
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "movsd [%s + %d], %s",
-						   reg_to_string(base), offset,
-						   reg_to_string(src));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOVSD,
+					 membase_operand(base, offset), reg_operand(src));
+}
+
+void emit_movsd_reg_membase(AsmFileWriter *writer,
+							enum Register dest,
+							enum Register base,
+							int offset,
+							const char *comment_fmt,
+							...)
+{
+	assert(dest >= REG_XMM0 &&
+		   "Destination for movsd must be an XMM register");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MOVSD,
+					 reg_operand(dest),
+					 membase_operand(base, offset));
+}
+
+void emit_addsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...)
+{
+	assert(dest >= REG_XMM0 && src >= REG_XMM0 &&
+		   "addsd operates on XMM registers");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_ADDSD,
+					 reg_operand(dest), reg_operand(src));
+}
+
+void emit_subsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...)
+{
+	assert(dest >= REG_XMM0 && src >= REG_XMM0 &&
+		   "subsd operates on XMM registers");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_SUBSD,
+					 reg_operand(dest), reg_operand(src));
+}
+
+void emit_divsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...)
+{
+	assert(dest >= REG_XMM0 && src >= REG_XMM0 &&
+		   "divsd operates on XMM registers");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_DIVSD,
+					 reg_operand(dest), reg_operand(src));
+}
+
+void emit_mulsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...)
+{
+	assert(dest >= REG_XMM0 && src >= REG_XMM0 &&
+		   "mulsd operates on XMM registers");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_MULSD,
+					 reg_operand(dest), reg_operand(src));
+}
+
+void emit_cvtsi2sd_reg_reg(AsmFileWriter *writer,
+						   enum Register dest,
+						   enum Register src,
+						   const char *comment_fmt,
+						   ...)
+{
+	assert(dest >= REG_XMM0 && src < REG_XMM0 &&
+		   "cvtsi2sd converts a general register into an XMM one");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_CVTSI2SD,
+					 reg_operand(dest), reg_operand(src));
 }
 
 void emit_call_reg(AsmFileWriter *writer,
@@ -225,8 +425,8 @@ void emit_call_reg(AsmFileWriter *writer,
 				   const char *comment_fmt,
 				   ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "call %s",
-						   reg_to_string(target));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_CALL,
+					 reg_operand(target), NO_OPERAND);
 }
 
 void emit_call_label(AsmFileWriter *writer,
@@ -234,7 +434,8 @@ void emit_call_label(AsmFileWriter *writer,
 					 const char *comment_fmt,
 					 ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "call %s", label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_CALL,
+					 label_operand(writer, label), NO_OPERAND);
 }
 
 void emit_add_rsp(AsmFileWriter *writer,
@@ -242,7 +443,8 @@ void emit_add_rsp(AsmFileWriter *writer,
 				  const char *comment_fmt,
 				  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "add rsp, %d", value);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_ADD,
+					 reg_operand(REG_RSP), imm_operand(value));
 }
 
 void emit_sub_rsp(AsmFileWriter *writer,
@@ -250,7 +452,8 @@ void emit_sub_rsp(AsmFileWriter *writer,
 				  const char *comment_fmt,
 				  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "sub rsp, %d", value);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_SUB,
+					 reg_operand(REG_RSP), imm_operand(value));
 }
 
 void emit_global(AsmFileWriter *writer,
@@ -258,7 +461,8 @@ void emit_global(AsmFileWriter *writer,
 				 const char *comment_fmt,
 				 ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "global %s", label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_GLOBAL,
+					 label_operand(writer, label), NO_OPERAND);
 }
 
 void emit_extern(AsmFileWriter *writer,
@@ -266,7 +470,8 @@ void emit_extern(AsmFileWriter *writer,
 				 const char *comment_fmt,
 				 ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "extern %s", label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_EXTERN,
+					 label_operand(writer, label), NO_OPERAND);
 }
 
 void emit_label(AsmFileWriter *writer,
@@ -274,15 +479,21 @@ void emit_label(AsmFileWriter *writer,
 				const char *comment_fmt,
 				...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "%s:", label);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_LABEL,
+					 label_operand(writer, label), NO_OPERAND);
 }
 
+// Every jump takes a label.
+#define IMPLEMENT_JUMP_EMITTER(opcode)                               \
+	EMIT_INSTRUCTION(writer, comment_fmt, opcode,                    \
+					 label_operand(writer, label), NO_OPERAND)
+
 void emit_jmp(AsmFileWriter *writer,
 			  const char *label,
 			  const char *comment_fmt,
 			  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "jmp %s", label);
+	IMPLEMENT_JUMP_EMITTER(ASM_JMP);
 }
 
 void emit_je(AsmFileWriter *writer,
@@ -290,17 +501,95 @@ void emit_je(AsmFileWriter *writer,
 			 const char *comment_fmt,
 			 ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "je %s", label);
+	IMPLEMENT_JUMP_EMITTER(ASM_JE);
+}
+
+void emit_jne(AsmFileWriter *writer,
+			  const char *label,
+			  const char *comment_fmt,
+			  ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JNE);
+}
+
+void emit_ja(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JA);
+}
+
+void emit_jl(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JL);
+}
+
+void emit_jle(AsmFileWriter *writer,
+			  const char *label,
+			  const char *comment_fmt,
+			  ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JLE);
+}
+
+void emit_jg(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JG);
+}
+
+void emit_jge(AsmFileWriter *writer,
+			  const char *label,
+			  const char *comment_fmt,
+			  ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JGE);
+}
+
+void emit_jo(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...)
+{
+	IMPLEMENT_JUMP_EMITTER(ASM_JO);
+}
+
+void emit_jmp_membase(AsmFileWriter *writer,
+					  enum Register base,
+					  int offset,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_JMP,
+					 membase_operand(base, offset), NO_OPERAND);
 }
 
 void emit_ret(AsmFileWriter *writer, const char *comment_fmt, ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "ret");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_RET, NO_OPERAND,
+					 NO_OPERAND);
 }
 
 void emit_syscall(AsmFileWriter *writer, const char *comment_fmt, ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "syscall");
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_SYSCALL, NO_OPERAND,
+					 NO_OPERAND);
+}
+
+void emit_cmp_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_CMP, reg_operand(dest),
+					 reg_operand(src));
 }
 
 void emit_cmp_reg_imm(AsmFileWriter *writer,
@@ -309,8 +598,19 @@ void emit_cmp_reg_imm(AsmFileWriter *writer,
 					  const char *comment_fmt,
 					  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "cmp %s, %d",
-						   reg_to_string(reg), imm);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_CMP, reg_operand(reg),
+					 imm_operand(imm));
+}
+
+void emit_cmp_reg_membase(AsmFileWriter *writer,
+						  enum Register reg,
+						  enum Register base,
+						  int offset,
+						  const char *comment_fmt,
+						  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_CMP, reg_operand(reg),
+					 membase_operand(base, offset));
 }
 
 void emit_xor_reg_reg(AsmFileWriter *writer,
@@ -319,23 +619,108 @@ void emit_xor_reg_reg(AsmFileWriter *writer,
 					  const char *comment_fmt,
 					  ...)
 {
-	IMPLEMENT_TEXT_EMITTER(writer, comment_fmt, "xor %s, %s",
-						   reg_to_string(dest), reg_to_string(src));
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_XOR, reg_operand(dest),
+					 reg_operand(src));
+}
+
+void emit_add_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_ADD, reg_operand(dest),
+					 reg_operand(src));
+}
+
+void emit_sub_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_SUB, reg_operand(dest),
+					 reg_operand(src));
+}
+
+void emit_imul_reg_reg(AsmFileWriter *writer,
+					   enum Register dest,
+					   enum Register src,
+					   const char *comment_fmt,
+					   ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_IMUL, reg_operand(dest),
+					 reg_operand(src));
+}
+
+void emit_and_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_AND, reg_operand(dest),
+					 reg_operand(src));
+}
+
+void emit_add_reg_imm(AsmFileWriter *writer,
+					  enum Register reg,
+					  int32_t imm,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_ADD, reg_operand(reg),
+					 imm_operand(imm));
+}
+
+void emit_sub_reg_imm(AsmFileWriter *writer,
+					  enum Register reg,
+					  int32_t imm,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_SUB, reg_operand(reg),
+					 imm_operand(imm));
+}
+
+void emit_or_reg_imm(AsmFileWriter *writer,
+					 enum Register reg,
+					 int32_t imm,
+					 const char *comment_fmt,
+					 ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_OR, reg_operand(reg),
+					 imm_operand(imm));
+}
+
+void emit_sar_reg_imm(AsmFileWriter *writer,
+					  enum Register reg,
+					  int32_t imm,
+					  const char *comment_fmt,
+					  ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_SAR, reg_operand(reg),
+					 imm_operand(imm));
+}
+
+void emit_test_reg_imm(AsmFileWriter *writer,
+					   enum Register reg,
+					   int32_t imm,
+					   const char *comment_fmt,
+					   ...)
+{
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_TEST, reg_operand(reg),
+					 imm_operand(imm));
 }
 
 void emit_comment(AsmFileWriter *writer, const char *comment_fmt, ...)
 {
-	if (!comment_fmt)
+	if (!comment_fmt || !*comment_fmt || writer->object)
 	{
 		return;
 	}
-	char comment_buffer[INSTRUCTION_BUFFER_SIZE * 2];
-	va_list args;
-	va_start(args, comment_fmt);
-	vsnprintf(comment_buffer, sizeof(comment_buffer), comment_fmt,
-			  args);
-	va_end(args);
-	asm_file_writer_write_text(writer, "; %s", comment_buffer);
+	EMIT_INSTRUCTION(writer, comment_fmt, ASM_COMMENT, NO_OPERAND,
+					 NO_OPERAND);
 }
 
 void emit_data_label(AsmFileWriter *writer,
@@ -343,6 +728,8 @@ void emit_data_label(AsmFileWriter *writer,
 					 const char *comment_fmt,
 					 ...)
 {
+	ENCODE_IN_OBJECT(writer, object_file_define,
+					 writer->object->data_section, label);
 	IMPLEMENT_DATA_EMITTER(writer, comment_fmt, "%s:", label);
 }
 
@@ -352,6 +739,8 @@ void emit_data_dq_imm(AsmFileWriter *writer,
 					  const char *comment_fmt,
 					  ...)
 {
+	ENCODE_IN_OBJECT(writer, object_data_define, label, &value,
+					 sizeof(value));
 	IMPLEMENT_DATA_EMITTER(writer, comment_fmt, "%s: dq %lld", label,
 						   value);
 }
@@ -362,16 +751,113 @@ void emit_data_dq_float(AsmFileWriter *writer,
 						const char *comment_fmt,
 						...)
 {
+	ENCODE_IN_OBJECT(writer, object_data_define, label, &value,
+					 sizeof(value));
 	IMPLEMENT_DATA_EMITTER(writer, comment_fmt, "%s: dq %f", label,
 						   value);
 }
 
+void emit_data_dq_imms(AsmFileWriter *writer,
+					   const char *label,
+					   const int64_t *values,
+					   int num_values,
+					   const char *comment_fmt,
+					   ...)
+{
+	assert(num_values > 0);
+	ENCODE_IN_OBJECT(writer, object_data_define, label, values,
+					 num_values * sizeof(*values));
+	GString *instruction = g_string_new(NULL);
+	g_string_append_printf(instruction, "%s:", label);
+
+	for (int i = 0; i < num_values; ++i)
+	{
+		g_string_append_printf(instruction, "%s%lld",
+							   i == 0 ? " dq " : ", ",
+							   (long long)values[i]);
+	}
+
+	va_list comment_args;
+	va_start(comment_args, comment_fmt);
+	format_and_emit_data(writer, instruction->str, comment_fmt,
+						 comment_args);
+	va_end(comment_args);
+
+	g_string_free(instruction, TRUE);
+}
+
+void emit_data_section(AsmFileWriter *writer,
+					   const char *section,
+					   const char *comment_fmt,
+					   ...)
+{
+	if (writer->object)
+	{
+		bool rodata = strcmp(section, ".rodata") == 0;
+		assert((rodata || strcmp(section, ".data") == 0) &&
+			   "Only .data and .rodata hold data");
+		writer->object->data_section =
+			rodata ? OBJECT_SECTION_RODATA : OBJECT_SECTION_DATA;
+		return;
+	}
+	IMPLEMENT_DATA_EMITTER(writer, comment_fmt, "section %s",
+						   section);
+}
+
+void emit_data_align(AsmFileWriter *writer,
+					 int alignment,
+					 const char *comment_fmt,
+					 ...)
+{
+	ENCODE_IN_OBJECT(writer, object_file_align,
+					 writer->object->data_section, alignment);
+	IMPLEMENT_DATA_EMITTER(writer, comment_fmt, "align %d",
+						   alignment);
+}
+
+void emit_data_dq_labels(AsmFileWriter *writer,
+						 const char *label,
+						 const char **value_labels,
+						 int num_values,
+						 const char *comment_fmt,
+						 ...)
+{
+	if (writer->object)
+	{
+		ObjectFile *obj = writer->object;
+		object_file_define(obj, obj->data_section, label);
+		for (int i = 0; i < num_values; ++i)
+		{
+			object_data_quad(obj, value_labels[i]);
+		}
+		return;
+	}
+	GString *instruction = g_string_new(NULL);
+	g_string_append_printf(instruction, "%s:", label);
+
+	for (int i = 0; i < num_values; ++i)
+	{
+		g_string_append(instruction, i == 0 ? " dq " : ", ");
+		g_string_append(instruction, value_labels[i]);
+	}
+
+	va_list comment_args;
+	va_start(comment_args, comment_fmt);
+	format_and_emit_data(writer, instruction->str, comment_fmt,
+						 comment_args);
+	va_end(comment_args);
+
+	g_string_free(instruction, TRUE);
+}
+
 void emit_data_string(AsmFileWriter *writer,
 					  const char *label,
 					  const char *str_value,
 					  const char *comment_fmt,
 					  ...)
 {
+	ENCODE_IN_OBJECT(writer, object_data_define, label, str_value,
+					 strlen(str_value) + 1);
 	GString *instruction = g_string_new(NULL);
 	g_string_append_printf(instruction, "%s: db ", label);
 
@@ -3,33 +3,6 @@
 #include "asm_file_writer.h"
 #include <stdint.h>
 
-enum Register
-{
-	REG_RAX,
-	REG_RCX,
-	REG_RDX,
-	REG_RBX,
-	REG_RSP,
-	REG_RBP,
-	REG_RSI,
-	REG_RDI,
-	REG_R8,
-	REG_R9,
-	REG_R10,
-	REG_R11,
-	REG_R12,
-	REG_R13,
-	REG_R14,
-	REG_R15,
-
-	// floating point
-	REG_XMM0,
-
-	REG_COUNT
-};
-
-const char *reg_to_string(enum Register reg);
-
 // push rax
 void emit_push_reg(AsmFileWriter *writer,
 				   enum Register reg,
@@ -105,6 +78,14 @@ void emit_mov_membase_reg(AsmFileWriter *writer,
 						  const char *comment_fmt,
 						  ...);
 
+// lea rcx, [rax + 24]
+void emit_lea_reg_membase(AsmFileWriter *writer,
+						  enum Register dest,
+						  enum Register base,
+						  int offset,
+						  const char *comment_fmt,
+						  ...);
+
 // movsd xmm0, [my_float_label]
 void emit_movsd_reg_global(AsmFileWriter *writer,
 						   enum Register dest,
@@ -120,6 +101,49 @@ void emit_movsd_membase_reg(AsmFileWriter *writer,
 							const char *comment_fmt,
 							...);
 
+// movsd xmm1, [rsp + 8]
+void emit_movsd_reg_membase(AsmFileWriter *writer,
+							enum Register dest,
+							enum Register base,
+							int offset,
+							const char *comment_fmt,
+							...);
+
+// addsd xmm0, xmm1
+void emit_addsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...);
+
+// subsd xmm0, xmm1
+void emit_subsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...);
+
+// mulsd xmm0, xmm1
+void emit_mulsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...);
+
+// divsd xmm0, xmm1
+void emit_divsd_reg_reg(AsmFileWriter *writer,
+						enum Register dest,
+						enum Register src,
+						const char *comment_fmt,
+						...);
+
+// cvtsi2sd xmm0, rax
+void emit_cvtsi2sd_reg_reg(AsmFileWriter *writer,
+						   enum Register dest,
+						   enum Register src,
+						   const char *comment_fmt,
+						   ...);
+
 // call rax
 void emit_call_reg(AsmFileWriter *writer,
 				   enum Register target,
@@ -174,6 +198,55 @@ void emit_je(AsmFileWriter *writer,
 			 const char *comment_fmt,
 			 ...);
 
+// jne my_label
+void emit_jne(AsmFileWriter *writer,
+			  const char *label,
+			  const char *comment_fmt,
+			  ...);
+
+// ja my_label (unsigned >)
+void emit_ja(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...);
+
+// jl my_label (signed <)
+void emit_jl(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...);
+
+// jle my_label (signed <=)
+void emit_jle(AsmFileWriter *writer,
+			  const char *label,
+			  const char *comment_fmt,
+			  ...);
+
+// jg my_label (signed >)
+void emit_jg(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...);
+
+// jge my_label (signed >=)
+void emit_jge(AsmFileWriter *writer,
+			  const char *label,
+			  const char *comment_fmt,
+			  ...);
+
+// jo my_label (signed overflow)
+void emit_jo(AsmFileWriter *writer,
+			 const char *label,
+			 const char *comment_fmt,
+			 ...);
+
+// jmp [r12 + 8]
+void emit_jmp_membase(AsmFileWriter *writer,
+					  enum Register base,
+					  int offset,
+					  const char *comment_fmt,
+					  ...);
+
 // ret
 void emit_ret(AsmFileWriter *writer, const char *comment_fmt, ...);
 
@@ -188,12 +261,89 @@ void emit_cmp_reg_imm(AsmFileWriter *writer,
 					  int32_t imm,
 					  const char *comment_fmt,
 					  ...);
+// cmp rdi, rsi
+void emit_cmp_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...);
+// cmp rcx, [rdx + 8]
+void emit_cmp_reg_membase(AsmFileWriter *writer,
+						  enum Register reg,
+						  enum Register base,
+						  int offset,
+						  const char *comment_fmt,
+						  ...);
+
 // xor rax, rbi
 void emit_xor_reg_reg(AsmFileWriter *writer,
 					  enum Register dest,
 					  enum Register src,
 					  const char *comment_fmt,
 					  ...);
+// add rax, rsi
+void emit_add_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...);
+
+// sub rax, rsi
+void emit_sub_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...);
+
+// imul rax, rcx
+void emit_imul_reg_reg(AsmFileWriter *writer,
+					   enum Register dest,
+					   enum Register src,
+					   const char *comment_fmt,
+					   ...);
+
+// and rax, rsi
+void emit_and_reg_reg(AsmFileWriter *writer,
+					  enum Register dest,
+					  enum Register src,
+					  const char *comment_fmt,
+					  ...);
+
+// add rax, 8
+void emit_add_reg_imm(AsmFileWriter *writer,
+					  enum Register reg,
+					  int32_t imm,
+					  const char *comment_fmt,
+					  ...);
+
+// sub rax, 1
+void emit_sub_reg_imm(AsmFileWriter *writer,
+					  enum Register reg,
+					  int32_t imm,
+					  const char *comment_fmt,
+					  ...);
+
+// or rax, 1
+void emit_or_reg_imm(AsmFileWriter *writer,
+					 enum Register reg,
+					 int32_t imm,
+					 const char *comment_fmt,
+					 ...);
+
+// sar rax, 1
+void emit_sar_reg_imm(AsmFileWriter *writer,
+					  enum Register reg,
+					  int32_t imm,
+					  const char *comment_fmt,
+					  ...);
+
+// test rax, 1
+void emit_test_reg_imm(AsmFileWriter *writer,
+					   enum Register reg,
+					   int32_t imm,
+					   const char *comment_fmt,
+					   ...);
+
 // ; your comment here
 void emit_comment(AsmFileWriter *writer,
 				  const char *comment_fmt,
@@ -219,6 +369,34 @@ void emit_data_dq_float(AsmFileWriter *writer,
 						const char *comment_fmt,
 						...);
 
+// my_object: dq 3, 4609434218613702656, 0
+void emit_data_dq_imms(AsmFileWriter *writer,
+					   const char *label,
+					   const int64_t *values,
+					   int num_values,
+					   const char *comment_fmt,
+					   ...);
+
+// section .rodata
+void emit_data_section(AsmFileWriter *writer,
+					   const char *section,
+					   const char *comment_fmt,
+					   ...);
+
+// align 8
+void emit_data_align(AsmFileWriter *writer,
+					 int alignment,
+					 const char *comment_fmt,
+					 ...);
+
+// my_table: dq label_a, label_b
+void emit_data_dq_labels(AsmFileWriter *writer,
+						 const char *label,
+						 const char **value_labels,
+						 int num_values,
+						 const char *comment_fmt,
+						 ...);
+
 // my_string: db "Hello", 10, 0
 void emit_data_string(AsmFileWriter *writer,
 					  const char *label,
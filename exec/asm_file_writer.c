@@ -6,6 +6,22 @@
 #include <stdlib.h>
 #include <string.h>
 
+static GArray *instruction_buffer_new(void)
+{
+	return g_array_new(FALSE, FALSE, sizeof(AsmInstr));
+}
+
+static void init_instruction_buffers(AsmFileWriter *writer,
+									 bool optimize)
+{
+	writer->functions = g_ptr_array_new();
+	g_ptr_array_add(writer->functions, instruction_buffer_new());
+	writer->strings = g_string_chunk_new(4096);
+	writer->optimize = optimize;
+	memset(&writer->peephole_stats, 0,
+		   sizeof(writer->peephole_stats));
+}
+
 AsmFileWriter *asm_file_writer_create(const char *prefix)
 {
 	AsmFileWriter *writer = malloc(sizeof(AsmFileWriter));
@@ -13,6 +29,8 @@ AsmFileWriter *asm_file_writer_create(const char *prefix)
 
 	writer->file_prefix = strdup(prefix);
 	assert(writer->file_prefix && "Out of memory");
+	writer->object = NULL;
+	init_instruction_buffers(writer, true);
 
 	asprintf(&writer->data_filename, "%s.data.tmp.s", prefix);
 	asprintf(&writer->text_filename, "%s.text.tmp.s", prefix);
@@ -46,6 +64,8 @@ AsmFileWriter *asm_file_writer_create_mock(FILE *text, FILE *data)
 
 	char *prefix = "mock";
 	writer->file_prefix = strdup(prefix);
+	writer->object = NULL;
+	init_instruction_buffers(writer, false);
 
 	asprintf(&writer->data_filename, "%s.data.tmp.s", prefix);
 	asprintf(&writer->text_filename, "%s.text.tmp.s", prefix);
@@ -72,11 +92,31 @@ AsmFileWriter *asm_file_writer_create_mock(FILE *text, FILE *data)
 	return writer;
 }
 
+AsmFileWriter *asm_file_writer_create_object(const char *prefix)
+{
+	AsmFileWriter *writer = calloc(1, sizeof(AsmFileWriter));
+	assert(writer && "Out of memory");
+
+	writer->file_prefix = strdup(prefix);
+	assert(writer->file_prefix && "Out of memory");
+	writer->object = object_file_create();
+	init_instruction_buffers(writer, true);
+	return writer;
+}
+
 void asm_file_writer_cleanup(AsmFileWriter *writer)
 {
 	if (!writer)
 		return;
 
+	object_file_free(writer->object);
+	for (guint i = 0; i < writer->functions->len; i++)
+	{
+		g_array_free(g_ptr_array_index(writer->functions, i), TRUE);
+	}
+	g_ptr_array_free(writer->functions, TRUE);
+	g_string_chunk_free(writer->strings);
+
 	if (writer->data_file)
 		fclose(writer->data_file);
 	if (writer->text_file)
@@ -88,6 +128,57 @@ void asm_file_writer_cleanup(AsmFileWriter *writer)
 	free(writer);
 }
 
+void asm_file_writer_append(AsmFileWriter *writer,
+							const AsmInstr *instr)
+{
+	GArray *code = g_ptr_array_index(writer->functions,
+									 writer->functions->len - 1);
+	g_array_append_vals(code, instr, 1);
+}
+
+void asm_file_writer_begin_function(AsmFileWriter *writer)
+{
+	g_ptr_array_add(writer->functions, instruction_buffer_new());
+}
+
+// Prints or encodes the buffered instructions and empties the buffer.
+static void write_instructions(AsmFileWriter *writer, GArray *code)
+{
+	if (writer->optimize)
+	{
+		peephole_run(code, &writer->peephole_stats);
+	}
+	for (guint i = 0; i < code->len; i++)
+	{
+		const AsmInstr *instr = &g_array_index(code, AsmInstr, i);
+		if (writer->object)
+		{
+			asm_instr_encode(instr, writer->object);
+		}
+		else
+		{
+			asm_instr_print(instr, writer->text_file);
+		}
+	}
+	g_array_set_size(code, 0);
+}
+
+void asm_file_writer_end_function(AsmFileWriter *writer)
+{
+	assert(writer->functions->len > 1 && "No function to end");
+	GArray *code = g_ptr_array_remove_index(
+		writer->functions, writer->functions->len - 1);
+	write_instructions(writer, code);
+	g_array_free(code, TRUE);
+}
+
+void asm_file_writer_flush(AsmFileWriter *writer)
+{
+	assert(writer->functions->len == 1 && "A function is unfinished");
+	write_instructions(writer,
+					   g_ptr_array_index(writer->functions, 0));
+}
+
 static int append_file_contents(FILE *dest, const char *src_filename)
 {
 	FILE *src = fopen(src_filename, "r");
@@ -108,8 +199,29 @@ static int append_file_contents(FILE *dest, const char *src_filename)
 	return 0;
 }
 
-void asm_file_writer_consolidate(AsmFileWriter *writer)
+static bool write_object_file(AsmFileWriter *writer)
 {
+	if (!object_file_resolve(writer->object))
+	{
+		return false;
+	}
+
+	char *filename;
+	asprintf(&filename, "%s.o", writer->file_prefix);
+	assert(filename && "Out of memory");
+	bool ok = object_file_write_elf(writer->object, filename);
+	free(filename);
+	return ok;
+}
+
+bool asm_file_writer_consolidate(AsmFileWriter *writer)
+{
+	asm_file_writer_flush(writer);
+	if (writer->object)
+	{
+		return write_object_file(writer);
+	}
+
 	fflush(writer->data_file);
 	fflush(writer->text_file);
 
@@ -122,7 +234,7 @@ void asm_file_writer_consolidate(AsmFileWriter *writer)
 	{
 		perror("Failed to open final assembly file");
 		free(final_filename);
-		return;
+		return false;
 	}
 
 	fprintf(final_file, "; Generated Assembly File: %s\n\n",
@@ -131,13 +243,13 @@ void asm_file_writer_consolidate(AsmFileWriter *writer)
 	fprintf(final_file, "section .data\n");
 	if (append_file_contents(final_file, writer->data_filename) != 0)
 	{
-		return;
+		return false;
 	}
 
 	fprintf(final_file, "\nsection .text\n");
 	if (append_file_contents(final_file, writer->text_filename) != 0)
 	{
-		return;
+		return false;
 	}
 
 	fclose(final_file);
@@ -146,22 +258,7 @@ void asm_file_writer_consolidate(AsmFileWriter *writer)
 	remove(writer->data_filename);
 	remove(writer->text_filename);
 
-	return;
-}
-
-void asm_file_writer_write_text(AsmFileWriter *writer,
-								const char *format,
-								...)
-{
-	va_list args;
-	va_start(args, format);
-	if (format[0] != '.' && strchr(format, ':') == NULL)
-	{
-		fprintf(writer->text_file, "\t");
-	}
-	vfprintf(writer->text_file, format, args);
-	fprintf(writer->text_file, "\n");
-	va_end(args);
+	return true;
 }
 
 void asm_file_writer_write_data(AsmFileWriter *writer,
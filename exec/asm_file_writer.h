@@ -1,11 +1,30 @@
 #pragma once
 
+#include "asm_instr.h"
+#include "object_file.h"
+#include "peephole.h"
+#include <glib.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 typedef struct AsmFileWriter
 {
 	char *file_prefix;
 
+	// When set, the emitters encode machine code into this object
+	// and no text is written; consolidating writes <prefix>.o.
+	ObjectFile *object;
+
+	// AsmInstr buffers of the functions being generated, innermost
+	// last. The first holds the code outside any function.
+	GPtrArray *functions;
+	// labels and comments of the buffered instructions
+	GStringChunk *strings;
+
+	// Run the peephole pass over each buffer before writing it out.
+	bool optimize;
+	PeepholeStats peephole_stats;
+
 	FILE *data_file;
 	FILE *text_file;
 
@@ -15,15 +34,41 @@ typedef struct AsmFileWriter
 } AsmFileWriter;
 
 AsmFileWriter *asm_file_writer_create(const char *prefix);
+/**
+ * @brief A writer over the caller's streams. It writes instructions
+ * exactly as emitted, without the peephole pass.
+ */
 AsmFileWriter *asm_file_writer_create_mock(FILE *text, FILE *data);
+/** @brief A writer that assembles straight into an ELF object. */
+AsmFileWriter *asm_file_writer_create_object(const char *prefix);
 
 void asm_file_writer_cleanup(AsmFileWriter *writer);
 
-void asm_file_writer_consolidate(AsmFileWriter *writer);
+/** @brief Appends instr to the innermost function's buffer. */
+void asm_file_writer_append(AsmFileWriter *writer,
+							const AsmInstr *instr);
 
-void asm_file_writer_write_text(AsmFileWriter *writer,
-								const char *format,
-								...);
+/**
+ * @brief Starts buffering a function's code. Functions may nest: an
+ * inner one is written out when it ends, before the code around it.
+ */
+void asm_file_writer_begin_function(AsmFileWriter *writer);
+
+/** @brief Writes out the code of the innermost function. */
+void asm_file_writer_end_function(AsmFileWriter *writer);
+
+/**
+ * @brief Writes out the code recorded outside any function. Every
+ * function must have ended.
+ */
+void asm_file_writer_flush(AsmFileWriter *writer);
+
+/**
+ * @brief Flushes, then writes the finished output: <prefix>.asm, or
+ * <prefix>.o for an object writer. Returns false if it could not be
+ * written.
+ */
+bool asm_file_writer_consolidate(AsmFileWriter *writer);
 
 void asm_file_writer_write_data(AsmFileWriter *writer,
 								const char *format,
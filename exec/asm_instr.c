@@ -0,0 +1,357 @@
+#include "asm_instr.h"
+#include "x86_encoder.h"
+#include <assert.h>
+
+static const char *REGISTER_NAMES[] = {
+	"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8",
+	"r9",  "r10", "r11", "r12", "r13", "r14", "r15", "xmm0",
+	"xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8",
+	"xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"};
+
+static const char *MNEMONICS[ASM_OPCODE_COUNT] = {
+	[ASM_LABEL] = NULL,		  [ASM_GLOBAL] = "global",
+	[ASM_EXTERN] = "extern",  [ASM_COMMENT] = NULL,
+	[ASM_PUSH] = "push",	  [ASM_POP] = "pop",
+	[ASM_MOV] = "mov",		  [ASM_LEA] = "lea",
+	[ASM_MOVSD] = "movsd",	  [ASM_ADDSD] = "addsd",
+	[ASM_SUBSD] = "subsd",	  [ASM_MULSD] = "mulsd",
+	[ASM_DIVSD] = "divsd",	  [ASM_CVTSI2SD] = "cvtsi2sd",
+	[ASM_ADD] = "add",		  [ASM_SUB] = "sub",
+	[ASM_AND] = "and",		  [ASM_OR] = "or",
+	[ASM_XOR] = "xor",		  [ASM_CMP] = "cmp",
+	[ASM_IMUL] = "imul",	  [ASM_SAR] = "sar",
+	[ASM_TEST] = "test",	  [ASM_CALL] = "call",
+	[ASM_JMP] = "jmp",		  [ASM_JE] = "je",
+	[ASM_JNE] = "jne",		  [ASM_JA] = "ja",
+	[ASM_JL] = "jl",		  [ASM_JLE] = "jle",
+	[ASM_JG] = "jg",		  [ASM_JGE] = "jge",
+	[ASM_JO] = "jo",		  [ASM_RET] = "ret",
+	[ASM_SYSCALL] = "syscall"};
+
+const char *reg_to_string(enum Register reg)
+{
+	assert(reg < REG_COUNT && "Invalid register enum value.");
+	return REGISTER_NAMES[reg];
+}
+
+static void print_label(FILE *out, const AsmOperand *operand)
+{
+	if (operand->value)
+	{
+		fprintf(out, "%s + %lld", operand->label,
+				(long long)operand->value);
+	}
+	else
+	{
+		fputs(operand->label, out);
+	}
+}
+
+static void print_operand(FILE *out, const AsmOperand *operand)
+{
+	switch (operand->kind)
+	{
+	case ASM_OPERAND_REG:
+		fputs(reg_to_string(operand->reg), out);
+		break;
+	case ASM_OPERAND_IMM:
+		fprintf(out, "%lld", (long long)operand->value);
+		break;
+	case ASM_OPERAND_MEMBASE:
+		fprintf(out, "[%s + %lld]", reg_to_string(operand->reg),
+				(long long)operand->value);
+		break;
+	case ASM_OPERAND_LABEL:
+		print_label(out, operand);
+		break;
+	case ASM_OPERAND_MEM_LABEL:
+		fputc('[', out);
+		print_label(out, operand);
+		fputc(']', out);
+		break;
+	case ASM_OPERAND_NONE:
+		break;
+	}
+}
+
+void asm_instr_print(const AsmInstr *instr, FILE *out)
+{
+	switch (instr->opcode)
+	{
+	case ASM_LABEL:
+		fprintf(out, "%s:", instr->dest.label);
+		break;
+	case ASM_COMMENT:
+		fprintf(out, "\t; %s\n", instr->comment);
+		return;
+	default:
+		fprintf(out, "\t%s", MNEMONICS[instr->opcode]);
+		if (instr->dest.kind != ASM_OPERAND_NONE)
+		{
+			// "qword" removes the size ambiguity of a memory push
+			bool memory = instr->dest.kind == ASM_OPERAND_MEMBASE ||
+						  instr->dest.kind == ASM_OPERAND_MEM_LABEL;
+			bool qword = instr->opcode == ASM_PUSH && memory;
+			fputs(qword ? " qword " : " ", out);
+			print_operand(out, &instr->dest);
+		}
+		if (instr->src.kind != ASM_OPERAND_NONE)
+		{
+			fputs(", ", out);
+			print_operand(out, &instr->src);
+		}
+		break;
+	}
+	if (instr->comment)
+	{
+		fprintf(out, " ; %s", instr->comment);
+	}
+	fputc('\n', out);
+}
+
+// An instruction form, the kinds of its two operands, for switching
+// on: FORM(REG, MEMBASE).
+#define FORM_OF(dest_kind, src_kind) ((dest_kind) << 4 | (src_kind))
+#define FORM(dest, src) FORM_OF(ASM_OPERAND_##dest, ASM_OPERAND_##src)
+
+static X86SseOp sse_op(AsmOpcode opcode)
+{
+	switch (opcode)
+	{
+	case ASM_ADDSD:
+		return X86_SSE_ADD;
+	case ASM_SUBSD:
+		return X86_SSE_SUB;
+	case ASM_MULSD:
+		return X86_SSE_MUL;
+	default:
+		assert(opcode == ASM_DIVSD && "Not a scalar double opcode");
+		return X86_SSE_DIV;
+	}
+}
+
+static X86AluOp alu_op(AsmOpcode opcode)
+{
+	switch (opcode)
+	{
+	case ASM_ADD:
+		return X86_ALU_ADD;
+	case ASM_SUB:
+		return X86_ALU_SUB;
+	case ASM_AND:
+		return X86_ALU_AND;
+	case ASM_OR:
+		return X86_ALU_OR;
+	case ASM_XOR:
+		return X86_ALU_XOR;
+	default:
+		assert(opcode == ASM_CMP && "Not an ALU opcode");
+		return X86_ALU_CMP;
+	}
+}
+
+static X86Condition condition(AsmOpcode opcode)
+{
+	switch (opcode)
+	{
+	case ASM_JE:
+		return X86_CC_E;
+	case ASM_JNE:
+		return X86_CC_NE;
+	case ASM_JA:
+		return X86_CC_A;
+	case ASM_JL:
+		return X86_CC_L;
+	case ASM_JLE:
+		return X86_CC_LE;
+	case ASM_JG:
+		return X86_CC_G;
+	case ASM_JGE:
+		return X86_CC_GE;
+	default:
+		assert(opcode == ASM_JO && "Not a conditional jump");
+		return X86_CC_O;
+	}
+}
+
+void asm_instr_encode(const AsmInstr *instr, ObjectFile *obj)
+{
+	const AsmOperand *dest = &instr->dest;
+	const AsmOperand *src = &instr->src;
+	int form = FORM_OF(dest->kind, src->kind);
+
+	switch (instr->opcode)
+	{
+	case ASM_LABEL:
+		object_file_define(obj, OBJECT_SECTION_TEXT, dest->label);
+		return;
+	case ASM_GLOBAL:
+	case ASM_EXTERN:
+		object_file_declare_global(obj, dest->label);
+		return;
+	case ASM_COMMENT:
+		return;
+
+	case ASM_PUSH:
+		if (form == FORM(REG, NONE))
+			x86_encode_push_reg(obj, dest->reg);
+		else if (form == FORM(IMM, NONE))
+			x86_encode_push_imm(obj, dest->value);
+		else if (form == FORM(MEM_LABEL, NONE))
+			x86_encode_push_rip(obj, dest->label, dest->value);
+		else if (form == FORM(MEMBASE, NONE))
+			x86_encode_push_membase(obj, dest->reg, dest->value);
+		else
+			break;
+		return;
+	case ASM_POP:
+		if (form != FORM(REG, NONE))
+			break;
+		x86_encode_pop_reg(obj, dest->reg);
+		return;
+
+	case ASM_MOV:
+		switch (form)
+		{
+		case FORM(REG, REG):
+			x86_encode_mov_reg_reg(obj, dest->reg, src->reg);
+			return;
+		case FORM(REG, IMM):
+			x86_encode_mov_reg_imm(obj, dest->reg, src->value);
+			return;
+		case FORM(REG, LABEL):
+			x86_encode_mov_reg_address(obj, dest->reg, src->label,
+									   src->value);
+			return;
+		case FORM(REG, MEM_LABEL):
+			x86_encode_mov_reg_rip(obj, dest->reg, src->label,
+								   src->value);
+			return;
+		case FORM(MEM_LABEL, REG):
+			x86_encode_mov_rip_reg(obj, dest->label, dest->value,
+								   src->reg);
+			return;
+		case FORM(REG, MEMBASE):
+			x86_encode_mov_reg_membase(obj, dest->reg, src->reg,
+									   src->value);
+			return;
+		case FORM(MEMBASE, REG):
+			x86_encode_mov_membase_reg(obj, dest->reg, dest->value,
+									   src->reg);
+			return;
+		}
+		break;
+	case ASM_LEA:
+		if (form != FORM(REG, MEMBASE))
+			break;
+		x86_encode_lea_reg_membase(obj, dest->reg, src->reg,
+								   src->value);
+		return;
+
+	case ASM_MOVSD:
+		switch (form)
+		{
+		case FORM(REG, MEM_LABEL):
+			x86_encode_movsd_reg_rip(obj, dest->reg, src->label,
+									 src->value);
+			return;
+		case FORM(REG, MEMBASE):
+			x86_encode_movsd_reg_membase(obj, dest->reg, src->reg,
+										 src->value);
+			return;
+		case FORM(MEMBASE, REG):
+			x86_encode_movsd_membase_reg(obj, dest->reg,
+										 dest->value, src->reg);
+			return;
+		}
+		break;
+	case ASM_ADDSD:
+	case ASM_SUBSD:
+	case ASM_MULSD:
+	case ASM_DIVSD:
+		if (form != FORM(REG, REG))
+			break;
+		x86_encode_sse_reg_reg(obj, sse_op(instr->opcode), dest->reg,
+							   src->reg);
+		return;
+	case ASM_CVTSI2SD:
+		if (form != FORM(REG, REG))
+			break;
+		x86_encode_cvtsi2sd_reg_reg(obj, dest->reg, src->reg);
+		return;
+
+	case ASM_ADD:
+	case ASM_SUB:
+	case ASM_AND:
+	case ASM_OR:
+	case ASM_XOR:
+	case ASM_CMP:
+		if (form == FORM(REG, REG))
+			x86_encode_alu_reg_reg(obj, alu_op(instr->opcode),
+								   dest->reg, src->reg);
+		else if (form == FORM(REG, IMM))
+			x86_encode_alu_reg_imm(obj, alu_op(instr->opcode),
+								   dest->reg, src->value);
+		else if (form == FORM(REG, MEMBASE) &&
+				 instr->opcode == ASM_CMP)
+			x86_encode_cmp_reg_membase(obj, dest->reg, src->reg,
+									   src->value);
+		else
+			break;
+		return;
+	case ASM_IMUL:
+		if (form != FORM(REG, REG))
+			break;
+		x86_encode_imul_reg_reg(obj, dest->reg, src->reg);
+		return;
+	case ASM_SAR:
+		if (form != FORM(REG, IMM))
+			break;
+		x86_encode_sar_reg_imm(obj, dest->reg, src->value);
+		return;
+	case ASM_TEST:
+		if (form != FORM(REG, IMM))
+			break;
+		x86_encode_test_reg_imm(obj, dest->reg, src->value);
+		return;
+
+	case ASM_CALL:
+		if (form == FORM(REG, NONE))
+			x86_encode_call_reg(obj, dest->reg);
+		else if (form == FORM(LABEL, NONE))
+			x86_encode_call_label(obj, dest->label);
+		else
+			break;
+		return;
+	case ASM_JMP:
+		if (form == FORM(LABEL, NONE))
+			x86_encode_jmp_label(obj, dest->label);
+		else if (form == FORM(MEMBASE, NONE))
+			x86_encode_jmp_membase(obj, dest->reg, dest->value);
+		else
+			break;
+		return;
+	case ASM_JE:
+	case ASM_JNE:
+	case ASM_JA:
+	case ASM_JL:
+	case ASM_JLE:
+	case ASM_JG:
+	case ASM_JGE:
+	case ASM_JO:
+		if (form != FORM(LABEL, NONE))
+			break;
+		x86_encode_jcc_label(obj, condition(instr->opcode),
+							 dest->label);
+		return;
+	case ASM_RET:
+		x86_encode_ret(obj);
+		return;
+	case ASM_SYSCALL:
+		x86_encode_syscall(obj);
+		return;
+	case ASM_OPCODE_COUNT:
+		break;
+	}
+	assert(false && "No encoding for this instruction form");
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "object_file.h"
+#include <stdint.h>
+#include <stdio.h>
+
+enum Register
+{
+	REG_RAX,
+	REG_RCX,
+	REG_RDX,
+	REG_RBX,
+	REG_RSP,
+	REG_RBP,
+	REG_RSI,
+	REG_RDI,
+	REG_R8,
+	REG_R9,
+	REG_R10,
+	REG_R11,
+	REG_R12,
+	REG_R13,
+	REG_R14,
+	REG_R15,
+
+	// floating point
+	REG_XMM0,
+	REG_XMM1,
+	REG_XMM2,
+	REG_XMM3,
+	REG_XMM4,
+	REG_XMM5,
+	REG_XMM6,
+	REG_XMM7,
+	REG_XMM8,
+	REG_XMM9,
+	REG_XMM10,
+	REG_XMM11,
+	REG_XMM12,
+	REG_XMM13,
+	REG_XMM14,
+	REG_XMM15,
+
+	REG_COUNT
+};
+
+const char *reg_to_string(enum Register reg);
+
+typedef enum AsmOpcode
+{
+	// pseudo instructions
+	ASM_LABEL,
+	ASM_GLOBAL,
+	ASM_EXTERN,
+	ASM_COMMENT,
+
+	ASM_PUSH,
+	ASM_POP,
+	ASM_MOV,
+	ASM_LEA,
+
+	ASM_MOVSD,
+	ASM_ADDSD,
+	ASM_SUBSD,
+	ASM_MULSD,
+	ASM_DIVSD,
+	ASM_CVTSI2SD,
+
+	ASM_ADD,
+	ASM_SUB,
+	ASM_AND,
+	ASM_OR,
+	ASM_XOR,
+	ASM_CMP,
+	ASM_IMUL,
+	ASM_SAR,
+	ASM_TEST,
+
+	ASM_CALL,
+	ASM_JMP,
+	ASM_JE,
+	ASM_JNE,
+	ASM_JA,
+	ASM_JL,
+	ASM_JLE,
+	ASM_JG,
+	ASM_JGE,
+	ASM_JO,
+	ASM_RET,
+	ASM_SYSCALL,
+
+	ASM_OPCODE_COUNT
+} AsmOpcode;
+
+typedef enum AsmOperandKind
+{
+	ASM_OPERAND_NONE,
+	ASM_OPERAND_REG,	   // rax
+	ASM_OPERAND_IMM,	   // 123
+	ASM_OPERAND_MEMBASE,   // [rbp + -8]
+	ASM_OPERAND_LABEL,	   // L_func_1, the address itself
+	ASM_OPERAND_MEM_LABEL, // [G_global_var_0]
+} AsmOperandKind;
+
+typedef struct AsmOperand
+{
+	AsmOperandKind kind;
+	enum Register reg; // the register, or the base of a MEMBASE
+	// the immediate, the MEMBASE displacement or the label addend
+	int64_t value;
+	const char *label;
+} AsmOperand;
+
+/**
+ * @brief One instruction or directive of a function's code, with
+ * its operands in NASM order: destination first. Strings belong to
+ * the writer that recorded it.
+ */
+typedef struct AsmInstr
+{
+	AsmOpcode opcode;
+	AsmOperand dest;
+	AsmOperand src;
+	const char *comment; // NULL if none
+} AsmInstr;
+
+/** @brief Writes instr as one line of NASM source. */
+void asm_instr_print(const AsmInstr *instr, FILE *out);
+
+/** @brief Appends the machine code of instr to obj's text. */
+void asm_instr_encode(const AsmInstr *instr, ObjectFile *obj);
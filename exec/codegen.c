@@ -2,29 +2,51 @@
 #include "asm_emitter.h"
 #include <assert.h>
 #include <stdarg.h>
+#include <string.h>
 
+#include "gc.h"
 #include "lispvalue.h"
+#include "runtime_symbols.h"
 
-static CodeGenContext *
-codegen_context_create(const char *output_prefix);
+static CodeGenContext *codegen_context_create(AsmFileWriter *writer);
 static void codegen_context_cleanup(CodeGenContext *ctx);
 static void generate_node(CodeGenContext *ctx, Node *node);
+static void generate_tail_node(CodeGenContext *ctx, Node *node);
 static void generate_literal(CodeGenContext *ctx, Node *node);
 static void generate_def(CodeGenContext *ctx, Node *node);
 static void generate_variable(CodeGenContext *ctx, Node *node);
-static void generate_if(CodeGenContext *ctx, Node *node);
-static void generate_let(CodeGenContext *ctx, Node *node);
-static void generate_call(CodeGenContext *ctx, Node *node);
+static void codegen_load_variable(CodeGenContext *ctx,
+								  const VarLocation *loc,
+								  enum Register dest);
+static void generate_if(CodeGenContext *ctx, Node *node, bool tail);
+static void generate_let(CodeGenContext *ctx, Node *node, bool tail);
+static void generate_call(CodeGenContext *ctx, Node *node, bool tail);
 static void generate_function_impl(CodeGenContext *ctx,
 								   Node *node,
-								   const char *self_name);
+								   const char *self_name,
+								   bool on_stack);
 static void generate_function(CodeGenContext *ctx, Node *node);
+static void generate_quote(CodeGenContext *ctx, Node *node);
+static const char *codegen_symbol_constant(CodeGenContext *ctx,
+										   const char *name);
+static void codegen_emit_box_xmm0(CodeGenContext *ctx);
 
 static const enum Register ARGUMENT_REGS[] = {
 	REG_RDI, REG_RSI, REG_RDX, REG_RCX, REG_R8, REG_R9};
 static const char *ARGUMENT_REGISTERS[] = {"rdi", "rsi", "rdx",
 										   "rcx", "r8",	 "r9"};
 static const int NUM_ARGUMENT_REGISTERS = 6;
+// Callee-saved registers that hold let-bound locals. R12 is taken by
+// the closure pointer.
+static const enum Register LOCAL_REGS[] = {REG_RBX, REG_R13, REG_R14,
+										   REG_R15};
+static const int NUM_LOCAL_REGISTERS = 4;
+// Closure calls pass their argument count here; the callee's checked
+// entry compares it against its arity.
+static const enum Register ARG_COUNT_REG = REG_R10;
+
+static const char *GC_GLOBAL_ROOTS_LABEL = "gc_global_roots";
+static const char *STATIC_SYMBOLS_LABEL = "static_symbols";
 
 int get_next_label(void)
 {
@@ -36,27 +58,39 @@ static inline StringToStringMap *
 create_and_populate_builtin_func_map(void)
 {
 	StringToStringMap *map = string_to_string_map_new();
-	string_to_string_map_insert(map, "print-debug", "lisp_print");
-	string_to_string_map_insert(map, "+", "lisp_add");
-	string_to_string_map_insert(map, "-", "lisp_subtract");
-	string_to_string_map_insert(map, "*", "lisp_multiply");
-	string_to_string_map_insert(map, "=", "lisp_equal");
+	for (size_t i = 0; i < NUM_RUNTIME_SYMBOLS; i++)
+	{
+		const RuntimeSymbol *symbol = &RUNTIME_SYMBOLS[i];
+		if (symbol->builtin)
+		{
+			string_to_string_map_insert(map, symbol->builtin,
+										symbol->name);
+		}
+	}
 	return map;
 }
 
-static CodeGenContext *
-codegen_context_create(const char *output_prefix)
+static CodeGenContext *codegen_context_create(AsmFileWriter *writer)
 {
 	CodeGenContext *ctx = malloc(sizeof(CodeGenContext));
-	ctx->writer = asm_file_writer_create(output_prefix);
-	if (!ctx->writer)
-	{
-		free(ctx);
-		return NULL;
-	}
-
+	ctx->writer = writer;
 	ctx->builtin_func_map = create_and_populate_builtin_func_map();
 	ctx->env = codegen_env_create();
+	ctx->global_roots = g_ptr_array_new();
+	ctx->known_functions =
+		g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	ctx->in_function = false;
+	// main never returns, so it may use every local register without
+	// saving it
+	ctx->num_local_regs = NUM_LOCAL_REGISTERS;
+	ctx->next_local_reg = 0;
+	ctx->stack_closures =
+		g_hash_table_new(g_str_hash, g_str_equal);
+	ctx->float_constants = g_hash_table_new_full(
+		g_int64_hash, g_int64_equal, g_free, g_free);
+	ctx->symbol_constants = g_hash_table_new_full(
+		g_str_hash, g_str_equal, g_free, g_free);
+	ctx->static_symbols = g_ptr_array_new();
 	codegen_env_enter_scope(ctx->env);
 	return ctx;
 }
@@ -67,47 +101,45 @@ static void codegen_context_cleanup(CodeGenContext *ctx)
 		return;
 	codegen_env_cleanup(ctx->env);
 	string_to_string_map_free(ctx->builtin_func_map);
+	g_ptr_array_free(ctx->global_roots, TRUE);
+	g_hash_table_destroy(ctx->known_functions);
+	g_hash_table_destroy(ctx->stack_closures);
+	g_hash_table_destroy(ctx->float_constants);
+	g_hash_table_destroy(ctx->symbol_constants);
+	g_ptr_array_free(ctx->static_symbols, TRUE);
 
 	g_free(ctx);
 }
 
-static void emit_extern_for_builtin(gpointer key,
-									gpointer value,
-									gpointer user_data)
-{
-	(void)key;
-
-	const char *c_function_label = (const char *)value;
-	CodeGenContext *ctx = (CodeGenContext *)user_data;
-
-	emit_extern(ctx->writer, value, "");
-}
-
 static inline void write_prologue(CodeGenContext *ctx)
 {
-	char *core_runtime_functions[] = {
-		"lispvalue_create_int",	 "lispvalue_create_float",
-		"lispvalue_create_bool", "lispvalue_create_closure",
-		"lispcell_create",		 "lispvalue_create_cell",
-		"lisp_is_truthy"};
-	int num_elements = sizeof(core_runtime_functions) /
-					   sizeof(core_runtime_functions[0]);
-
 	emit_global(ctx->writer, "main", "");
 
 	emit_comment(ctx->writer,
-				 "; Core runtime functions declared extern");
-	for (int i = 0; i < num_elements; i++)
+				 "; Runtime functions and data declared extern");
+	for (size_t i = 0; i < NUM_RUNTIME_SYMBOLS; i++)
 	{
-		emit_extern(ctx->writer, core_runtime_functions[i], "");
+		emit_extern(ctx->writer, RUNTIME_SYMBOLS[i].name, "");
 	}
 
-	emit_comment(ctx->writer, "; Builtin functions declared extern");
-	g_hash_table_foreach(ctx->builtin_func_map->_map,
-						 emit_extern_for_builtin, ctx);
+	asm_file_writer_begin_function(ctx->writer);
 	emit_label(ctx->writer, "main", "");
 	emit_push_reg(ctx->writer, REG_RBP, "");
 	emit_mov_reg_reg(ctx->writer, REG_RBP, REG_RSP, "");
+
+	emit_mov_reg_reg(ctx->writer, REG_RDI, REG_RBP,
+					 "gc: stack scan stops at main's frame");
+	emit_mov_reg_label(ctx->writer, REG_RSI, GC_GLOBAL_ROOTS_LABEL,
+					   "gc: global roots");
+	emit_mov_reg_imm(ctx->writer, REG_RDX, ctx->global_roots->len,
+					 "gc: number of global roots");
+	emit_call_label(ctx->writer, "lisp_gc_init", "");
+
+	emit_mov_reg_label(ctx->writer, REG_RDI, STATIC_SYMBOLS_LABEL,
+					   "symbols: static symbol objects");
+	emit_mov_reg_imm(ctx->writer, REG_RSI, ctx->static_symbols->len,
+					 "symbols: number of static symbols");
+	emit_call_label(ctx->writer, "lisp_symbols_init", "");
 }
 
 static inline void write_epilogue(CodeGenContext *ctx)
@@ -115,11 +147,91 @@ static inline void write_epilogue(CodeGenContext *ctx)
 	emit_mov_reg_imm(ctx->writer, REG_RAX, 60, "arg1");
 	emit_mov_reg_imm(ctx->writer, REG_RDI, 0, "arg2");
 	emit_syscall(ctx->writer, "");
+	asm_file_writer_end_function(ctx->writer);
 }
 
 static void codegen_declare_globals_recursive(CodeGenContext *ctx,
 											  Node *node);
 
+// Records one def of a global. Names are borrowed from the AST.
+static void codegen_note_global_def(CodeGenContext *ctx,
+									VarBinding *binding)
+{
+	KnownFunction *known =
+		g_hash_table_lookup(ctx->known_functions, binding->name);
+	if (!known)
+	{
+		known = g_new0(KnownFunction, 1);
+		g_hash_table_insert(ctx->known_functions, binding->name,
+							known);
+	}
+	known->num_defs++;
+	known->fn_node = binding->value_expr;
+}
+
+static gboolean codegen_is_not_known_function(gpointer key,
+											  gpointer value,
+											  gpointer user_data)
+{
+	KnownFunction *known = value;
+	return known->num_defs != 1 ||
+		   known->fn_node->type != NODE_FUNCTION ||
+		   known->fn_node->function.free_var_names->_array->len > 0;
+}
+
+static char *codegen_static_closure_label(KnownFunction *known)
+{
+	return g_strdup_printf("L_closure_%d", known->label_num);
+}
+
+// Picks the code label of a known function and emits its closure
+// object, fully initialized, in the data section. With no free
+// variables there is nothing to fill in at run time, and the global
+// holding it starts out pointing there.
+static void codegen_assign_known_label(gpointer key,
+									   gpointer value,
+									   gpointer user_data)
+{
+	CodeGenContext *ctx = user_data;
+	KnownFunction *known = value;
+	known->label_num = get_next_label();
+
+	char *words[sizeof(LispClosureObject) / sizeof(int64_t)];
+	words[offsetof(LispClosureObject, type) / sizeof(int64_t)] =
+		g_strdup_printf("%d", LISP_CLOSURE);
+	words[offsetof(LispClosureObject, code_ptr) / sizeof(int64_t)] =
+		g_strdup_printf("L_func_%d", known->label_num);
+	words[offsetof(LispClosureObject, arity) / sizeof(int64_t)] =
+		g_strdup_printf(
+			"%u", known->fn_node->function.param_names->_array->len);
+	words[offsetof(LispClosureObject, num_free_vars) /
+		  sizeof(int64_t)] = g_strdup("0");
+
+	char *label = codegen_static_closure_label(known);
+	emit_data_align(ctx->writer, sizeof(int64_t), NULL);
+	emit_data_dq_labels(ctx->writer, label, (const char **)words,
+						G_N_ELEMENTS(words), "closure of '%s'",
+						(const char *)key);
+	g_free(label);
+	for (guint i = 0; i < G_N_ELEMENTS(words); i++)
+	{
+		g_free(words[i]);
+	}
+}
+
+// Returns the known function a call through name reaches, or NULL
+// if name is shadowed or may be rebound.
+static KnownFunction *
+codegen_lookup_known_function(CodeGenContext *ctx, const char *name)
+{
+	const VarLocation *loc = codegen_env_lookup(ctx->env, name);
+	if (!loc || loc->type != VAR_LOCATION_GLOBAL)
+	{
+		return NULL;
+	}
+	return g_hash_table_lookup(ctx->known_functions, name);
+}
+
 static void codegen_declare_globals(CodeGenContext *ctx,
 									NodeArray *ast)
 {
@@ -129,9 +241,75 @@ static void codegen_declare_globals(CodeGenContext *ctx,
 		Node *node = g_ptr_array_index(ast->_array, i);
 		codegen_declare_globals_recursive(ctx, node);
 	}
+	g_hash_table_foreach_remove(ctx->known_functions,
+								codegen_is_not_known_function, NULL);
+	g_hash_table_foreach(ctx->known_functions,
+						 codegen_assign_known_label, ctx);
+
+	// global label -> static closure it starts out holding
+	GHashTable *initial_values =
+		g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	GHashTableIter iter;
+	gpointer name, known;
+	g_hash_table_iter_init(&iter, ctx->known_functions);
+	while (g_hash_table_iter_next(&iter, &name, &known))
+	{
+		const VarLocation *loc = codegen_env_lookup(ctx->env, name);
+		g_hash_table_insert(initial_values,
+							(gpointer)loc->global_label,
+							codegen_static_closure_label(known));
+	}
+	for (guint i = 0; i < ctx->global_roots->len; i++)
+	{
+		const char *label = g_ptr_array_index(ctx->global_roots, i);
+		const char *closure_label =
+			g_hash_table_lookup(initial_values, label);
+		if (closure_label)
+		{
+			emit_data_dq_labels(ctx->writer, label, &closure_label, 1,
+								"global function");
+		}
+		else
+		{
+			emit_data_dq_imm(ctx->writer, label, LISP_IMM_NIL,
+							 "global var");
+		}
+	}
+	g_hash_table_destroy(initial_values);
+
+	emit_data_dq_labels(ctx->writer, GC_GLOBAL_ROOTS_LABEL,
+						(const char **)ctx->global_roots->pdata,
+						ctx->global_roots->len,
+						"roots scanned by the collector");
+	emit_data_dq_labels(ctx->writer, STATIC_SYMBOLS_LABEL,
+						(const char **)ctx->static_symbols->pdata,
+						ctx->static_symbols->len,
+						"symbols interned at startup");
 	emit_comment(ctx->writer, "End of global declarations\n");
 }
 
+// Emits the static object of every symbol in a quoted datum, so the
+// table handed to the runtime is complete before any code runs.
+static void codegen_declare_quoted_symbols(CodeGenContext *ctx,
+										   Node *datum)
+{
+	Node *atom = datum->quote.quoted_expr;
+	if (atom)
+	{
+		if (atom->literal.lit_type == LIT_SYMBOL)
+		{
+			codegen_symbol_constant(ctx, atom->literal.s_val);
+		}
+		return;
+	}
+	NodeArray *elements = datum->quote.elements;
+	for (guint i = 0; i < elements->_array->len; i++)
+	{
+		codegen_declare_quoted_symbols(
+			ctx, node_array_index(elements, i));
+	}
+}
+
 static void codegen_declare_globals_recursive(CodeGenContext *ctx,
 											  Node *node)
 {
@@ -147,9 +325,9 @@ static void codegen_declare_globals_recursive(CodeGenContext *ctx,
 		{
 			const char *label =
 				codegen_env_add_global_variable(ctx->env, name);
-			emit_data_dq_imm(ctx->writer, label, 0, "global var '%s'",
-							 name);
+			g_ptr_array_add(ctx->global_roots, (gpointer)label);
 		}
+		codegen_note_global_def(ctx, node->def.binding);
 		codegen_declare_globals_recursive(
 			ctx, node->def.binding->value_expr);
 		break;
@@ -199,20 +377,22 @@ static void codegen_declare_globals_recursive(CodeGenContext *ctx,
 										  node->if_expr.else_branch);
 		break;
 
+	case NODE_QUOTE:
+		emit_data_section(ctx->writer, ".rodata", "quoted symbols");
+		codegen_declare_quoted_symbols(ctx, node);
+		emit_data_section(ctx->writer, ".data", NULL);
+		break;
+
 	case NODE_LITERAL:
 	case NODE_VARIABLE:
-	case NODE_QUOTE:
 	case NODE_PLACEHOLDER:
 		break;
 	}
 }
 
-void codegen_compile_program(NodeArray *ast,
-							 const char *output_prefix)
+void codegen_generate_program(NodeArray *ast, AsmFileWriter *writer)
 {
-	CodeGenContext *ctx = codegen_context_create(output_prefix);
-	if (!ctx)
-		return;
+	CodeGenContext *ctx = codegen_context_create(writer);
 	codegen_declare_globals(ctx, ast);
 
 	write_prologue(ctx);
@@ -224,11 +404,30 @@ void codegen_compile_program(NodeArray *ast,
 		generate_node(ctx, node);
 	}
 	write_epilogue(ctx);
-
-	asm_file_writer_consolidate(ctx->writer);
-	asm_file_writer_cleanup(ctx->writer);
+	asm_file_writer_flush(ctx->writer);
 	codegen_context_cleanup(ctx);
-	return;
+}
+
+bool codegen_compile_program(NodeArray *ast,
+							 const char *output_prefix,
+							 CodeGenOutput output,
+							 PeepholeStats *peephole_stats)
+{
+	AsmFileWriter *writer =
+		output == CODEGEN_OUTPUT_OBJECT
+			? asm_file_writer_create_object(output_prefix)
+			: asm_file_writer_create(output_prefix);
+	if (!writer)
+		return false;
+
+	codegen_generate_program(ast, writer);
+	bool ok = asm_file_writer_consolidate(writer);
+	if (peephole_stats)
+	{
+		*peephole_stats = writer->peephole_stats;
+	}
+	asm_file_writer_cleanup(writer);
+	return ok;
 }
 
 static void generate_node(CodeGenContext *ctx, Node *node)
@@ -245,17 +444,20 @@ static void generate_node(CodeGenContext *ctx, Node *node)
 		generate_variable(ctx, node);
 		break;
 	case NODE_IF:
-		generate_if(ctx, node);
+		generate_if(ctx, node, false);
 		break;
 	case NODE_LET:
-		generate_let(ctx, node);
+		generate_let(ctx, node, false);
 		break;
 	case NODE_CALL:
-		generate_call(ctx, node);
+		generate_call(ctx, node, false);
 		break;
 	case NODE_FUNCTION:
 		generate_function(ctx, node);
 		break;
+	case NODE_QUOTE:
+		generate_quote(ctx, node);
+		break;
 	default:
 		fprintf(stderr,
 				"Codegen Error: Unimplemented AST node type %d\n",
@@ -264,29 +466,137 @@ static void generate_node(CodeGenContext *ctx, Node *node)
 	}
 }
 
+// Generates a node whose value is the return value of the enclosing
+// function, so calls in it may reuse the current frame.
+static void generate_tail_node(CodeGenContext *ctx, Node *node)
+{
+	switch (node->type)
+	{
+	case NODE_IF:
+		generate_if(ctx, node, true);
+		break;
+	case NODE_LET:
+		generate_let(ctx, node, true);
+		break;
+	case NODE_CALL:
+		generate_call(ctx, node, true);
+		break;
+	default:
+		generate_node(ctx, node);
+	}
+}
+
 static inline void generate_literal_int(CodeGenContext *ctx,
 										Node *node)
 {
-	emit_mov_reg_imm(ctx->writer, REG_RDI, node->literal.i_val,
-					 "int literal");
-	emit_call_label(ctx->writer, "lispvalue_create_int", "");
+	int64_t tagged = (int64_t)lisp_make_fixnum(node->literal.i_val);
+	emit_mov_reg_imm(ctx->writer, REG_RAX, tagged,
+					 "fixnum literal %d", node->literal.i_val);
+}
+// Bump-allocates a small object from its size class's nursery.
+// Leaves the payload address in RAX, or jumps to slow_label when the
+// nursery block is exhausted. Clobbers RCX and RDX.
+static void codegen_emit_nursery_alloc(CodeGenContext *ctx,
+									   size_t payload_size,
+									   GcObjectKind kind,
+									   const char *slow_label)
+{
+	int size_class = gc_size_class(payload_size);
+	assert(size_class != GC_LARGE_SIZE_CLASS &&
+		   "Inline allocation is only for small objects");
+	int nursery_offset = size_class * sizeof(GcNursery);
+
+	emit_mov_reg_label(ctx->writer, REG_RDX, "lisp_nursery", "");
+	emit_mov_reg_membase(ctx->writer, REG_RAX, REG_RDX,
+						 nursery_offset + offsetof(GcNursery, ptr),
+						 "nursery bump pointer (class %d)",
+						 size_class);
+	emit_lea_reg_membase(ctx->writer, REG_RCX, REG_RAX,
+						 gc_slot_size(size_class), "");
+	emit_cmp_reg_membase(ctx->writer, REG_RCX, REG_RDX,
+						 nursery_offset + offsetof(GcNursery, limit),
+						 "");
+	emit_ja(ctx->writer, slow_label, "nursery block exhausted");
+	emit_mov_membase_reg(ctx->writer, REG_RDX,
+						 nursery_offset + offsetof(GcNursery, ptr),
+						 REG_RCX, "");
+	emit_mov_reg_imm(ctx->writer, REG_RCX,
+					 gc_header_word(kind, size_class), "");
+	emit_mov_membase_reg(ctx->writer, REG_RAX, 0, REG_RCX,
+						 "object header");
+	emit_lea_reg_membase(ctx->writer, REG_RAX, REG_RAX,
+						 sizeof(GcHeader), "payload");
 }
+
+// Returns the label of a LispValue float in the data section holding
+// f_val, emitting it the first time the value is seen. The object is
+// never collected or written to, so every use of the literal shares
+// it. Keyed by bit pattern so 0.0 and -0.0 stay distinct.
+static const char *codegen_float_constant(CodeGenContext *ctx,
+										  double f_val)
+{
+	int64_t bits;
+	memcpy(&bits, &f_val, sizeof(bits));
+	const char *label =
+		g_hash_table_lookup(ctx->float_constants, &bits);
+	if (label)
+	{
+		return label;
+	}
+
+	int64_t words[sizeof(LispValue) / sizeof(int64_t)] = {0};
+	words[0] = LISP_FLOAT;
+	words[offsetof(LispValue, as.f_val) / sizeof(int64_t)] = bits;
+
+	char *new_label = g_strdup_printf("L_float_%d", get_next_label());
+	emit_data_align(ctx->writer, sizeof(int64_t), NULL);
+	emit_data_dq_imms(ctx->writer, new_label, words,
+					  G_N_ELEMENTS(words), "float %g", f_val);
+	int64_t *key = g_new(int64_t, 1);
+	*key = bits;
+	g_hash_table_insert(ctx->float_constants, key, new_label);
+	return new_label;
+}
+
 static inline void generate_literal_float(CodeGenContext *ctx,
 										  Node *node)
 {
-	char *label = g_strdup_printf("L_float_%d", get_next_label());
-	double f_val = node->literal.f_val;
-	emit_data_dq_float(ctx->writer, label, f_val, "");
-	emit_movsd_reg_global(ctx->writer, REG_XMM0, label, "");
+	const char *label =
+		codegen_float_constant(ctx, node->literal.f_val);
+	emit_mov_reg_label(ctx->writer, REG_RAX, label, "static float");
+}
+
+// Boxes the double in XMM0 as a heap float, leaving it in RAX.
+static void codegen_emit_box_xmm0(CodeGenContext *ctx)
+{
+	int label_num = get_next_label();
+	char *slow_label = g_strdup_printf("L_alloc_slow_%d", label_num);
+	char *done_label = g_strdup_printf("L_alloc_done_%d", label_num);
+
+	codegen_emit_nursery_alloc(ctx, sizeof(LispValue), GC_KIND_VALUE,
+							   slow_label);
+	emit_mov_reg_imm(ctx->writer, REG_RCX, LISP_FLOAT, "");
+	emit_mov_membase_reg(ctx->writer, REG_RAX,
+						 offsetof(LispValue, type), REG_RCX, "");
+	emit_movsd_membase_reg(ctx->writer, REG_RAX,
+						   offsetof(LispValue, as.f_val), REG_XMM0,
+						   "");
+	emit_jmp(ctx->writer, done_label, "");
+
+	emit_label(ctx->writer, slow_label, "");
 	emit_call_label(ctx->writer, "lispvalue_create_float", "");
-	g_free(label);
+	emit_label(ctx->writer, done_label, "");
+
+	g_free(slow_label);
+	g_free(done_label);
 }
 static inline void generate_literal_bool(CodeGenContext *ctx,
 										 Node *node)
 {
-	int64_t b_val = node->literal.b_val ? 1 : 0;
-	emit_mov_reg_imm(ctx->writer, REG_RDI, b_val, "");
-	emit_call_label(ctx->writer, "lispvalue_create_bool", "");
+	bool b_val = node->literal.b_val;
+	emit_mov_reg_imm(ctx->writer, REG_RAX,
+					 b_val ? LISP_IMM_TRUE : LISP_IMM_FALSE,
+					 b_val ? "#t" : "#f");
 }
 
 static void generate_literal(CodeGenContext *ctx, Node *node)
@@ -324,8 +634,13 @@ static inline void generate_global_function(CodeGenContext *ctx,
 		exit(1);
 	}
 
-	generate_function_impl(ctx, fn_node, name);
-	emit_mov_global_reg(ctx->writer, loc->global_label, REG_RAX, "");
+	generate_function_impl(ctx, fn_node, name, false);
+	KnownFunction *known = codegen_lookup_known_function(ctx, name);
+	if (!known || known->fn_node != fn_node)
+	{
+		emit_mov_global_reg(ctx->writer, loc->global_label, REG_RAX,
+							"");
+	}
 }
 
 static inline void generate_global_variable(CodeGenContext *ctx,
@@ -363,6 +678,178 @@ static void generate_def(CodeGenContext *ctx, Node *node)
 	}
 }
 
+// Returns how many let-bound locals can be live at once while
+// evaluating node, not counting nested function bodies.
+static int codegen_max_live_locals(Node *node)
+{
+	int max_live = 0;
+	switch (node->type)
+	{
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		guint num_bindings = bindings->_array->len;
+		for (guint i = 0; i < num_bindings; i++)
+		{
+			VarBinding *binding =
+				g_ptr_array_index(bindings->_array, i);
+			int live =
+				i + codegen_max_live_locals(binding->value_expr);
+			max_live = MAX(max_live, live);
+		}
+		NodeArray *body = node->let.body;
+		for (guint i = 0; i < body->_array->len; i++)
+		{
+			Node *body_expr = g_ptr_array_index(body->_array, i);
+			int live =
+				num_bindings + codegen_max_live_locals(body_expr);
+			max_live = MAX(max_live, live);
+		}
+		max_live = MAX(max_live, (int)num_bindings);
+		break;
+	}
+	case NODE_IF:
+		max_live = codegen_max_live_locals(node->if_expr.condition);
+		max_live = MAX(max_live, codegen_max_live_locals(
+									 node->if_expr.then_branch));
+		if (node->if_expr.else_branch)
+		{
+			max_live = MAX(max_live, codegen_max_live_locals(
+										 node->if_expr.else_branch));
+		}
+		break;
+	case NODE_CALL:
+	{
+		max_live = codegen_max_live_locals(node->call.fn);
+		NodeArray *args = node->call.args;
+		for (guint i = 0; i < args->_array->len; i++)
+		{
+			Node *arg = g_ptr_array_index(args->_array, i);
+			max_live = MAX(max_live, codegen_max_live_locals(arg));
+		}
+		break;
+	}
+	case NODE_DEF:
+		max_live =
+			codegen_max_live_locals(node->def.binding->value_expr);
+		break;
+	default:
+		break;
+	}
+	return max_live;
+}
+
+static bool codegen_closure_escapes_any(NodeArray *nodes,
+										const char *name);
+
+// Returns false only if every use of name in node calls it directly.
+// Any other use, a use from a nested function, or a rebinding of name
+// counts as an escape, so the answer needs no scope tracking.
+static bool codegen_closure_escapes(Node *node, const char *name)
+{
+	switch (node->type)
+	{
+	case NODE_VARIABLE:
+		return strcmp(node->variable.name, name) == 0;
+	case NODE_CALL:
+	{
+		Node *fn = node->call.fn;
+		bool direct = fn->type == NODE_VARIABLE &&
+					  strcmp(fn->variable.name, name) == 0;
+		if (!direct && codegen_closure_escapes(fn, name))
+		{
+			return true;
+		}
+		return codegen_closure_escapes_any(node->call.args, name);
+	}
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				g_ptr_array_index(bindings->_array, i);
+			if (strcmp(binding->name, name) == 0 ||
+				codegen_closure_escapes(binding->value_expr, name))
+			{
+				return true;
+			}
+		}
+		return codegen_closure_escapes_any(node->let.body, name);
+	}
+	case NODE_DEF:
+		return strcmp(node->def.binding->name, name) == 0 ||
+			   codegen_closure_escapes(node->def.binding->value_expr,
+									   name);
+	case NODE_IF:
+		return codegen_closure_escapes(node->if_expr.condition,
+									   name) ||
+			   codegen_closure_escapes(node->if_expr.then_branch,
+									   name) ||
+			   (node->if_expr.else_branch &&
+				codegen_closure_escapes(node->if_expr.else_branch,
+										name));
+	case NODE_FUNCTION:
+		return string_array_contains(node->function.free_var_names,
+									 name) ||
+			   string_array_contains(node->function.param_names,
+									 name);
+	default:
+		return false;
+	}
+}
+
+static bool codegen_closure_escapes_any(NodeArray *nodes,
+										const char *name)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		if (codegen_closure_escapes(node_array_index(nodes, i), name))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// A let binding whose value is a lambda that the rest of the let only
+// ever calls can keep its closure object in the current frame.
+static bool codegen_is_stack_closure_binding(Node *let_node,
+											 guint binding_index)
+{
+	VarBindingArray *bindings = let_node->let.bindings;
+	VarBinding *binding =
+		g_ptr_array_index(bindings->_array, binding_index);
+	if (binding->value_expr->type != NODE_FUNCTION)
+	{
+		return false;
+	}
+	for (guint i = binding_index + 1; i < bindings->_array->len; i++)
+	{
+		VarBinding *later = g_ptr_array_index(bindings->_array, i);
+		if (strcmp(later->name, binding->name) == 0 ||
+			codegen_closure_escapes(later->value_expr, binding->name))
+		{
+			return false;
+		}
+	}
+	return !codegen_closure_escapes_any(let_node->let.body,
+										binding->name);
+}
+
+// Restores the local registers saved by the function prologue. Only
+// touches memory below rbp, so argument registers survive.
+static void codegen_restore_local_regs(CodeGenContext *ctx)
+{
+	for (int i = 0; i < ctx->num_local_regs; i++)
+	{
+		emit_mov_reg_membase(ctx->writer, LOCAL_REGS[i], REG_RBP,
+							 -(int)sizeof(LispValue *) * (i + 2),
+							 "restore callee-saved %s",
+							 reg_to_string(LOCAL_REGS[i]));
+	}
+}
+
 static void generate_function_body(CodeGenContext *ctx,
 								   Node *node,
 								   const char *func_label,
@@ -370,7 +857,20 @@ static void generate_function_body(CodeGenContext *ctx,
 
 {
 	const char *comment_name = (self_name) ? self_name : "anonymous";
+	StringArray *params = node->function.param_names;
+	guint num_params = params->_array->len;
+	char *unchecked_label =
+		g_strdup_printf("%s_unchecked", func_label);
+	char *arity_error_label =
+		g_strdup_printf("%s_arity_error", func_label);
+
+	asm_file_writer_begin_function(ctx->writer);
 	emit_label(ctx->writer, func_label, "function %s", comment_name);
+	emit_cmp_reg_imm(ctx->writer, ARG_COUNT_REG, num_params,
+					 "checked entry: argument count");
+	emit_jne(ctx->writer, arity_error_label, "");
+	emit_label(ctx->writer, unchecked_label,
+			   "entry for callers with a known arity");
 	emit_push_reg(ctx->writer, REG_RBP, "");
 	emit_mov_reg_reg(ctx->writer, REG_RBP, REG_RSP, "");
 	codegen_env_enter_scope(ctx->env);
@@ -379,8 +879,26 @@ static void generate_function_body(CodeGenContext *ctx,
 	emit_push_reg(ctx->writer, REG_R12, "push the closure pointer");
 	codegen_env_add_stack_space(ctx->env, 8);
 
-	StringArray *params = node->function.param_names;
-	guint num_params = params->_array->len;
+	NodeArray *body = node->function.body;
+	guint body_len = body->_array->len;
+	int saved_num_local_regs = ctx->num_local_regs;
+	int saved_next_local_reg = ctx->next_local_reg;
+	int max_live = 0;
+	for (guint i = 0; i < body_len; i++)
+	{
+		Node *body_expr = g_ptr_array_index(body->_array, i);
+		max_live = MAX(max_live, codegen_max_live_locals(body_expr));
+	}
+	ctx->num_local_regs = MIN(max_live, NUM_LOCAL_REGISTERS);
+	ctx->next_local_reg = 0;
+	for (int i = 0; i < ctx->num_local_regs; i++)
+	{
+		emit_push_reg(ctx->writer, LOCAL_REGS[i],
+					  "save %s for locals",
+					  reg_to_string(LOCAL_REGS[i]));
+		codegen_env_add_stack_space(ctx->env, 8);
+	}
+
 	for (guint i = 0; i < num_params; i++)
 	{
 		const char *param_name = string_array_index(params, i);
@@ -415,137 +933,165 @@ static void generate_function_body(CodeGenContext *ctx,
 		codegen_env_add_free_variable(ctx->env, name, i);
 	}
 
-	NodeArray *body = node->function.body;
-	for (guint i = 0; i < body->_array->len; i++)
+	bool was_in_function = ctx->in_function;
+	ctx->in_function = true;
+	GHashTable *saved_stack_closures = ctx->stack_closures;
+	ctx->stack_closures = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (guint i = 0; i < body_len; i++)
 	{
-		generate_node(ctx, g_ptr_array_index(body->_array, i));
+		Node *body_expr = g_ptr_array_index(body->_array, i);
+		if (i == body_len - 1)
+		{
+			generate_tail_node(ctx, body_expr);
+		}
+		else
+		{
+			generate_node(ctx, body_expr);
+		}
 	}
 
+	codegen_restore_local_regs(ctx);
+	ctx->in_function = was_in_function;
+	g_hash_table_destroy(ctx->stack_closures);
+	ctx->stack_closures = saved_stack_closures;
+	ctx->num_local_regs = saved_num_local_regs;
+	ctx->next_local_reg = saved_next_local_reg;
 	codegen_env_exit_scope(ctx->env);
 
-	emit_pop_reg(ctx->writer, REG_R12, "Restore the closure pointer");
 	emit_mov_reg_reg(ctx->writer, REG_RSP, REG_RBP, "");
 	emit_pop_reg(ctx->writer, REG_RBP, "");
 	emit_ret(ctx->writer, "");
+
+	emit_label(ctx->writer, arity_error_label, "");
+	emit_mov_reg_reg(ctx->writer, REG_RDI, REG_R12, "closure");
+	emit_mov_reg_reg(ctx->writer, REG_RSI, ARG_COUNT_REG,
+					 "argument count");
+	emit_call_label(ctx->writer, "lisp_arity_error",
+					"does not return");
+	asm_file_writer_end_function(ctx->writer);
+
+	g_free(unchecked_label);
+	g_free(arity_error_label);
+}
+
+static size_t codegen_closure_size(Node *fn_node)
+{
+	guint num_free = fn_node->function.free_var_names->_array->len;
+	return sizeof(LispClosureObject) + num_free * sizeof(LispValue *);
+}
+
+static void codegen_emit_closure_alloc(CodeGenContext *ctx,
+									   size_t closure_size)
+{
+	int label_num = get_next_label();
+	char *slow_label = g_strdup_printf("L_alloc_slow_%d", label_num);
+	char *done_label = g_strdup_printf("L_alloc_done_%d", label_num);
+
+	if (gc_size_class(closure_size) != GC_LARGE_SIZE_CLASS)
+	{
+		codegen_emit_nursery_alloc(ctx, closure_size,
+								   GC_KIND_CLOSURE, slow_label);
+		emit_jmp(ctx->writer, done_label, "");
+	}
+	emit_label(ctx->writer, slow_label, "");
+	emit_mov_reg_imm(ctx->writer, REG_RDI, closure_size, "");
+	emit_mov_reg_imm(ctx->writer, REG_RSI, GC_KIND_CLOSURE, "");
+	emit_call_label(ctx->writer, "gc_alloc", "");
+	emit_label(ctx->writer, done_label, "");
+
+	g_free(slow_label);
+	g_free(done_label);
 }
 
+// Allocates the closure object, inline from the nursery or in the
+// current frame, and fills it in with plain stores. Loading a free
+// variable touches only the destination register, so each one is
+// copied straight into its slot. A frame-allocated closure is not a
+// heap object, but the stack scan still finds its free variables.
 static void generate_closure_creation(CodeGenContext *ctx,
 									  Node *node,
 									  const char *func_label,
-									  const char *self_name)
+									  const char *self_name,
+									  bool on_stack)
 {
 	StringArray *free_vars = node->function.free_var_names;
 	guint num_free = free_vars->_array->len;
+	StringArray *params = node->function.param_names;
+	guint num_params = params->_array->len;
+	size_t closure_size = codegen_closure_size(node);
 
-	int rsp_val = codegen_env_get_stack_offset(ctx->env);
-	guint free_var_stack_space = num_free * sizeof(LispValue *);
-	codegen_env_add_stack_space(ctx->env, free_var_stack_space);
+	if (on_stack)
+	{
+		emit_sub_rsp(ctx->writer, closure_size,
+					 "closure object in the frame");
+		emit_mov_reg_reg(ctx->writer, REG_RAX, REG_RSP, "");
+	}
+	else
+	{
+		codegen_emit_closure_alloc(ctx, closure_size);
+	}
 
-	for (int i = num_free - 1; i >= 0; i--)
+	emit_mov_reg_imm(ctx->writer, REG_RCX, LISP_CLOSURE, "");
+	emit_mov_membase_reg(ctx->writer, REG_RAX,
+						 offsetof(LispClosureObject, type), REG_RCX,
+						 "");
+	emit_mov_reg_label(ctx->writer, REG_RCX, func_label, "");
+	emit_mov_membase_reg(ctx->writer, REG_RAX,
+						 offsetof(LispClosureObject, code_ptr),
+						 REG_RCX, "code pointer");
+	emit_mov_reg_imm(ctx->writer, REG_RCX, num_params, "");
+	emit_mov_membase_reg(ctx->writer, REG_RAX,
+						 offsetof(LispClosureObject, arity), REG_RCX,
+						 "arity");
+	emit_mov_reg_imm(ctx->writer, REG_RCX, num_free, "");
+	emit_mov_membase_reg(ctx->writer, REG_RAX,
+						 offsetof(LispClosureObject, num_free_vars),
+						 REG_RCX, "num_free_vars");
+
+	for (guint i = 0; i < num_free; i++)
 	{
 		const char *free_var_name = string_array_index(free_vars, i);
+		int slot_offset = offsetof(LispClosureObject, free_vars) +
+						  i * sizeof(LispValue *);
 
 		if (self_name && strcmp(free_var_name, self_name) == 0)
 		{
-			emit_push_imm(ctx->writer, 0,
-						  "push self reference for recursion");
+			emit_mov_membase_reg(ctx->writer, REG_RAX, slot_offset,
+								 REG_RAX,
+								 "self reference for recursion");
+			continue;
 		}
-		else
-		{
-			const VarLocation *loc =
-				codegen_env_lookup(ctx->env, free_var_name);
-			if (!loc)
-			{
-				printf("Free variable '%s' not found in codegen env",
-					   free_var_name);
-				exit(1);
-			}
 
-			switch (loc->type)
-			{
-			case VAR_LOCATION_GLOBAL:
-				emit_push_global(
-					ctx->writer, loc->global_label,
-					"push global free var onto the stack");
-				break;
-			case VAR_LOCATION_STACK:
-				emit_mov_reg_membase(ctx->writer, REG_RDI, REG_RBP,
-									 loc->stack_offset, "");
-				emit_call_label(ctx->writer, "lispcell_create", "");
-				emit_mov_reg_reg(ctx->writer, REG_RDI, REG_RAX,
-								 "load created lispcell as argument");
-				emit_call_label(ctx->writer, "lispvalue_create_cell",
-								"");
-				emit_push_reg(ctx->writer, REG_RAX,
-							  "push stack freevar onto the stack");
-				break;
-			case VAR_LOCATION_ENV:
-				int64_t env_offset =
-					sizeof(LispClosureObject) +
-					loc->env_index * sizeof(LispValue *);
-				emit_mov_reg_membase(
-					ctx->writer, REG_RAX, REG_R12, env_offset,
-					"load free variable from closure at r12, offset "
-					"by LispClosureObject (size=%d) ",
-					sizeof(LispClosureObject));
-				emit_push_reg(ctx->writer, REG_RAX,
-							  "push env free var onto the stack");
-				break;
-			}
+		const VarLocation *loc =
+			codegen_env_lookup(ctx->env, free_var_name);
+		if (!loc)
+		{
+			printf("Free variable '%s' not found in codegen env",
+				   free_var_name);
+			exit(1);
 		}
-	}
-
-	emit_mov_reg_label(ctx->writer, ARGUMENT_REGS[0], func_label,
-					   "arg 1 : function pointer");
-	StringArray *params = node->function.param_names;
-	guint num_params = params->_array->len;
-	emit_mov_reg_imm(ctx->writer, ARGUMENT_REGS[1], num_params,
-					 "arg 2: num_params");
-	emit_mov_reg_imm(ctx->writer, ARGUMENT_REGS[2], num_free,
-					 "arg 3: num_free");
-
-	const enum Register variadic_regs[] = {REG_RCX, REG_R8, REG_R9};
-	int num_variadic_regs =
-		sizeof(variadic_regs) / sizeof(variadic_regs[0]);
-
-	const guint num_reg_args =
-		(num_free < num_variadic_regs) ? num_free : num_variadic_regs;
-	for (guint i = 0; i < num_reg_args; i++)
-	{
-		emit_pop_reg(ctx->writer, variadic_regs[i],
-					 "arg %d (%s): pop free var from stack", i + 4,
-					 reg_to_string(variadic_regs[i]));
-	}
-
-	guint num_stack_args =
-		(num_free > num_reg_args) ? (num_free - num_reg_args) : 0;
-	guint stack_space_to_clean = num_stack_args * 8;
-
-	emit_xor_reg_reg(
-		ctx->writer, REG_RAX, REG_RAX,
-		"ABI: zero RAX for variadic call. Otherwise the C ABI "
-		"interprets RAX as number of XMM registers used in call");
-
-	emit_call_label(ctx->writer, "lispvalue_create_closure", "");
-	if (stack_space_to_clean > 0)
-	{
-		emit_add_rsp(
-			ctx->writer, stack_space_to_clean,
-			"take free vars (and alignment padding) off the stack");
-		codegen_env_remove_stack_space(ctx->env,
-									   stack_space_to_clean);
+		codegen_load_variable(ctx, loc, REG_RCX);
+		emit_mov_membase_reg(ctx->writer, REG_RAX, slot_offset,
+							 REG_RCX, "free var '%s'", free_var_name);
 	}
 }
 
 static void generate_function_impl(CodeGenContext *ctx,
 								   Node *node,
-								   const char *self_name)
+								   const char *self_name,
+								   bool on_stack)
 {
 	assert(node->type == NODE_FUNCTION);
 
 	int original_stack_offset =
 		codegen_env_get_stack_offset(ctx->env);
-	int func_label_num = get_next_label();
+	KnownFunction *known =
+		self_name ? codegen_lookup_known_function(ctx, self_name)
+				  : NULL;
+	int func_label_num = (known && known->fn_node == node)
+							 ? known->label_num
+							 : get_next_label();
 	char *func_label = g_strdup_printf("L_func_%d", func_label_num);
 	char *end_func_label =
 		g_strdup_printf("L_func_end_%d", func_label_num);
@@ -554,67 +1100,86 @@ static void generate_function_impl(CodeGenContext *ctx,
 	generate_function_body(ctx, node, func_label, self_name);
 
 	emit_label(ctx->writer, end_func_label, "");
-	generate_closure_creation(ctx, node, func_label, self_name);
+	if (known && known->fn_node == node)
+	{
+		char *closure_label = codegen_static_closure_label(known);
+		emit_mov_reg_label(ctx->writer, REG_RAX, closure_label,
+						   "static closure");
+		g_free(closure_label);
+	}
+	else
+	{
+		generate_closure_creation(ctx, node, func_label, self_name,
+								  on_stack);
+	}
 
 	codegen_env_set_stack_offset(ctx->env, original_stack_offset);
+	if (on_stack)
+	{
+		codegen_env_add_stack_space(ctx->env,
+									codegen_closure_size(node));
+	}
 	g_free(func_label);
 	g_free(end_func_label);
 }
 
 static inline void
 codegen_load_global_variable(CodeGenContext *ctx,
-							 const VarLocation *loc)
+							 const VarLocation *loc,
+							 enum Register dest)
 {
-	emit_mov_reg_global(ctx->writer, REG_RAX, loc->global_label,
+	emit_mov_reg_global(ctx->writer, dest, loc->global_label,
 						"load global variable");
 }
 
 static inline void codegen_load_stack_variable(CodeGenContext *ctx,
-											   const VarLocation *loc)
+											   const VarLocation *loc,
+											   enum Register dest)
 {
-	emit_mov_reg_membase(ctx->writer, REG_RAX, REG_RBP,
+	emit_mov_reg_membase(ctx->writer, dest, REG_RBP,
 						 loc->stack_offset, "load stack variable");
 }
 
 static inline void codegen_load_free_variable(CodeGenContext *ctx,
-											  const VarLocation *loc)
+											  const VarLocation *loc,
+											  enum Register dest)
 {
 	int64_t free_var_offset = sizeof(LispClosureObject) +
 							  sizeof(LispValue *) * loc->env_index;
-	// The base register is R12, which is wrong.
-	emit_mov_reg_membase(ctx->writer, REG_RAX, REG_R12,
-						 free_var_offset, "load free (env) cell");
-	emit_mov_reg_membase(ctx->writer, REG_RAX, REG_RAX,
-						 sizeof(LispCell *),
-						 "load lispvalue from cell");
-	emit_mov_reg_membase(ctx->writer, REG_RAX, REG_RAX, 0, "");
+	emit_mov_reg_membase(ctx->writer, dest, REG_R12,
+						 free_var_offset, "load free (env) variable");
 }
 
-static void generate_variable(CodeGenContext *ctx, Node *node)
+static inline void
+codegen_load_register_variable(CodeGenContext *ctx,
+							   const VarLocation *loc,
+							   enum Register dest)
 {
-	assert(node->type == NODE_VARIABLE);
-
-	const VarLocation *loc =
-		codegen_env_lookup(ctx->env, node->variable.name);
-
-	if (!loc)
+	if (loc->reg != dest)
 	{
-		printf("Undefined variable '%s', should have been caught by "
-			   "parser?",
-			   node->variable.name);
-		exit(1);
+		emit_mov_reg_reg(ctx->writer, dest, loc->reg,
+						 "load register variable");
 	}
+}
 
+// Loads a variable into dest, touching no other register.
+static void codegen_load_variable(CodeGenContext *ctx,
+								  const VarLocation *loc,
+								  enum Register dest)
+{
 	switch (loc->type)
 	{
 	case VAR_LOCATION_GLOBAL:
-		codegen_load_global_variable(ctx, loc);
+		codegen_load_global_variable(ctx, loc, dest);
 		break;
 	case VAR_LOCATION_STACK:
-		codegen_load_stack_variable(ctx, loc);
+		codegen_load_stack_variable(ctx, loc, dest);
 		break;
 	case VAR_LOCATION_ENV:
-		codegen_load_free_variable(ctx, loc);
+		codegen_load_free_variable(ctx, loc, dest);
+		break;
+	case VAR_LOCATION_REGISTER:
+		codegen_load_register_variable(ctx, loc, dest);
 		break;
 	default:
 		printf("Undefined variable type '%d'", loc->type);
@@ -622,36 +1187,113 @@ static void generate_variable(CodeGenContext *ctx, Node *node)
 	}
 }
 
-static void generate_let(CodeGenContext *ctx, Node *node)
+static const VarLocation *codegen_lookup_variable(CodeGenContext *ctx,
+												  Node *node)
+{
+	const VarLocation *loc =
+		codegen_env_lookup(ctx->env, node->variable.name);
+
+	if (!loc)
+	{
+		printf("Undefined variable '%s', should have been caught by "
+			   "parser?",
+			   node->variable.name);
+		exit(1);
+	}
+	return loc;
+}
+
+// Loads a variable reference into dest. A known function is never
+// rebound, so its value is the address of its static closure.
+static void codegen_load_named_variable(CodeGenContext *ctx,
+										Node *node,
+										enum Register dest)
+{
+	KnownFunction *known =
+		codegen_lookup_known_function(ctx, node->variable.name);
+	if (known)
+	{
+		char *closure_label = codegen_static_closure_label(known);
+		emit_mov_reg_label(ctx->writer, dest, closure_label,
+						   "closure of '%s'", node->variable.name);
+		g_free(closure_label);
+		return;
+	}
+	codegen_load_variable(ctx, codegen_lookup_variable(ctx, node),
+						  dest);
+}
+
+static void generate_variable(CodeGenContext *ctx, Node *node)
+{
+	assert(node->type == NODE_VARIABLE);
+
+	codegen_load_named_variable(ctx, node, REG_RAX);
+}
+
+static void generate_let(CodeGenContext *ctx, Node *node, bool tail)
 {
 	assert(node->type == NODE_LET);
 
 	codegen_env_enter_scope(ctx->env);
 
+	int first_local_reg = ctx->next_local_reg;
+	guint stack_bytes = 0;
 	VarBindingArray *bindings = node->let.bindings;
 	for (guint i = 0; i < bindings->_array->len; i++)
 	{
 		VarBinding *binding = g_ptr_array_index(bindings->_array, i);
-		generate_node(ctx, binding->value_expr);
+		if (codegen_is_stack_closure_binding(node, i))
+		{
+			generate_function_impl(ctx, binding->value_expr, NULL,
+								   true);
+			stack_bytes += codegen_closure_size(binding->value_expr);
+			g_hash_table_add(ctx->stack_closures, binding->name);
+		}
+		else
+		{
+			generate_node(ctx, binding->value_expr);
+		}
+		if (ctx->next_local_reg < ctx->num_local_regs)
+		{
+			enum Register reg = LOCAL_REGS[ctx->next_local_reg++];
+			emit_mov_reg_reg(ctx->writer, reg, REG_RAX,
+							 "register variable %s", binding->name);
+			codegen_env_add_register_variable(ctx->env, binding->name,
+											  reg);
+			continue;
+		}
 		emit_push_reg(ctx->writer, REG_RAX, "push stack variable %s",
 					  binding->name);
 		codegen_env_add_stack_variable(ctx->env, binding->name);
+		stack_bytes += sizeof(LispValue *);
 	}
 
 	NodeArray *body = node->let.body;
-	for (guint i = 0; i < body->_array->len; i++)
+	guint body_len = body->_array->len;
+	for (guint i = 0; i < body_len; i++)
 	{
 		Node *body_expr = g_ptr_array_index(body->_array, i);
-		generate_node(ctx, body_expr);
+		if (tail && i == body_len - 1)
+		{
+			generate_tail_node(ctx, body_expr);
+		}
+		else
+		{
+			generate_node(ctx, body_expr);
+		}
 	}
 
-	guint num_bindings = bindings->_array->len;
-	if (num_bindings > 0)
+	ctx->next_local_reg = first_local_reg;
+	for (guint i = 0; i < bindings->_array->len; i++)
 	{
-		guint space_to_reclaim = num_bindings * sizeof(LispValue *);
-		emit_add_rsp(ctx->writer, space_to_reclaim,
+		VarBinding *binding = g_ptr_array_index(bindings->_array, i);
+		g_hash_table_remove(ctx->stack_closures, binding->name);
+	}
+	if (stack_bytes > 0)
+	{
+		emit_add_rsp(ctx->writer, stack_bytes,
 					 "take let variables off the stack");
-		codegen_env_remove_stack_space(ctx->env, space_to_reclaim);
+		codegen_env_remove_stack_space(ctx->env, stack_bytes);
 	}
 
 	codegen_env_exit_scope(ctx->env);
@@ -659,7 +1301,129 @@ static void generate_let(CodeGenContext *ctx, Node *node)
 
 static void generate_function(CodeGenContext *ctx, Node *node)
 {
-	generate_function_impl(ctx, node, NULL);
+	generate_function_impl(ctx, node, NULL, false);
+}
+
+// Emits a LispValue of the given type in the data section. The words
+// of its `as` union are given as operands, in order; any left over
+// are zero.
+static void codegen_emit_static_value(CodeGenContext *ctx,
+									  const char *label,
+									  LispValueType type,
+									  const char **payload,
+									  guint num_payload)
+{
+	const char *words[sizeof(LispValue) / sizeof(int64_t)];
+	guint first = offsetof(LispValue, as) / sizeof(int64_t);
+	assert(first + num_payload <= G_N_ELEMENTS(words));
+
+	char *type_word = g_strdup_printf("%d", type);
+	for (guint i = 0; i < G_N_ELEMENTS(words); i++)
+	{
+		words[i] = "0";
+	}
+	words[offsetof(LispValue, type) / sizeof(int64_t)] = type_word;
+	for (guint i = 0; i < num_payload; i++)
+	{
+		words[first + i] = payload[i];
+	}
+
+	emit_data_align(ctx->writer, sizeof(int64_t), NULL);
+	emit_data_dq_labels(ctx->writer, label, words,
+						G_N_ELEMENTS(words), NULL);
+	g_free(type_word);
+}
+
+// Returns the label of a static symbol object named name, emitting it
+// the first time the name is seen.
+static const char *codegen_symbol_constant(CodeGenContext *ctx,
+										   const char *name)
+{
+	const char *label =
+		g_hash_table_lookup(ctx->symbol_constants, name);
+	if (label)
+	{
+		return label;
+	}
+
+	int label_num = get_next_label();
+	char *new_label = g_strdup_printf("L_symbol_%d", label_num);
+	char *name_label = g_strdup_printf("L_symbol_%d_name", label_num);
+	const char *payload[] = {name_label};
+
+	emit_data_string(ctx->writer, name_label, name, "symbol %s",
+					 name);
+	codegen_emit_static_value(ctx, new_label, LISP_SYMBOL, payload,
+							  G_N_ELEMENTS(payload));
+	g_hash_table_insert(ctx->symbol_constants, g_strdup(name),
+						new_label);
+	g_ptr_array_add(ctx->static_symbols, new_label);
+	g_free(name_label);
+	return new_label;
+}
+
+// Returns the operand a quoted datum evaluates to: an immediate for
+// fixnums, booleans and the empty list, otherwise the label of a
+// static object. Lists are laid out back to front so every cons can
+// name its cdr.
+static char *codegen_quoted_value(CodeGenContext *ctx, Node *datum)
+{
+	assert(datum->type == NODE_QUOTE);
+	Node *atom = datum->quote.quoted_expr;
+	if (atom)
+	{
+		switch (atom->literal.lit_type)
+		{
+		case LIT_INT:
+			return g_strdup_printf(
+				"%ld", (long)lisp_make_fixnum(atom->literal.i_val));
+		case LIT_BOOL:
+			return g_strdup_printf("%d", atom->literal.b_val
+											 ? LISP_IMM_TRUE
+											 : LISP_IMM_FALSE);
+		case LIT_FLOAT:
+			return g_strdup(
+				codegen_float_constant(ctx, atom->literal.f_val));
+		case LIT_SYMBOL:
+			return g_strdup(
+				codegen_symbol_constant(ctx, atom->literal.s_val));
+		default:
+			fprintf(stderr,
+					"Codegen Error: Unsupported quoted literal type "
+					"%d\n",
+					atom->literal.lit_type);
+			exit(1);
+		}
+	}
+
+	NodeArray *elements = datum->quote.elements;
+	char *tail = g_strdup_printf("%d", LISP_IMM_NIL);
+	for (guint i = elements->_array->len; i-- > 0;)
+	{
+		char *car =
+			codegen_quoted_value(ctx, node_array_index(elements, i));
+		const char *payload[] = {car, tail};
+
+		char *label = g_strdup_printf("L_cons_%d", get_next_label());
+		codegen_emit_static_value(ctx, label, LISP_CONS, payload,
+								  G_N_ELEMENTS(payload));
+		g_free(car);
+		g_free(tail);
+		tail = label;
+	}
+	return tail;
+}
+
+// A quoted datum is built entirely at compile time, in a read-only
+// section; evaluating it is a single mov.
+static void generate_quote(CodeGenContext *ctx, Node *node)
+{
+	emit_data_section(ctx->writer, ".rodata", "quoted data");
+	char *value = codegen_quoted_value(ctx, node);
+	emit_data_section(ctx->writer, ".data", NULL);
+
+	emit_mov_reg_label(ctx->writer, REG_RAX, value, "quoted datum");
+	g_free(value);
 }
 
 static inline int min(int a, int b) { return (a < b) ? a : b; }
@@ -677,6 +1441,94 @@ static void codegen_push_arguments(CodeGenContext *ctx,
 	}
 }
 
+// Operands that can be materialised straight into any register
+// without a call or a scratch register.
+static bool codegen_is_simple_operand(Node *node)
+{
+	if (node->type == NODE_VARIABLE)
+	{
+		return true;
+	}
+	return node->type == NODE_LITERAL &&
+		   (node->literal.lit_type == LIT_INT ||
+			node->literal.lit_type == LIT_BOOL);
+}
+
+static void codegen_load_simple_operand(CodeGenContext *ctx,
+										Node *node,
+										enum Register dest)
+{
+	if (node->type == NODE_VARIABLE)
+	{
+		codegen_load_named_variable(ctx, node, dest);
+	}
+	else if (node->literal.lit_type == LIT_INT)
+	{
+		int64_t tagged =
+			(int64_t)lisp_make_fixnum(node->literal.i_val);
+		emit_mov_reg_imm(ctx->writer, dest, tagged,
+						 "fixnum literal %d", node->literal.i_val);
+	}
+	else
+	{
+		emit_mov_reg_imm(ctx->writer, dest,
+						 node->literal.b_val ? LISP_IMM_TRUE
+											 : LISP_IMM_FALSE,
+						 "bool literal");
+	}
+}
+
+// Evaluates the arguments that need RAX (calls, allocations) and
+// pushes them: all stack-passed arguments, then the non-simple
+// register arguments. Simple register arguments are left for
+// codegen_load_register_arguments.
+static void codegen_push_complex_arguments(CodeGenContext *ctx,
+										   NodeArray *args)
+{
+	int num_args = args->_array->len;
+	for (int i = num_args - 1; i >= 0; i--)
+	{
+		Node *arg_node = g_ptr_array_index(args->_array, i);
+		if (i < NUM_ARGUMENT_REGISTERS &&
+			codegen_is_simple_operand(arg_node))
+		{
+			continue;
+		}
+		generate_node(ctx, arg_node);
+		emit_push_reg(ctx->writer, REG_RAX, "push arg %d", i);
+		codegen_env_add_stack_space(ctx->env, 8);
+	}
+}
+
+// Fills the argument registers: pops what
+// codegen_push_complex_arguments pushed, then loads simple arguments
+// directly. Leaves RAX untouched.
+static void codegen_load_register_arguments(CodeGenContext *ctx,
+											NodeArray *args)
+{
+	int num_args_in_regs =
+		min(args->_array->len, NUM_ARGUMENT_REGISTERS);
+	for (int i = 0; i < num_args_in_regs; i++)
+	{
+		Node *arg_node = g_ptr_array_index(args->_array, i);
+		if (!codegen_is_simple_operand(arg_node))
+		{
+			emit_pop_reg(ctx->writer, ARGUMENT_REGS[i],
+						 "pop arg %d into register", i + 1);
+			codegen_env_remove_stack_space(ctx->env, 8);
+		}
+	}
+	for (int i = 0; i < num_args_in_regs; i++)
+	{
+		Node *arg_node = g_ptr_array_index(args->_array, i);
+		if (codegen_is_simple_operand(arg_node))
+		{
+			codegen_load_simple_operand(ctx, arg_node,
+										ARGUMENT_REGS[i]);
+		}
+	}
+}
+
 static void codegen_cleanup_stack_args(CodeGenContext *ctx,
 									   int num_args)
 {
@@ -692,23 +1544,214 @@ static void codegen_cleanup_stack_args(CodeGenContext *ctx,
 	}
 }
 
+// Emits (op RDI RSI) for + - * with an inline fast path when both
+// operands are fixnums, falling back to the runtime builtin on a
+// boxed operand or on overflow. Result in RAX; clobbers RCX.
+static void codegen_emit_fixnum_arith(CodeGenContext *ctx,
+									  char op,
+									  const char *builtin_c_label)
+{
+	int label_num = get_next_label();
+	char *slow_label = g_strdup_printf("L_arith_slow_%d", label_num);
+	char *done_label = g_strdup_printf("L_arith_done_%d", label_num);
+
+	emit_mov_reg_reg(ctx->writer, REG_RAX, REG_RDI, "");
+	emit_and_reg_reg(ctx->writer, REG_RAX, REG_RSI, "");
+	emit_test_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_TAG,
+					  "both operands fixnums?");
+	emit_je(ctx->writer, slow_label, "");
+
+	emit_mov_reg_reg(ctx->writer, REG_RAX, REG_RDI, "");
+	switch (op)
+	{
+	case '+':
+		emit_sub_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_TAG,
+						 "drop one tag bit");
+		emit_add_reg_reg(ctx->writer, REG_RAX, REG_RSI, "");
+		emit_jo(ctx->writer, slow_label, "");
+		break;
+	case '-':
+		emit_sub_reg_reg(ctx->writer, REG_RAX, REG_RSI, "");
+		emit_jo(ctx->writer, slow_label, "");
+		emit_or_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_TAG,
+						"retag");
+		break;
+	case '*':
+		emit_sar_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_SHIFT,
+						 "untag lhs");
+		emit_mov_reg_reg(ctx->writer, REG_RCX, REG_RSI, "");
+		emit_sub_reg_imm(ctx->writer, REG_RCX, LISP_FIXNUM_TAG,
+						 "rhs as 2*n");
+		emit_imul_reg_reg(ctx->writer, REG_RAX, REG_RCX, "");
+		emit_jo(ctx->writer, slow_label, "");
+		emit_or_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_TAG,
+						"retag");
+		break;
+	default:
+		assert(false && "Unsupported fixnum operator");
+	}
+	emit_jmp(ctx->writer, done_label, "");
+
+	emit_label(ctx->writer, slow_label, "");
+	emit_call_label(ctx->writer, builtin_c_label, "");
+	emit_label(ctx->writer, done_label, "");
+
+	g_free(slow_label);
+	g_free(done_label);
+}
+
+// Emits (op RDI RSI), inline for fixnums if op is non-zero and as a
+// plain runtime call otherwise.
+static void codegen_emit_arith(CodeGenContext *ctx,
+							   char op,
+							   const char *builtin_c_label)
+{
+	if (op)
+	{
+		codegen_emit_fixnum_arith(ctx, op, builtin_c_label);
+	}
+	else
+	{
+		emit_call_label(ctx->writer, builtin_c_label, "");
+	}
+}
+
+// Returns the operator character if op_name has an inline fixnum
+// fast path, or 0 otherwise.
+static char codegen_fixnum_arith_op(const char *op_name)
+{
+	if (strcmp(op_name, "+") == 0 || strcmp(op_name, "-") == 0 ||
+		strcmp(op_name, "*") == 0)
+	{
+		return op_name[0];
+	}
+	return 0;
+}
+
+typedef void (*JumpEmitter)(AsmFileWriter *writer,
+							const char *label,
+							const char *comment_fmt,
+							...);
+
+// A comparison builtin with an inline fixnum path. Tagging keeps the
+// order of the integers, so tagged fixnums compare as they are.
+typedef struct
+{
+	const char *op_name;
+	JumpEmitter jump_if_false;
+} FixnumComparison;
+
+static const FixnumComparison FIXNUM_COMPARISONS[] = {
+	{"=", emit_jne}, {"<", emit_jge},  {">", emit_jle},
+	{"<=", emit_jg}, {">=", emit_jl},
+};
+
+// Returns the comparison node performs, or NULL if it is not a
+// two-argument call to a comparison builtin.
+static const FixnumComparison *
+codegen_fixnum_comparison(CodeGenContext *ctx, Node *node)
+{
+	if (node->type != NODE_CALL ||
+		node->call.fn->type != NODE_VARIABLE ||
+		node->call.args->_array->len != 2)
+	{
+		return NULL;
+	}
+	const char *name = node->call.fn->variable.name;
+	if (!string_to_string_map_lookup(ctx->builtin_func_map, name))
+	{
+		return NULL;
+	}
+	for (guint i = 0; i < G_N_ELEMENTS(FIXNUM_COMPARISONS); i++)
+	{
+		if (strcmp(name, FIXNUM_COMPARISONS[i].op_name) == 0)
+		{
+			return &FIXNUM_COMPARISONS[i];
+		}
+	}
+	return NULL;
+}
+
+// Compares RDI with RSI and jumps to false_label if the comparison
+// does not hold, falling through if it does. Two fixnums are compared
+// inline; anything else goes through the runtime builtin, whose
+// boolean is tested without being kept.
+static void codegen_emit_fixnum_compare(CodeGenContext *ctx,
+										const FixnumComparison *cmp,
+										const char *builtin_c_label,
+										const char *false_label)
+{
+	int label_num = get_next_label();
+	char *slow_label = g_strdup_printf("L_cmp_slow_%d", label_num);
+	char *true_label = g_strdup_printf("L_cmp_true_%d", label_num);
+
+	emit_mov_reg_reg(ctx->writer, REG_RAX, REG_RDI, "");
+	emit_and_reg_reg(ctx->writer, REG_RAX, REG_RSI, "");
+	emit_test_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_TAG,
+					  "both operands fixnums?");
+	emit_je(ctx->writer, slow_label, "");
+	emit_cmp_reg_reg(ctx->writer, REG_RDI, REG_RSI, "");
+	cmp->jump_if_false(ctx->writer, false_label, "not %s",
+					   cmp->op_name);
+	emit_jmp(ctx->writer, true_label, "");
+
+	emit_label(ctx->writer, slow_label, "");
+	emit_call_label(ctx->writer, builtin_c_label, "");
+	emit_cmp_reg_imm(ctx->writer, REG_RAX, LISP_IMM_FALSE, "");
+	emit_je(ctx->writer, false_label, "");
+	emit_label(ctx->writer, true_label, "");
+
+	g_free(slow_label);
+	g_free(true_label);
+}
+
+// Evaluates a comparison as a value: the branch picks the boolean
+// immediate.
+static void codegen_emit_comparison_value(CodeGenContext *ctx,
+										  const FixnumComparison *cmp,
+										  const char *builtin_c_label)
+{
+	int label_num = get_next_label();
+	char *false_label = g_strdup_printf("L_cmp_false_%d", label_num);
+	char *done_label = g_strdup_printf("L_cmp_done_%d", label_num);
+
+	codegen_emit_fixnum_compare(ctx, cmp, builtin_c_label,
+								false_label);
+	emit_mov_reg_imm(ctx->writer, REG_RAX, LISP_IMM_TRUE, "#t");
+	emit_jmp(ctx->writer, done_label, "");
+	emit_label(ctx->writer, false_label, "");
+	emit_mov_reg_imm(ctx->writer, REG_RAX, LISP_IMM_FALSE, "#f");
+	emit_label(ctx->writer, done_label, "");
+
+	g_free(false_label);
+	g_free(done_label);
+}
+
 static void generate_standard_builtin_call(
 	CodeGenContext *ctx, Node *call_node, const char *builtin_c_label)
 {
 	NodeArray *args = call_node->call.args;
 	int num_args = args->_array->len;
 
-	codegen_push_arguments(ctx, args);
+	codegen_push_complex_arguments(ctx, args);
+	codegen_load_register_arguments(ctx, args);
 
-	int num_args_in_regs = min(num_args, NUM_ARGUMENT_REGISTERS);
-	for (guint i = 0; i < num_args_in_regs; i++)
+	const char *op_name = call_node->call.fn->variable.name;
+	char op = codegen_fixnum_arith_op(op_name);
+	const FixnumComparison *cmp =
+		codegen_fixnum_comparison(ctx, call_node);
+	if (op && num_args == 2)
 	{
-		emit_pop_reg(ctx->writer, ARGUMENT_REGS[i],
-					 "pop arg %d into register", i + 1);
-		codegen_env_remove_stack_space(ctx->env, 8);
+		codegen_emit_fixnum_arith(ctx, op, builtin_c_label);
+	}
+	else if (cmp)
+	{
+		codegen_emit_comparison_value(ctx, cmp, builtin_c_label);
+	}
+	else
+	{
+		emit_call_label(ctx->writer, builtin_c_label, "");
 	}
-
-	emit_call_label(ctx->writer, builtin_c_label, "");
 
 	codegen_cleanup_stack_args(ctx, num_args);
 }
@@ -718,6 +1761,8 @@ static void generate_variadic_builtin_call(
 {
 	NodeArray *args = call_node->call.args;
 	int num_args = args->_array->len;
+	const char *op_name = call_node->call.fn->variable.name;
+	char op = codegen_fixnum_arith_op(op_name);
 
 	codegen_push_arguments(ctx, args);
 
@@ -727,7 +1772,7 @@ static void generate_variadic_builtin_call(
 	emit_pop_reg(ctx->writer, REG_RSI, "pop arg 2 off the stack");
 	codegen_env_remove_stack_space(ctx->env, 8);
 
-	emit_call_label(ctx->writer, builtin_c_label, "");
+	codegen_emit_arith(ctx, op, builtin_c_label);
 
 	for (guint i = 2; i < num_args; i++)
 	{
@@ -737,29 +1782,110 @@ static void generate_variadic_builtin_call(
 		emit_pop_reg(ctx->writer, REG_RSI, "pop arg %d off the stack",
 					 i + 1);
 		codegen_env_remove_stack_space(ctx->env, 8);
-		emit_call_label(ctx->writer, builtin_c_label, "");
+		codegen_emit_arith(ctx, op, builtin_c_label);
+	}
+}
+
+// Calls a known function at its unchecked entry: the argument count
+// was matched at compile time. Its body never reads R12, since it
+// has no free variables, so no closure is loaded.
+static void generate_known_function_call(CodeGenContext *ctx,
+										 Node *call_node,
+										 KnownFunction *known,
+										 bool reuse_frame)
+{
+	NodeArray *args = call_node->call.args;
+	char *func_label =
+		g_strdup_printf("L_func_%d_unchecked", known->label_num);
+
+	codegen_push_complex_arguments(ctx, args);
+	codegen_load_register_arguments(ctx, args);
+
+	if (reuse_frame)
+	{
+		codegen_restore_local_regs(ctx);
+		emit_mov_reg_reg(ctx->writer, REG_RSP, REG_RBP,
+						 "tail call: drop our frame");
+		emit_pop_reg(ctx->writer, REG_RBP, "");
+		emit_jmp(ctx->writer, func_label, "tail call %s",
+				 call_node->call.fn->variable.name);
+		g_free(func_label);
+		return;
+	}
+
+	emit_call_label(ctx->writer, func_label, "call %s",
+					call_node->call.fn->variable.name);
+	g_free(func_label);
+
+	codegen_cleanup_stack_args(ctx, args->_array->len);
+	if (ctx->in_function)
+	{
+		emit_mov_reg_membase(ctx->writer, REG_R12, REG_RBP,
+							 -(int)sizeof(LispValue *),
+							 "reload our own closure pointer");
 	}
 }
 
 static void generate_lisp_closure_call(CodeGenContext *ctx,
-									   Node *call_node)
+									   Node *call_node,
+									   bool tail)
 {
 	NodeArray *args = call_node->call.args;
 	int num_args = args->_array->len;
+	// Stack-passed arguments would have to be moved into the
+	// caller's incoming area, which may be smaller; keep those as
+	// ordinary calls.
+	bool reuse_frame = tail && num_args <= NUM_ARGUMENT_REGISTERS;
+
+	// The callee's closure object must outlive the frame.
+	Node *fn = call_node->call.fn;
+	if (fn->type == NODE_VARIABLE &&
+		g_hash_table_contains(ctx->stack_closures, fn->variable.name))
+	{
+		reuse_frame = false;
+	}
+	KnownFunction *known =
+		(fn->type == NODE_VARIABLE)
+			? codegen_lookup_known_function(ctx, fn->variable.name)
+			: NULL;
+	if (known)
+	{
+		StringArray *params = known->fn_node->function.param_names;
+		guint arity = params->_array->len;
+		if (arity == (guint)num_args)
+		{
+			generate_known_function_call(ctx, call_node, known,
+										 reuse_frame);
+			return;
+		}
+		// Left to trap at run time through the checked entry.
+		fprintf(stderr,
+				"Codegen Warning: '%s' takes %u arguments, called "
+				"with %d\n",
+				fn->variable.name, arity, num_args);
+	}
 
-	codegen_push_arguments(ctx, args);
+	codegen_push_complex_arguments(ctx, args);
 
 	generate_node(ctx, call_node->call.fn);
 
+	// Simple arguments may still read free variables through our own
+	// closure pointer, so R12 is switched over last.
+	codegen_load_register_arguments(ctx, args);
 	emit_mov_reg_reg(ctx->writer, REG_R12, REG_RAX,
 					 "save closure pointer in R12");
+	emit_mov_reg_imm(ctx->writer, ARG_COUNT_REG, num_args,
+					 "argument count");
 
-	int num_args_in_regs = min(num_args, NUM_ARGUMENT_REGISTERS);
-	for (guint i = 0; i < num_args_in_regs; i++)
+	if (reuse_frame)
 	{
-		emit_pop_reg(ctx->writer, ARGUMENT_REGS[i],
-					 "pop arg %d into register", i + 1);
-		codegen_env_remove_stack_space(ctx->env, 8);
+		codegen_restore_local_regs(ctx);
+		emit_mov_reg_reg(ctx->writer, REG_RSP, REG_RBP,
+						 "tail call: drop our frame");
+		emit_pop_reg(ctx->writer, REG_RBP, "");
+		emit_jmp_membase(ctx->writer, REG_R12, sizeof(LispValue *),
+						 "tail call closure");
+		return;
 	}
 
 	emit_mov_reg_membase(ctx->writer, REG_RAX, REG_R12,
@@ -768,6 +1894,226 @@ static void generate_lisp_closure_call(CodeGenContext *ctx,
 	emit_call_reg(ctx->writer, REG_RAX, "call closure");
 
 	codegen_cleanup_stack_args(ctx, num_args);
+	if (ctx->in_function)
+	{
+		emit_mov_reg_membase(ctx->writer, REG_R12, REG_RBP,
+							 -(int)sizeof(LispValue *),
+							 "reload our own closure pointer");
+	}
+}
+
+// Float arithmetic trees. A call to + - * produces a float whenever
+// one of its first two operands is a float: that first step promotes
+// and every later step stays in doubles. Such trees are computed
+// unboxed in XMM registers and boxed once at the root.
+
+// Unboxed operands of a float tree that have to be evaluated as
+// ordinary values first; they are converted to doubles and parked on
+// the stack, leaf i at [rsp + 8 * i].
+typedef struct FloatLeaves
+{
+	GPtrArray *nodes;
+	guint next;
+} FloatLeaves;
+
+static const int NUM_XMM_REGISTERS = 16;
+
+static char codegen_float_arith_op(CodeGenContext *ctx, Node *node);
+
+static bool codegen_is_float_typed(CodeGenContext *ctx, Node *node)
+{
+	if (node->type == NODE_LITERAL)
+	{
+		return node->literal.lit_type == LIT_FLOAT;
+	}
+	return codegen_float_arith_op(ctx, node) != 0;
+}
+
+// Returns the operator of a float arithmetic call, or 0.
+static char codegen_float_arith_op(CodeGenContext *ctx, Node *node)
+{
+	if (node->type != NODE_CALL ||
+		node->call.fn->type != NODE_VARIABLE ||
+		node->call.args->_array->len < 2)
+	{
+		return 0;
+	}
+	const char *name = node->call.fn->variable.name;
+	if (!string_to_string_map_lookup(ctx->builtin_func_map, name))
+	{
+		return 0;
+	}
+	char op = strcmp(name, "/") == 0 ? '/'
+									 : codegen_fixnum_arith_op(name);
+	NodeArray *args = node->call.args;
+	Node *lhs = node_array_index(args, 0);
+	Node *rhs = node_array_index(args, 1);
+	if (op && (codegen_is_float_typed(ctx, lhs) ||
+			   codegen_is_float_typed(ctx, rhs)))
+	{
+		return op;
+	}
+	return 0;
+}
+
+static bool codegen_is_float_const(Node *node)
+{
+	return node->type == NODE_LITERAL &&
+		   (node->literal.lit_type == LIT_FLOAT ||
+			node->literal.lit_type == LIT_INT);
+}
+
+// XMM registers needed above the destination to compute node.
+static int codegen_float_regs_needed(CodeGenContext *ctx, Node *node)
+{
+	if (!codegen_float_arith_op(ctx, node))
+	{
+		return 0;
+	}
+	NodeArray *args = node->call.args;
+	Node *first = node_array_index(args, 0);
+	int needed = codegen_float_regs_needed(ctx, first);
+	for (guint i = 1; i < args->_array->len; i++)
+	{
+		Node *arg = node_array_index(args, i);
+		needed = MAX(needed, 1 + codegen_float_regs_needed(ctx, arg));
+	}
+	return needed;
+}
+
+static void codegen_collect_float_leaves(CodeGenContext *ctx,
+										 Node *node,
+										 GPtrArray *leaves)
+{
+	if (codegen_is_float_const(node))
+	{
+		return;
+	}
+	if (!codegen_float_arith_op(ctx, node))
+	{
+		g_ptr_array_add(leaves, node);
+		return;
+	}
+	NodeArray *args = node->call.args;
+	for (guint i = 0; i < args->_array->len; i++)
+	{
+		codegen_collect_float_leaves(ctx, node_array_index(args, i),
+									 leaves);
+	}
+}
+
+// Evaluates a leaf into RAX and pushes it as a double. Fixnums are
+// converted inline; anything else goes through the runtime, which
+// also rejects non-numbers.
+static void codegen_push_float_leaf(CodeGenContext *ctx, Node *leaf)
+{
+	int label_num = get_next_label();
+	char *slow_label = g_strdup_printf("L_unbox_slow_%d", label_num);
+	char *done_label = g_strdup_printf("L_unbox_done_%d", label_num);
+
+	generate_node(ctx, leaf);
+	emit_test_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_TAG,
+					  "fixnum?");
+	emit_je(ctx->writer, slow_label, "");
+	emit_sar_reg_imm(ctx->writer, REG_RAX, LISP_FIXNUM_SHIFT,
+					 "untag");
+	emit_cvtsi2sd_reg_reg(ctx->writer, REG_XMM0, REG_RAX, "");
+	emit_jmp(ctx->writer, done_label, "");
+	emit_label(ctx->writer, slow_label, "");
+	emit_mov_reg_reg(ctx->writer, REG_RDI, REG_RAX, "");
+	emit_call_label(ctx->writer, "lisp_unbox_double", "");
+	emit_label(ctx->writer, done_label, "");
+
+	emit_sub_reg_imm(ctx->writer, REG_RSP, sizeof(double), "");
+	emit_movsd_membase_reg(ctx->writer, REG_RSP, 0, REG_XMM0,
+						   "park unboxed operand");
+	codegen_env_add_stack_space(ctx->env, sizeof(double));
+
+	g_free(slow_label);
+	g_free(done_label);
+}
+
+// Computes node into XMM<depth>. Makes no calls, so the XMM registers
+// below depth stay live.
+static void codegen_emit_float_tree(CodeGenContext *ctx,
+									Node *node,
+									int depth,
+									FloatLeaves *leaves)
+{
+	enum Register dest = REG_XMM0 + depth;
+	if (codegen_is_float_const(node))
+	{
+		double f_val = (node->literal.lit_type == LIT_FLOAT)
+						   ? node->literal.f_val
+						   : (double)node->literal.i_val;
+		const char *label = codegen_float_constant(ctx, f_val);
+		char *operand = g_strdup_printf(
+			"%s + %zu", label, offsetof(LispValue, as.f_val));
+		emit_movsd_reg_global(ctx->writer, dest, operand, "%g",
+							  f_val);
+		g_free(operand);
+		return;
+	}
+
+	char op = codegen_float_arith_op(ctx, node);
+	if (!op)
+	{
+		guint slot = leaves->next++;
+		emit_movsd_reg_membase(ctx->writer, dest, REG_RSP,
+							   slot * sizeof(double),
+							   "unboxed operand %u", slot);
+		return;
+	}
+
+	NodeArray *args = node->call.args;
+	codegen_emit_float_tree(ctx, node_array_index(args, 0), depth,
+							leaves);
+	enum Register rhs = dest + 1;
+	for (guint i = 1; i < args->_array->len; i++)
+	{
+		codegen_emit_float_tree(ctx, node_array_index(args, i),
+								depth + 1, leaves);
+		switch (op)
+		{
+		case '+':
+			emit_addsd_reg_reg(ctx->writer, dest, rhs, "");
+			break;
+		case '-':
+			emit_subsd_reg_reg(ctx->writer, dest, rhs, "");
+			break;
+		case '*':
+			emit_mulsd_reg_reg(ctx->writer, dest, rhs, "");
+			break;
+		case '/':
+			emit_divsd_reg_reg(ctx->writer, dest, rhs, "");
+			break;
+		}
+	}
+}
+
+static void generate_float_arith(CodeGenContext *ctx, Node *node)
+{
+	FloatLeaves leaves = {.nodes = g_ptr_array_new(), .next = 0};
+	codegen_collect_float_leaves(ctx, node, leaves.nodes);
+
+	// Right to left, like ordinary call arguments; leaf 0 ends up on
+	// top of the stack.
+	for (int i = leaves.nodes->len - 1; i >= 0; i--)
+	{
+		codegen_push_float_leaf(ctx,
+								g_ptr_array_index(leaves.nodes, i));
+	}
+
+	codegen_emit_float_tree(ctx, node, 0, &leaves);
+
+	if (leaves.nodes->len > 0)
+	{
+		int parked = leaves.nodes->len * sizeof(double);
+		emit_add_rsp(ctx->writer, parked, "drop unboxed operands");
+		codegen_env_remove_stack_space(ctx->env, parked);
+	}
+	codegen_emit_box_xmm0(ctx);
+	g_ptr_array_free(leaves.nodes, TRUE);
 }
 
 static void generate_builtin_func_call(CodeGenContext *ctx,
@@ -776,9 +2122,17 @@ static void generate_builtin_func_call(CodeGenContext *ctx,
 {
 	const char *op_name = call_node->call.fn->variable.name;
 	const int num_args = call_node->call.args->_array->len;
+
+	if (codegen_float_arith_op(ctx, call_node) &&
+		codegen_float_regs_needed(ctx, call_node) < NUM_XMM_REGISTERS)
+	{
+		generate_float_arith(ctx, call_node);
+		return;
+	}
+
 	bool is_variadic_op =
 		(strcmp(op_name, "+") == 0 || strcmp(op_name, "*") == 0 ||
-		 strcmp(op_name, "-") == 0);
+		 strcmp(op_name, "-") == 0 || strcmp(op_name, "/") == 0);
 
 	if (is_variadic_op && num_args > 2)
 	{
@@ -792,7 +2146,7 @@ static void generate_builtin_func_call(CodeGenContext *ctx,
 	}
 }
 
-static void generate_call(CodeGenContext *ctx, Node *node)
+static void generate_call(CodeGenContext *ctx, Node *node, bool tail)
 {
 	assert(node->type == NODE_CALL);
 
@@ -809,11 +2163,25 @@ static void generate_call(CodeGenContext *ctx, Node *node)
 	}
 	else
 	{
-		generate_lisp_closure_call(ctx, node);
+		generate_lisp_closure_call(ctx, node, tail);
 	}
 }
 
-static void generate_if(CodeGenContext *ctx, Node *node)
+// Jumps to false_label if RAX is #f, nil or NULL, the values
+// lisp_is_truthy rejects. All three are plain words, so this is a
+// few compares instead of a call.
+static void codegen_emit_falsy_branch(CodeGenContext *ctx,
+									  const char *false_label)
+{
+	emit_cmp_reg_imm(ctx->writer, REG_RAX, LISP_IMM_FALSE, "#f?");
+	emit_je(ctx->writer, false_label, "");
+	emit_cmp_reg_imm(ctx->writer, REG_RAX, LISP_IMM_NIL, "nil?");
+	emit_je(ctx->writer, false_label, "");
+	emit_cmp_reg_imm(ctx->writer, REG_RAX, 0, "NULL?");
+	emit_je(ctx->writer, false_label, "");
+}
+
+static void generate_if(CodeGenContext *ctx, Node *node, bool tail)
 {
 	assert(node->type == NODE_IF);
 
@@ -821,24 +2189,50 @@ static void generate_if(CodeGenContext *ctx, Node *node)
 	char *else_label = g_strdup_printf("L_else_%d", label_num);
 	char *end_label = g_strdup_printf("L_end_if_%d", label_num);
 
-	generate_node(ctx, node->if_expr.condition);
-	emit_mov_reg_reg(ctx->writer, REG_RDI, REG_RAX, "load arg 1");
-	emit_call_label(ctx->writer, "lisp_is_truthy", "");
-	emit_cmp_reg_imm(ctx->writer, REG_RAX, 0, "");
-	emit_je(ctx->writer, else_label, "");
+	Node *condition = node->if_expr.condition;
+	const FixnumComparison *cmp =
+		codegen_fixnum_comparison(ctx, condition);
+	if (cmp)
+	{
+		// Branch on the comparison itself; no boolean is made.
+		NodeArray *args = condition->call.args;
+		codegen_push_complex_arguments(ctx, args);
+		codegen_load_register_arguments(ctx, args);
+		codegen_emit_fixnum_compare(
+			ctx, cmp,
+			string_to_string_map_lookup(ctx->builtin_func_map,
+										cmp->op_name),
+			else_label);
+	}
+	else
+	{
+		generate_node(ctx, condition);
+		codegen_emit_falsy_branch(ctx, else_label);
+	}
 
-	generate_node(ctx, node->if_expr.then_branch);
+	if (tail)
+	{
+		generate_tail_node(ctx, node->if_expr.then_branch);
+	}
+	else
+	{
+		generate_node(ctx, node->if_expr.then_branch);
+	}
 	emit_jmp(ctx->writer, end_label, "");
 
 	emit_label(ctx->writer, else_label, "");
-	if (node->if_expr.else_branch)
+	if (node->if_expr.else_branch && tail)
+	{
+		generate_tail_node(ctx, node->if_expr.else_branch);
+	}
+	else if (node->if_expr.else_branch)
 	{
 		generate_node(ctx, node->if_expr.else_branch);
 	}
 	else
 	{
-		emit_xor_reg_reg(ctx->writer, REG_RAX, REG_RAX,
-						 "No else branch: zero RAX");
+		emit_mov_reg_imm(ctx->writer, REG_RAX, LISP_IMM_NIL,
+						 "No else branch: result is nil");
 	}
 
 	emit_label(ctx->writer, end_label, "");
@@ -4,13 +4,69 @@
 #include "codegen_env.h"
 #include "node.h"
 #include <glib.h>
+#include <stdbool.h>
+
+// A global bound exactly once, to a function with no free variables.
+// Calls to it jump straight to its code.
+typedef struct KnownFunction
+{
+	Node *fn_node;
+	int num_defs;
+	int label_num; // code lives at L_func_<label_num>
+} KnownFunction;
 
 typedef struct CodeGenContext
 {
 	AsmFileWriter *writer;
 	CodeGenEnv *env;
 	StringToStringMap *builtin_func_map;
+	// global_var_* labels handed to the collector as roots; the
+	// strings are owned by env
+	GPtrArray *global_roots;
+	// global name -> KnownFunction
+	GHashTable *known_functions;
+	// true while generating a function body, where R12 holds the
+	// current closure and [rbp - 8] keeps a copy of it
+	bool in_function;
+	// the first num_local_regs callee-saved registers may hold
+	// let-bound locals in the function being generated; the next
+	// free one is next_local_reg
+	int num_local_regs;
+	int next_local_reg;
+	// let-bound closures of the function being generated whose
+	// object lives in its frame; calls to them are never tail calls
+	GHashTable *stack_closures;
+	// bit pattern of a float literal -> label of its static object
+	GHashTable *float_constants;
+	// symbol name -> label of its static symbol object
+	GHashTable *symbol_constants;
+	// the same labels in the order they were emitted; the runtime
+	// symbol table is seeded with them
+	GPtrArray *static_symbols;
 } CodeGenContext;
 
-void codegen_compile_program(NodeArray *ast,
-							 const char *output_prefix);
\ No newline at end of file
+typedef enum CodeGenOutput
+{
+	// NASM source in <prefix>.asm
+	CODEGEN_OUTPUT_ASM,
+	// a relocatable ELF object in <prefix>.o, assembled in-process
+	CODEGEN_OUTPUT_OBJECT,
+} CodeGenOutput;
+
+/**
+ * @brief Generates a whole program, including `main`, into writer.
+ * The writer is left open so the caller decides what to do with the
+ * code: write it out, or load it with the JIT.
+ */
+void codegen_generate_program(NodeArray *ast, AsmFileWriter *writer);
+
+/**
+ * @brief Compiles a program to <prefix>.asm or <prefix>.o. Returns
+ * false if the output could not be produced.
+ * @param peephole_stats If not NULL, receives what the peephole pass
+ * rewrote.
+ */
+bool codegen_compile_program(NodeArray *ast,
+							 const char *output_prefix,
+							 CodeGenOutput output,
+							 PeepholeStats *peephole_stats);
\ No newline at end of file
@@ -79,6 +79,19 @@ int codegen_env_add_stack_variable(CodeGenEnv *env, const char *name)
 	return loc->stack_offset;
 }
 
+void codegen_env_add_register_variable(CodeGenEnv *env,
+									   const char *name,
+									   enum Register reg)
+{
+	VarLocation *loc = g_new(VarLocation, 1);
+	loc->type = VAR_LOCATION_REGISTER;
+	loc->reg = reg;
+
+	GHashTable *current_scope = g_ptr_array_index(
+		env->scope_stack, env->scope_stack->len - 1);
+	g_hash_table_insert(current_scope, g_strdup(name), loc);
+}
+
 static char *sanitize_for_label(const char *input)
 {
 	if (!input)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "asm_emitter.h"
 #include <glib.h>
 
 typedef struct CodeGenEnv CodeGenEnv;
@@ -10,13 +11,15 @@ typedef struct
 	{
 		VAR_LOCATION_STACK,
 		VAR_LOCATION_GLOBAL,
-		VAR_LOCATION_ENV
+		VAR_LOCATION_ENV,
+		VAR_LOCATION_REGISTER
 	} type;
 	union
 	{
 		int stack_offset;
 		const char *global_label;
 		int env_index;
+		enum Register reg;
 	};
 } VarLocation;
 
@@ -31,6 +34,14 @@ void codegen_env_exit_scope(CodeGenEnv *env);
  */
 int codegen_env_add_stack_variable(CodeGenEnv *env, const char *name);
 
+/**
+ * @brief Adds a variable to the current scope, held in a register
+ * for the lifetime of the scope.
+ */
+void codegen_env_add_register_variable(CodeGenEnv *env,
+									   const char *name,
+									   enum Register reg);
+
 /**
  * @brief Adds a variable to the global scope.
  * @return The generated global label for the variable. The caller
@@ -0,0 +1,504 @@
+#include "inliner.h"
+#include <string.h>
+
+typedef struct InlineContext
+{
+	// global name -> NODE_FUNCTION to inline, or NULL if the name
+	// must keep being called
+	GHashTable *candidates;
+	// locally bound name -> number of enclosing bindings
+	GHashTable *locals;
+	// functions whose body is being expanded or generated
+	GHashTable *active;
+	int size_budget;
+} InlineContext;
+
+static Node *inline_node(Node *node, InlineContext *ctx);
+
+// Larger than any budget, and still no overflow when summed.
+#define INLINER_NEVER (1 << 20)
+
+static int node_size(Node *node);
+
+static int node_array_size(NodeArray *nodes)
+{
+	int size = 0;
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		size += node_size(node_array_index(nodes, i));
+	}
+	return size;
+}
+
+// Counts the nodes in a tree. A def anywhere makes it too big, since
+// every copy would define the global again.
+static int node_size(Node *node)
+{
+	if (!node)
+	{
+		return 0;
+	}
+	switch (node->type)
+	{
+	case NODE_CALL:
+		return 1 + node_size(node->call.fn) +
+			   node_array_size(node->call.args);
+	case NODE_IF:
+		return 1 + node_size(node->if_expr.condition) +
+			   node_size(node->if_expr.then_branch) +
+			   node_size(node->if_expr.else_branch);
+	case NODE_LET:
+	{
+		int size = 1 + node_array_size(node->let.body);
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(bindings, i);
+			size += node_size(binding->value_expr);
+		}
+		return size;
+	}
+	case NODE_FUNCTION:
+		return 1 + node_array_size(node->function.body);
+	case NODE_DEF:
+		return INLINER_NEVER;
+	default:
+		return 1;
+	}
+}
+
+static void inliner_collect(Node *node, InlineContext *ctx);
+
+static void inliner_collect_array(NodeArray *nodes,
+								  InlineContext *ctx)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		inliner_collect(node_array_index(nodes, i), ctx);
+	}
+}
+
+// Records every def in the program as a candidate or a name that is
+// not inlinable.
+static void inliner_collect(Node *node, InlineContext *ctx)
+{
+	if (!node)
+	{
+		return;
+	}
+	switch (node->type)
+	{
+	case NODE_DEF:
+	{
+		const char *name = node->def.binding->name;
+		Node *value = node->def.binding->value_expr;
+		bool inlinable =
+			!g_hash_table_contains(ctx->candidates, name) &&
+			value->type == NODE_FUNCTION &&
+			value->function.free_var_names->_array->len == 0 &&
+			node_array_size(value->function.body) <=
+				ctx->size_budget;
+		g_hash_table_insert(ctx->candidates, (gpointer)name,
+							inlinable ? value : NULL);
+		inliner_collect(value, ctx);
+		break;
+	}
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(bindings, i);
+			inliner_collect(binding->value_expr, ctx);
+		}
+		inliner_collect_array(node->let.body, ctx);
+		break;
+	}
+	case NODE_FUNCTION:
+		inliner_collect_array(node->function.body, ctx);
+		break;
+	case NODE_CALL:
+		inliner_collect(node->call.fn, ctx);
+		inliner_collect_array(node->call.args, ctx);
+		break;
+	case NODE_IF:
+		inliner_collect(node->if_expr.condition, ctx);
+		inliner_collect(node->if_expr.then_branch, ctx);
+		inliner_collect(node->if_expr.else_branch, ctx);
+		break;
+	default:
+		break;
+	}
+}
+
+static void locals_push(InlineContext *ctx, const char *name)
+{
+	int count =
+		GPOINTER_TO_INT(g_hash_table_lookup(ctx->locals, name));
+	g_hash_table_insert(ctx->locals, (gpointer)name,
+						GINT_TO_POINTER(count + 1));
+}
+
+static void locals_pop(InlineContext *ctx, const char *name)
+{
+	int count =
+		GPOINTER_TO_INT(g_hash_table_lookup(ctx->locals, name));
+	if (count <= 1)
+	{
+		g_hash_table_remove(ctx->locals, name);
+		return;
+	}
+	g_hash_table_insert(ctx->locals, (gpointer)name,
+						GINT_TO_POINTER(count - 1));
+}
+
+static void locals_push_params(InlineContext *ctx,
+							   StringArray *params)
+{
+	for (guint i = 0; i < params->_array->len; i++)
+	{
+		locals_push(ctx, string_array_index(params, i));
+	}
+}
+
+static void locals_pop_params(InlineContext *ctx,
+							  StringArray *params)
+{
+	for (guint i = 0; i < params->_array->len; i++)
+	{
+		locals_pop(ctx, string_array_index(params, i));
+	}
+}
+
+static bool refers_to_local_in(NodeArray *nodes,
+							   StringArray *params,
+							   InlineContext *ctx);
+
+// True if node names a variable, other than one of params, that is
+// bound locally at the call site and would capture the reference.
+static bool refers_to_local(Node *node,
+							StringArray *params,
+							InlineContext *ctx)
+{
+	if (!node)
+	{
+		return false;
+	}
+	switch (node->type)
+	{
+	case NODE_VARIABLE:
+	{
+		const char *name = node->variable.name;
+		return !string_array_contains(params, name) &&
+			   g_hash_table_contains(ctx->locals, name);
+	}
+	case NODE_CALL:
+		return refers_to_local(node->call.fn, params, ctx) ||
+			   refers_to_local_in(node->call.args, params, ctx);
+	case NODE_IF:
+		return refers_to_local(node->if_expr.condition, params,
+							   ctx) ||
+			   refers_to_local(node->if_expr.then_branch, params,
+							   ctx) ||
+			   refers_to_local(node->if_expr.else_branch, params,
+							   ctx);
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(bindings, i);
+			if (refers_to_local(binding->value_expr, params, ctx))
+			{
+				return true;
+			}
+		}
+		return refers_to_local_in(node->let.body, params, ctx);
+	}
+	case NODE_FUNCTION:
+		return refers_to_local_in(node->function.body, params, ctx);
+	default:
+		return false;
+	}
+}
+
+static bool refers_to_local_in(NodeArray *nodes,
+							   StringArray *params,
+							   InlineContext *ctx)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		if (refers_to_local(node_array_index(nodes, i), params, ctx))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Arguments are evaluated right to left by a call but left to right
+// by the let that replaces it; that is only unobservable if at most
+// one of them can have an effect.
+static bool args_reorderable(NodeArray *args)
+{
+	int num_effectful = 0;
+	for (guint i = 0; i < args->_array->len; i++)
+	{
+		Node *arg = node_array_index(args, i);
+		if (arg->type == NODE_CALL || arg->type == NODE_LET ||
+			arg->type == NODE_IF || arg->type == NODE_DEF)
+		{
+			num_effectful++;
+		}
+	}
+	return num_effectful <= 1;
+}
+
+static bool refers_to_name_in(NodeArray *nodes, const char *name);
+
+// True if node reads the variable name as bound around it, that is,
+// outside any let or function that binds name again.
+static bool refers_to_name(Node *node, const char *name)
+{
+	if (!node)
+	{
+		return false;
+	}
+	switch (node->type)
+	{
+	case NODE_VARIABLE:
+		return strcmp(node->variable.name, name) == 0;
+	case NODE_CALL:
+		return refers_to_name(node->call.fn, name) ||
+			   refers_to_name_in(node->call.args, name);
+	case NODE_IF:
+		return refers_to_name(node->if_expr.condition, name) ||
+			   refers_to_name(node->if_expr.then_branch, name) ||
+			   refers_to_name(node->if_expr.else_branch, name);
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(bindings, i);
+			if (refers_to_name(binding->value_expr, name))
+			{
+				return true;
+			}
+			if (strcmp(binding->name, name) == 0)
+			{
+				return false;
+			}
+		}
+		return refers_to_name_in(node->let.body, name);
+	}
+	case NODE_DEF:
+		return refers_to_name(node->def.binding->value_expr, name);
+	case NODE_FUNCTION:
+		return !string_array_contains(node->function.param_names,
+									  name) &&
+			   refers_to_name_in(node->function.body, name);
+	default:
+		return false;
+	}
+}
+
+static bool refers_to_name_in(NodeArray *nodes, const char *name)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		if (refers_to_name(node_array_index(nodes, i), name))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// The let that replaces a call binds params in order, so an argument
+// naming an earlier parameter, as in (f 1 a) for (def (f a b) ...),
+// would read that parameter instead of the caller's variable.
+static bool args_capture_params(NodeArray *args, StringArray *params)
+{
+	for (guint i = 1; i < args->_array->len; i++)
+	{
+		Node *arg = node_array_index(args, i);
+		for (guint j = 0; j < i; j++)
+		{
+			if (refers_to_name(arg, string_array_index(params, j)))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void inline_node_array(NodeArray *nodes, InlineContext *ctx)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		g_ptr_array_index(nodes->_array, i) =
+			inline_node(node_array_index(nodes, i), ctx);
+	}
+}
+
+// Returns the function a call may be replaced with, or NULL.
+static Node *inline_target(Node *call_node, InlineContext *ctx)
+{
+	Node *fn = call_node->call.fn;
+	if (fn->type != NODE_VARIABLE)
+	{
+		return NULL;
+	}
+	const char *name = fn->variable.name;
+	if (g_hash_table_contains(ctx->locals, name) ||
+		g_hash_table_contains(ctx->active, name))
+	{
+		return NULL;
+	}
+	Node *target = g_hash_table_lookup(ctx->candidates, name);
+	if (!target)
+	{
+		return NULL;
+	}
+
+	// The body copied is the current one, which may have grown since
+	// it was collected through calls inlined into it.
+	if (node_array_size(target->function.body) > ctx->size_budget)
+	{
+		return NULL;
+	}
+
+	StringArray *params = target->function.param_names;
+	NodeArray *args = call_node->call.args;
+	if (params->_array->len != args->_array->len ||
+		!args_reorderable(args) ||
+		args_capture_params(args, params) ||
+		refers_to_local_in(target->function.body, params, ctx))
+	{
+		return NULL;
+	}
+	return target;
+}
+
+static Node *inline_call(Node *node, InlineContext *ctx)
+{
+	node->call.fn = inline_node(node->call.fn, ctx);
+	inline_node_array(node->call.args, ctx);
+
+	Node *target = inline_target(node, ctx);
+	if (!target)
+	{
+		return node;
+	}
+
+	StringArray *params = target->function.param_names;
+	VarBindingArray *bindings = var_binding_array_new();
+	for (guint i = 0; i < params->_array->len; i++)
+	{
+		var_binding_array_add(
+			bindings,
+			var_binding_create(string_array_index(params, i),
+							   node_array_index(node->call.args, i)));
+	}
+	NodeArray *body = node_array_copy(target->function.body);
+	Node *let_node = node_create_let(bindings, body, NULL);
+
+	// Calls in the copied body may be inlined in turn, but never the
+	// function being expanded.
+	char *name = node->call.fn->variable.name;
+	g_hash_table_add(ctx->active, name);
+	locals_push_params(ctx, params);
+	inline_node_array(body, ctx);
+	locals_pop_params(ctx, params);
+	g_hash_table_remove(ctx->active, name);
+
+	node_free(node);
+	return let_node;
+}
+
+static Node *inline_let(Node *node, InlineContext *ctx)
+{
+	VarBindingArray *bindings = node->let.bindings;
+	for (guint i = 0; i < bindings->_array->len; i++)
+	{
+		VarBinding *binding = var_binding_array_index(bindings, i);
+		binding->value_expr = inline_node(binding->value_expr, ctx);
+	}
+	for (guint i = 0; i < bindings->_array->len; i++)
+	{
+		locals_push(ctx, var_binding_array_index(bindings, i)->name);
+	}
+	inline_node_array(node->let.body, ctx);
+	for (guint i = 0; i < bindings->_array->len; i++)
+	{
+		locals_pop(ctx, var_binding_array_index(bindings, i)->name);
+	}
+	return node;
+}
+
+static Node *inline_def(Node *node, InlineContext *ctx)
+{
+	VarBinding *binding = node->def.binding;
+	// A function's own body never inlines it.
+	g_hash_table_add(ctx->active, binding->name);
+	binding->value_expr = inline_node(binding->value_expr, ctx);
+	g_hash_table_remove(ctx->active, binding->name);
+	return node;
+}
+
+static Node *inline_node(Node *node, InlineContext *ctx)
+{
+	switch (node->type)
+	{
+	case NODE_CALL:
+		return inline_call(node, ctx);
+	case NODE_LET:
+		return inline_let(node, ctx);
+	case NODE_DEF:
+		return inline_def(node, ctx);
+	case NODE_FUNCTION:
+		locals_push_params(ctx, node->function.param_names);
+		inline_node_array(node->function.body, ctx);
+		locals_pop_params(ctx, node->function.param_names);
+		return node;
+	case NODE_IF:
+		node->if_expr.condition =
+			inline_node(node->if_expr.condition, ctx);
+		node->if_expr.then_branch =
+			inline_node(node->if_expr.then_branch, ctx);
+		if (node->if_expr.else_branch)
+		{
+			node->if_expr.else_branch =
+				inline_node(node->if_expr.else_branch, ctx);
+		}
+		return node;
+	default:
+		return node;
+	}
+}
+
+void inliner_run(NodeArray *ast, int size_budget)
+{
+	InlineContext ctx = {
+		.candidates = g_hash_table_new(g_str_hash, g_str_equal),
+		.locals = g_hash_table_new(g_str_hash, g_str_equal),
+		.active = g_hash_table_new(g_str_hash, g_str_equal),
+		.size_budget = size_budget,
+	};
+	for (guint i = 0; i < ast->_array->len; i++)
+	{
+		inliner_collect(node_array_index(ast, i), &ctx);
+	}
+
+	inline_node_array(ast, &ctx);
+
+	g_hash_table_destroy(ctx.candidates);
+	g_hash_table_destroy(ctx.locals);
+	g_hash_table_destroy(ctx.active);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "node.h"
+
+// Largest body, in AST nodes, that is inlined when no budget is given
+// on the command line.
+#define INLINER_DEFAULT_BUDGET 20
+
+/**
+ * @brief Replaces calls to small global functions with their bodies,
+ * binding the arguments with a let. A function qualifies if it is
+ * defined exactly once, captures nothing and its body has at most
+ * size_budget nodes. Bodies are never expanded into themselves, so
+ * recursion stays a call. Runs before the optimizer so inlined code
+ * is folded with its arguments.
+ */
+void inliner_run(NodeArray *ast, int size_budget);
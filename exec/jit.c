@@ -0,0 +1,192 @@
+#include "jit.h"
+#include "runtime_symbols.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// jmp [rip + 0] followed by the 8-byte target: reaches a runtime
+// function from code mapped more than 2GB away from it.
+static const uint8_t VENEER_JMP[] = {0xFF, 0x25, 0, 0, 0, 0};
+static const size_t VENEER_SIZE = 16;
+
+static size_t page_align(size_t size)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	return (size + page - 1) / page * page;
+}
+
+static uint8_t *symbol_address(JitImage *image, ObjectSymbol *symbol)
+{
+	if (symbol->defined)
+	{
+		return image->sections[symbol->section] + symbol->offset;
+	}
+	return runtime_symbol_address(symbol->name);
+}
+
+// Whether the PC32 field at offset is the target of a call or jump,
+// which may be redirected through a veneer.
+static bool is_branch_field(const uint8_t *section, uint64_t offset)
+{
+	if (offset >= 1 && (section[offset - 1] == 0xE8 ||
+						section[offset - 1] == 0xE9))
+	{
+		return true;
+	}
+	return offset >= 2 && section[offset - 2] == 0x0F &&
+		   (section[offset - 1] & 0xF0) == 0x80;
+}
+
+// Returns the veneer jumping to target, writing a new one after the
+// code on first use.
+static uint8_t *veneer_for(GHashTable *veneers,
+						   uint8_t **next_veneer,
+						   uint8_t *target)
+{
+	uint8_t *veneer = g_hash_table_lookup(veneers, target);
+	if (veneer)
+	{
+		return veneer;
+	}
+	veneer = *next_veneer;
+	*next_veneer += VENEER_SIZE;
+	memcpy(veneer, VENEER_JMP, sizeof(VENEER_JMP));
+	memcpy(veneer + sizeof(VENEER_JMP), &target, sizeof(target));
+	g_hash_table_insert(veneers, target, veneer);
+	return veneer;
+}
+
+static bool jit_relocate(JitImage *image,
+						 ObjectFile *obj,
+						 uint8_t *veneer_area)
+{
+	bool ok = true;
+	GHashTable *veneers =
+		g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (guint i = 0; i < obj->relocations->len; i++)
+	{
+		ObjectRelocation *reloc =
+			&g_array_index(obj->relocations, ObjectRelocation, i);
+		uint8_t *target = symbol_address(image, reloc->symbol);
+		if (!target)
+		{
+			fprintf(stderr,
+					"Jit Error: unknown runtime symbol '%s'\n",
+					reloc->symbol->name);
+			ok = false;
+			continue;
+		}
+
+		uint8_t *section = image->sections[reloc->section];
+		uint8_t *field = section + reloc->offset;
+		if (reloc->kind == OBJECT_RELOC_ABS64)
+		{
+			uint64_t value = (uint64_t)(target + reloc->addend);
+			memcpy(field, &value, sizeof(value));
+			continue;
+		}
+
+		int64_t distance =
+			(int64_t)(target - field) + reloc->addend;
+		if (distance != (int32_t)distance &&
+			is_branch_field(section, reloc->offset))
+		{
+			target = veneer_for(veneers, &veneer_area, target);
+			distance = (int64_t)(target - field) + reloc->addend;
+		}
+		if (distance != (int32_t)distance)
+		{
+			fprintf(stderr, "Jit Error: '%s' is out of range\n",
+					reloc->symbol->name);
+			ok = false;
+			continue;
+		}
+		int32_t value = (int32_t)distance;
+		memcpy(field, &value, sizeof(value));
+	}
+	g_hash_table_destroy(veneers);
+	return ok;
+}
+
+JitImage *jit_load(ObjectFile *obj)
+{
+	// At most one veneer per runtime symbol.
+	guint num_externs = 0;
+	for (guint i = 0; i < obj->symbols->len; i++)
+	{
+		ObjectSymbol *symbol = g_ptr_array_index(obj->symbols, i);
+		num_externs += !symbol->defined;
+	}
+
+	GByteArray *text = obj->sections[OBJECT_SECTION_TEXT];
+	GByteArray *data = obj->sections[OBJECT_SECTION_DATA];
+	GByteArray *rodata = obj->sections[OBJECT_SECTION_RODATA];
+	size_t veneer_offset = (text->len + 15) & ~(size_t)15;
+	size_t text_size =
+		page_align(veneer_offset + num_externs * VENEER_SIZE);
+	size_t data_size = page_align(data->len);
+	size_t rodata_size = page_align(rodata->len);
+
+	JitImage *image = g_new0(JitImage, 1);
+	image->size = text_size + data_size + rodata_size;
+	image->memory = mmap(NULL, image->size, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (image->memory == MAP_FAILED)
+	{
+		perror("Jit Error: mmap");
+		g_free(image);
+		return NULL;
+	}
+	image->sections[OBJECT_SECTION_TEXT] = image->memory;
+	image->sections[OBJECT_SECTION_DATA] = image->memory + text_size;
+	image->sections[OBJECT_SECTION_RODATA] =
+		image->memory + text_size + data_size;
+	for (int i = 0; i < OBJECT_SECTION_COUNT; i++)
+	{
+		memcpy(image->sections[i], obj->sections[i]->data,
+			   obj->sections[i]->len);
+	}
+
+	image->symbols = g_hash_table_new_full(g_str_hash, g_str_equal,
+										   g_free, NULL);
+	for (guint i = 0; i < obj->symbols->len; i++)
+	{
+		ObjectSymbol *symbol = g_ptr_array_index(obj->symbols, i);
+		if (symbol->defined)
+		{
+			g_hash_table_insert(image->symbols,
+								g_strdup(symbol->name),
+								symbol_address(image, symbol));
+		}
+	}
+
+	if (!jit_relocate(image, obj, image->memory + veneer_offset))
+	{
+		jit_free(image);
+		return NULL;
+	}
+	if (mprotect(image->memory, text_size, PROT_READ | PROT_EXEC) ||
+		mprotect(image->sections[OBJECT_SECTION_RODATA], rodata_size,
+				 PROT_READ))
+	{
+		perror("Jit Error: mprotect");
+		jit_free(image);
+		return NULL;
+	}
+	return image;
+}
+
+void *jit_symbol_address(JitImage *image, const char *name)
+{
+	return g_hash_table_lookup(image->symbols, name);
+}
+
+void jit_free(JitImage *image)
+{
+	if (!image)
+		return;
+	munmap(image->memory, image->size);
+	g_hash_table_destroy(image->symbols);
+	g_free(image);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "object_file.h"
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief An object file loaded into executable memory in this
+ * process, with its references to the runtime bound to the runtime
+ * linked into the compiler.
+ */
+typedef struct JitImage
+{
+	uint8_t *memory;
+	size_t size;
+	// where each section was placed
+	uint8_t *sections[OBJECT_SECTION_COUNT];
+	// name -> address of every symbol the object defines
+	GHashTable *symbols;
+} JitImage;
+
+/**
+ * @brief Copies a resolved object into fresh memory, applies its
+ * relocations and makes the code executable. Fails, reporting the
+ * name, on a reference to a symbol the runtime does not provide.
+ */
+JitImage *jit_load(ObjectFile *obj);
+
+/** @brief The address of a symbol defined by the object, or NULL. */
+void *jit_symbol_address(JitImage *image, const char *name);
+
+void jit_free(JitImage *image);
@@ -0,0 +1,347 @@
+#include "lambda_lift.h"
+#include <string.h>
+
+typedef struct LiftContext
+{
+	// lifted defs waiting to be placed before the current top-level
+	// form
+	GPtrArray *lifted;
+	int next_id;
+} LiftContext;
+
+static Node *lift_node(Node *node, LiftContext *ctx);
+static void lift_node_array(NodeArray *nodes, LiftContext *ctx);
+
+static bool lift_binds_name(const char *bound,
+							const char *name,
+							StringArray *free_vars)
+{
+	return strcmp(bound, name) == 0 ||
+		   string_array_contains(free_vars, bound);
+}
+
+static bool lift_all_calls_direct_in(NodeArray *nodes,
+									 const char *name,
+									 StringArray *free_vars);
+
+// Returns true if every use of name in node is the head of a call
+// that can be handed free_vars explicitly: no other use, no use from
+// a nested function, and nothing rebinds name or any of free_vars.
+static bool lift_all_calls_direct(Node *node,
+								  const char *name,
+								  StringArray *free_vars)
+{
+	switch (node->type)
+	{
+	case NODE_VARIABLE:
+		return strcmp(node->variable.name, name) != 0;
+	case NODE_CALL:
+	{
+		Node *fn = node->call.fn;
+		bool direct = fn->type == NODE_VARIABLE &&
+					  strcmp(fn->variable.name, name) == 0;
+		if (!direct && !lift_all_calls_direct(fn, name, free_vars))
+		{
+			return false;
+		}
+		return lift_all_calls_direct_in(node->call.args, name,
+										free_vars);
+	}
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(bindings, i);
+			if (lift_binds_name(binding->name, name, free_vars) ||
+				!lift_all_calls_direct(binding->value_expr, name,
+									   free_vars))
+			{
+				return false;
+			}
+		}
+		return lift_all_calls_direct_in(node->let.body, name,
+										free_vars);
+	}
+	case NODE_DEF:
+		return !lift_binds_name(node->def.binding->name, name,
+								free_vars) &&
+			   lift_all_calls_direct(node->def.binding->value_expr,
+									 name, free_vars);
+	case NODE_IF:
+		return lift_all_calls_direct(node->if_expr.condition, name,
+									 free_vars) &&
+			   lift_all_calls_direct(node->if_expr.then_branch, name,
+									 free_vars) &&
+			   (!node->if_expr.else_branch ||
+				lift_all_calls_direct(node->if_expr.else_branch, name,
+									  free_vars));
+	case NODE_FUNCTION:
+		return !string_array_contains(node->function.free_var_names,
+									  name) &&
+			   !string_array_contains(node->function.param_names,
+									  name);
+	default:
+		return true;
+	}
+}
+
+static bool lift_all_calls_direct_in(NodeArray *nodes,
+									 const char *name,
+									 StringArray *free_vars)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		if (!lift_all_calls_direct(node_array_index(nodes, i), name,
+								   free_vars))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void lift_rewrite_calls_in(NodeArray *nodes,
+								  const char *name,
+								  const char *lifted_name,
+								  StringArray *free_vars);
+
+// Points every call to name at lifted_name, passing free_vars first.
+// Only valid once lift_all_calls_direct holds.
+static void lift_rewrite_calls(Node *node,
+							   const char *name,
+							   const char *lifted_name,
+							   StringArray *free_vars)
+{
+	switch (node->type)
+	{
+	case NODE_CALL:
+	{
+		Node *fn = node->call.fn;
+		if (fn->type == NODE_VARIABLE &&
+			strcmp(fn->variable.name, name) == 0)
+		{
+			free(fn->variable.name);
+			fn->variable.name = strdup(lifted_name);
+			GPtrArray *args = node->call.args->_array;
+			for (guint i = 0; i < free_vars->_array->len; i++)
+			{
+				Node *captured = node_create_variable(
+					string_array_index(free_vars, i),
+					fn->variable.env);
+				g_ptr_array_insert(args, i, captured);
+			}
+		}
+		else
+		{
+			lift_rewrite_calls(fn, name, lifted_name, free_vars);
+		}
+		lift_rewrite_calls_in(node->call.args, name, lifted_name,
+							  free_vars);
+		break;
+	}
+	case NODE_LET:
+	{
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(bindings, i);
+			lift_rewrite_calls(binding->value_expr, name,
+							   lifted_name, free_vars);
+		}
+		lift_rewrite_calls_in(node->let.body, name, lifted_name,
+							  free_vars);
+		break;
+	}
+	case NODE_DEF:
+		lift_rewrite_calls(node->def.binding->value_expr, name,
+						   lifted_name, free_vars);
+		break;
+	case NODE_IF:
+		lift_rewrite_calls(node->if_expr.condition, name, lifted_name,
+						   free_vars);
+		lift_rewrite_calls(node->if_expr.then_branch, name,
+						   lifted_name, free_vars);
+		if (node->if_expr.else_branch)
+		{
+			lift_rewrite_calls(node->if_expr.else_branch, name,
+							   lifted_name, free_vars);
+		}
+		break;
+	default:
+		// Nested functions never call name, see
+		// lift_all_calls_direct.
+		break;
+	}
+}
+
+static void lift_rewrite_calls_in(NodeArray *nodes,
+								  const char *name,
+								  const char *lifted_name,
+								  StringArray *free_vars)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		lift_rewrite_calls(node_array_index(nodes, i), name,
+						   lifted_name, free_vars);
+	}
+}
+
+static bool lift_is_liftable_binding(Node *let_node,
+									 guint binding_index)
+{
+	VarBindingArray *bindings = let_node->let.bindings;
+	VarBinding *binding =
+		var_binding_array_index(bindings, binding_index);
+	Node *fn = binding->value_expr;
+	if (fn->type != NODE_FUNCTION)
+	{
+		return false;
+	}
+
+	StringArray *free_vars = fn->function.free_var_names;
+	for (guint i = binding_index + 1; i < bindings->_array->len; i++)
+	{
+		VarBinding *later = var_binding_array_index(bindings, i);
+		if (lift_binds_name(later->name, binding->name, free_vars) ||
+			!lift_all_calls_direct(later->value_expr, binding->name,
+								   free_vars))
+		{
+			return false;
+		}
+	}
+	return lift_all_calls_direct_in(let_node->let.body,
+									binding->name, free_vars);
+}
+
+// Turns the lambda into a closed global function taking its free
+// variables first, and queues its def.
+static char *lift_binding(VarBinding *binding, LiftContext *ctx)
+{
+	char *lifted_name = g_strdup_printf(
+		"%s__lifted_%d", binding->name, ctx->next_id++);
+	VarBinding *def_binding =
+		var_binding_create(lifted_name, binding->value_expr);
+
+	Node *fn = def_binding->value_expr;
+	StringArray *free_vars = fn->function.free_var_names;
+	GPtrArray *params = fn->function.param_names->_array;
+	for (guint i = 0; i < free_vars->_array->len; i++)
+	{
+		g_ptr_array_insert(params, i,
+						   strdup(string_array_index(free_vars, i)));
+	}
+	g_ptr_array_set_size(free_vars->_array, 0);
+
+	g_ptr_array_add(ctx->lifted, node_create_def(def_binding));
+	return lifted_name;
+}
+
+// Lifts the let's liftable lambda bindings, dropping the let if only
+// a single body expression is left.
+static Node *lift_let(Node *node, LiftContext *ctx)
+{
+	GPtrArray *bindings = node->let.bindings->_array;
+	for (guint i = 0; i < bindings->len;)
+	{
+		VarBinding *binding = g_ptr_array_index(bindings, i);
+		binding->value_expr = lift_node(binding->value_expr, ctx);
+		if (!lift_is_liftable_binding(node, i))
+		{
+			i++;
+			continue;
+		}
+
+		char *lifted_name = lift_binding(binding, ctx);
+		StringArray *free_vars =
+			binding->value_expr->function.free_var_names;
+		for (guint j = i + 1; j < bindings->len; j++)
+		{
+			VarBinding *later = g_ptr_array_index(bindings, j);
+			lift_rewrite_calls(later->value_expr, binding->name,
+							   lifted_name, free_vars);
+		}
+		lift_rewrite_calls_in(node->let.body, binding->name,
+							  lifted_name, free_vars);
+		g_free(lifted_name);
+		g_ptr_array_remove_index(bindings, i);
+	}
+
+	NodeArray *body = node->let.body;
+	lift_node_array(body, ctx);
+
+	if (bindings->len == 0 && body->_array->len == 1)
+	{
+		Node *only_expr = node_array_index(body, 0);
+		g_ptr_array_index(body->_array, 0) = NULL;
+		node_free(node);
+		return only_expr;
+	}
+	return node;
+}
+
+static void lift_node_array(NodeArray *nodes, LiftContext *ctx)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		g_ptr_array_index(nodes->_array, i) =
+			lift_node(node_array_index(nodes, i), ctx);
+	}
+}
+
+static Node *lift_node(Node *node, LiftContext *ctx)
+{
+	switch (node->type)
+	{
+	case NODE_LET:
+		return lift_let(node, ctx);
+	case NODE_FUNCTION:
+		lift_node_array(node->function.body, ctx);
+		break;
+	case NODE_CALL:
+		node->call.fn = lift_node(node->call.fn, ctx);
+		lift_node_array(node->call.args, ctx);
+		break;
+	case NODE_IF:
+		node->if_expr.condition =
+			lift_node(node->if_expr.condition, ctx);
+		node->if_expr.then_branch =
+			lift_node(node->if_expr.then_branch, ctx);
+		if (node->if_expr.else_branch)
+		{
+			node->if_expr.else_branch =
+				lift_node(node->if_expr.else_branch, ctx);
+		}
+		break;
+	case NODE_DEF:
+		node->def.binding->value_expr =
+			lift_node(node->def.binding->value_expr, ctx);
+		break;
+	default:
+		break;
+	}
+	return node;
+}
+
+void lambda_lift_run(NodeArray *ast)
+{
+	LiftContext ctx = {.lifted = g_ptr_array_new(), .next_id = 0};
+	GPtrArray *forms = ast->_array;
+	for (guint i = 0; i < forms->len; i++)
+	{
+		g_ptr_array_index(forms, i) =
+			lift_node(node_array_index(ast, i), &ctx);
+
+		// Lifted functions are called by label, so their defs only
+		// need to come before the form for the global to be set.
+		for (guint j = 0; j < ctx.lifted->len; j++)
+		{
+			g_ptr_array_insert(forms, i++,
+							   g_ptr_array_index(ctx.lifted, j));
+		}
+		g_ptr_array_set_size(ctx.lifted, 0);
+	}
+	g_ptr_array_free(ctx.lifted, TRUE);
+}
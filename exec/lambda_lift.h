@@ -0,0 +1,12 @@
+#pragma once
+
+#include "node.h"
+
+/**
+ * @brief Lifts let-bound lambdas that are only ever called directly
+ * into closed top-level defs. Their free variables become leading
+ * parameters, which every call site passes explicitly, so codegen
+ * calls them by label with no closure object. Runs after the
+ * optimizer, in place.
+ */
+void lambda_lift_run(NodeArray *ast);
@@ -1,11 +1,68 @@
 #include <assert.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "codegen.h"
+#include "inliner.h"
+#include "jit.h"
+#include "lambda_lift.h"
+#include "optimizer.h"
+#include "peephole.h"
 #include "parser.h"
 
+// Cleared by --run, where stdout belongs to the program.
+static bool verbose = true;
+
+static void progress(const char *format, ...)
+{
+	if (!verbose)
+		return;
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+// Goes to stderr so that it stays apart from the program's output
+// under --run.
+static void print_peephole_stats(const PeepholeStats *stats)
+{
+	fprintf(stderr, "--- Peephole rewrites ---\n");
+	peephole_print_stats(stats, stderr);
+}
+
+// Compiles into memory and jumps to the program's `main`, which exits
+// the process itself.
+static int run_program(NodeArray *ast,
+					   const char *output_prefix,
+					   bool show_peephole_stats)
+{
+	AsmFileWriter *writer =
+		asm_file_writer_create_object(output_prefix);
+	codegen_generate_program(ast, writer);
+	JitImage *image = object_file_resolve(writer->object)
+						  ? jit_load(writer->object)
+						  : NULL;
+	if (show_peephole_stats)
+	{
+		print_peephole_stats(&writer->peephole_stats);
+	}
+	asm_file_writer_cleanup(writer);
+	if (!image)
+	{
+		fprintf(stderr, "Code generation failed.\n");
+		return 1;
+	}
+
+	void (*program_main)(void) =
+		(void (*)(void))jit_symbol_address(image, "main");
+	program_main();
+	jit_free(image);
+	return 0;
+}
+
 static char *read_file_to_string(const char *filename)
 {
 	FILE *file = fopen(filename, "rb");
@@ -67,15 +124,51 @@ static char *get_output_prefix(const char *input_filename)
 
 int main(int argc, char **argv)
 {
-	if (argc != 2)
+	const char *input_filename = NULL;
+	int inline_budget = INLINER_DEFAULT_BUDGET;
+	CodeGenOutput output = CODEGEN_OUTPUT_ASM;
+	bool run = false;
+	bool show_peephole_stats = false;
+	const char *budget_flag = "--inline-budget=";
+	for (int i = 1; i < argc; i++)
 	{
-		fprintf(stderr, "Usage: %s <input_file.lisp>\n", argv[0]);
+		if (strncmp(argv[i], budget_flag, strlen(budget_flag)) == 0)
+		{
+			inline_budget = atoi(argv[i] + strlen(budget_flag));
+		}
+		else if (strcmp(argv[i], "--emit-obj") == 0)
+		{
+			output = CODEGEN_OUTPUT_OBJECT;
+		}
+		else if (strcmp(argv[i], "--run") == 0)
+		{
+			run = true;
+			verbose = false;
+		}
+		else if (strcmp(argv[i], "--peephole-stats") == 0)
+		{
+			show_peephole_stats = true;
+		}
+		else if (!input_filename)
+		{
+			input_filename = argv[i];
+		}
+		else
+		{
+			input_filename = NULL;
+			break;
+		}
+	}
+	if (!input_filename)
+	{
+		fprintf(stderr,
+				"Usage: %s [--inline-budget=N] [--emit-obj | --run] "
+				"[--peephole-stats] <input_file.lisp>\n",
+				argv[0]);
 		return 1;
 	}
 
-	const char *input_filename = argv[1];
-
-	printf("--- Reading source file: %s ---\n", input_filename);
+	progress("--- Reading source file: %s ---\n", input_filename);
 	char *source_code = read_file_to_string(input_filename);
 
 	if (!source_code)
@@ -84,10 +177,10 @@ int main(int argc, char **argv)
 			   input_filename);
 		return 1;
 	}
-	printf("Source loaded successfully (%zu bytes).\n\n",
-		   strlen(source_code));
+	progress("Source loaded successfully (%zu bytes).\n\n",
+			 strlen(source_code));
 
-	printf("--- Parsing source code ---\n");
+	progress("--- Parsing source code ---\n");
 	ParserContext *parser_ctx = parser_create(source_code);
 	NodeArray *ast = parser_parse(parser_ctx);
 
@@ -101,26 +194,71 @@ int main(int argc, char **argv)
 		free(source_code);
 		return 1;
 	}
-	printf(
+	progress(
 		"Parsing successful. AST has %d top-level expression(s).\n\n",
 		ast->_array->len);
 
 	parser_cleanup(parser_ctx);
 	free(source_code);
 
+	progress("--- Inlining small functions (budget %d) ---\n",
+			 inline_budget);
+	inliner_run(ast, inline_budget);
+	progress("Inlining done.\n\n");
+
+	progress("--- Optimizing AST ---\n");
+	optimizer_run(ast);
+	progress("Constant folding and propagation done.\n\n");
+
+	progress("--- Lifting lambdas ---\n");
+	lambda_lift_run(ast);
+	progress("Lambda lifting done.\n\n");
+
 	char *output_prefix = get_output_prefix(input_filename);
-	printf("--- Generating assembly with prefix: %s ---\n",
-		   output_prefix);
+	if (run)
+	{
+		int status =
+			run_program(ast, output_prefix, show_peephole_stats);
+		node_array_free(ast);
+		free(output_prefix);
+		return status;
+	}
+
+	bool emit_object = output == CODEGEN_OUTPUT_OBJECT;
+	progress("--- Generating %s with prefix: %s ---\n",
+			 emit_object ? "object code" : "assembly",
+			 output_prefix);
 
-	codegen_compile_program(ast, output_prefix);
+	PeepholeStats peephole_stats;
+	bool ok = codegen_compile_program(ast, output_prefix, output,
+									  &peephole_stats);
+	if (ok && show_peephole_stats)
+	{
+		print_peephole_stats(&peephole_stats);
+	}
 
 	node_array_free(ast);
 
+	if (!ok)
+	{
+		fprintf(stderr, "Code generation failed.\n");
+		free(output_prefix);
+		return 1;
+	}
+
 	printf("\nCompilation successful!\n");
-	printf("Generated: %s.asm\n\n", output_prefix);
-	printf("To assemble and link, run:\n");
-	printf("  nasm -f elf64 -g %s.asm -o %s.o\n", output_prefix,
-		   output_prefix);
+	if (emit_object)
+	{
+		printf("Generated: %s.o\n\n", output_prefix);
+		printf("To link, run:\n");
+	}
+	else
+	{
+		printf("Generated: %s.asm\n\n", output_prefix);
+		printf("To assemble and link, run:\n");
+		printf("  nasm -f elf64 -g %s.asm -o %s.o\n", output_prefix,
+			   output_prefix);
+	}
 	printf("  gcc %s.o runtime.o -o %s\n\n", output_prefix,
 		   output_prefix);
 
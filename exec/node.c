@@ -37,6 +37,17 @@ Node *node_create_literal_bool(bool val)
 	return n;
 }
 
+Node *node_create_literal_symbol(const char *name)
+{
+	Node *n = malloc(sizeof(Node));
+	assert(n && "Out of memory");
+	n->type = NODE_LITERAL;
+	n->literal.lit_type = LIT_SYMBOL;
+	n->literal.s_val = strdup(name);
+	assert(n->literal.s_val && "Out of memory");
+	return n;
+}
+
 Node *node_create_variable(char *name, ParserEnv *env)
 {
 	Node *n = malloc(sizeof(Node));
@@ -129,6 +140,17 @@ Node *node_create_quote(Node *quoted_expr)
 	assert(n && "Out of memory");
 	n->type = NODE_QUOTE;
 	n->quote.quoted_expr = quoted_expr;
+	n->quote.elements = NULL;
+	return n;
+}
+
+Node *node_create_quote_list(NodeArray *elements)
+{
+	Node *n = malloc(sizeof(Node));
+	assert(n && "Out of memory");
+	n->type = NODE_QUOTE;
+	n->quote.quoted_expr = NULL;
+	n->quote.elements = elements;
 	return n;
 }
 
@@ -157,7 +179,8 @@ Node *node_copy(const Node *original)
 	{
 	case NODE_LITERAL:
 		copy->literal = original->literal;
-		if (original->literal.lit_type == LIT_STRING &&
+		if ((original->literal.lit_type == LIT_STRING ||
+			 original->literal.lit_type == LIT_SYMBOL) &&
 			original->literal.s_val)
 		{
 			copy->literal.s_val = strdup(original->literal.s_val);
@@ -200,6 +223,10 @@ Node *node_copy(const Node *original)
 	case NODE_QUOTE:
 		copy->quote.quoted_expr =
 			node_copy(original->quote.quoted_expr);
+		copy->quote.elements =
+			original->quote.elements
+				? node_array_copy(original->quote.elements)
+				: NULL;
 		break;
 	case NODE_PLACEHOLDER:
 		break;
@@ -219,7 +246,8 @@ void node_free(Node *node)
 	switch (node->type)
 	{
 	case NODE_LITERAL:
-		if (node->literal.lit_type == LIT_STRING)
+		if (node->literal.lit_type == LIT_STRING ||
+			node->literal.lit_type == LIT_SYMBOL)
 		{
 			free(node->literal.s_val);
 		}
@@ -251,6 +279,11 @@ void node_free(Node *node)
 		break;
 	case NODE_QUOTE:
 		node_free(node->quote.quoted_expr);
+		if (node->quote.elements)
+		{
+			node_array_free(node->quote.elements);
+		}
+		break;
 	case NODE_PLACEHOLDER:
 		return;
 	default:
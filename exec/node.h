@@ -25,7 +25,8 @@ typedef enum LiteralType
 	LIT_INT,
 	LIT_FLOAT,
 	LIT_STRING,
-	LIT_BOOL
+	LIT_BOOL,
+	LIT_SYMBOL // only inside a quote; the name is in s_val
 } LiteralType;
 
 typedef struct Node Node;
@@ -48,7 +49,7 @@ typedef struct Node
 			{
 				int i_val;
 				double f_val;
-				char *s_val;
+				char *s_val; // strings AND symbols
 				bool b_val;
 			};
 		} literal;
@@ -92,9 +93,13 @@ typedef struct Node
 			ParserEnv *env;
 		} let;
 
+		// Every quoted datum is a quote node: an atom wraps a literal
+		// in quoted_expr, a list has quoted_expr NULL and one quote
+		// node per element.
 		struct
 		{
 			Node *quoted_expr;
+			NodeArray *elements;
 		} quote;
 	};
 } Node;
@@ -103,6 +108,7 @@ Node *node_create_literal_int(int val);
 Node *node_create_literal_float(double val);
 Node *node_create_literal_string(char *val);
 Node *node_create_literal_bool(bool val);
+Node *node_create_literal_symbol(const char *name);
 Node *node_create_variable(char *name, ParserEnv *env);
 Node *node_create_def(VarBinding *var);
 
@@ -119,6 +125,7 @@ Node *node_create_if_expr(Node *condition,
 						  Node *then_branch,
 						  Node *else_branch);
 Node *node_create_quote(Node *quoted_expr);
+Node *node_create_quote_list(NodeArray *elements);
 Node *get_placeholder(void);
 void node_free(Node *node);
 void node_free_v(void *node);
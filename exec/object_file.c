@@ -0,0 +1,400 @@
+#include "object_file.h"
+#include <assert.h>
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *SECTION_NAMES[] = {".text", ".data", ".rodata"};
+static const char *RELA_SECTION_NAMES[] = {".rela.text", ".rela.data",
+										   ".rela.rodata"};
+
+static void pad_to_alignment(GByteArray *bytes, uint64_t alignment)
+{
+	guint padding = (alignment - bytes->len % alignment) % alignment;
+	g_byte_array_set_size(bytes, bytes->len + padding);
+	memset(bytes->data + bytes->len - padding, 0, padding);
+}
+
+static void object_symbol_free(gpointer data)
+{
+	ObjectSymbol *symbol = data;
+	g_free(symbol->name);
+	g_free(symbol);
+}
+
+ObjectFile *object_file_create(void)
+{
+	ObjectFile *obj = g_new0(ObjectFile, 1);
+	for (int i = 0; i < OBJECT_SECTION_COUNT; i++)
+	{
+		obj->sections[i] = g_byte_array_new();
+	}
+	obj->data_section = OBJECT_SECTION_DATA;
+	obj->symbols_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+	obj->symbols = g_ptr_array_new_with_free_func(object_symbol_free);
+	obj->relocations =
+		g_array_new(FALSE, FALSE, sizeof(ObjectRelocation));
+	return obj;
+}
+
+void object_file_free(ObjectFile *obj)
+{
+	if (!obj)
+		return;
+	for (int i = 0; i < OBJECT_SECTION_COUNT; i++)
+	{
+		g_byte_array_free(obj->sections[i], TRUE);
+	}
+	g_hash_table_destroy(obj->symbols_by_name);
+	g_ptr_array_free(obj->symbols, TRUE);
+	g_array_free(obj->relocations, TRUE);
+	g_free(obj);
+}
+
+uint64_t object_file_offset(ObjectFile *obj, ObjectSection section)
+{
+	return obj->sections[section]->len;
+}
+
+void object_file_append(ObjectFile *obj,
+						ObjectSection section,
+						const void *bytes,
+						size_t len)
+{
+	g_byte_array_append(obj->sections[section], bytes, len);
+}
+
+void object_file_align(ObjectFile *obj,
+					   ObjectSection section,
+					   int alignment)
+{
+	pad_to_alignment(obj->sections[section], alignment);
+}
+
+ObjectSymbol *object_file_symbol(ObjectFile *obj, const char *name)
+{
+	ObjectSymbol *symbol =
+		g_hash_table_lookup(obj->symbols_by_name, name);
+	if (symbol)
+	{
+		return symbol;
+	}
+	symbol = g_new0(ObjectSymbol, 1);
+	symbol->name = g_strdup(name);
+	g_hash_table_insert(obj->symbols_by_name, symbol->name, symbol);
+	g_ptr_array_add(obj->symbols, symbol);
+	return symbol;
+}
+
+void object_file_define(ObjectFile *obj,
+						ObjectSection section,
+						const char *name)
+{
+	ObjectSymbol *symbol = object_file_symbol(obj, name);
+	assert(!symbol->defined && "Symbol defined twice");
+	symbol->defined = true;
+	symbol->section = section;
+	symbol->offset = object_file_offset(obj, section);
+}
+
+void object_file_declare_global(ObjectFile *obj, const char *name)
+{
+	object_file_symbol(obj, name)->global = true;
+}
+
+void object_file_append_reloc(ObjectFile *obj,
+							  ObjectSection section,
+							  ObjectRelocationKind kind,
+							  const char *name,
+							  int64_t addend)
+{
+	ObjectRelocation reloc = {
+		.section = section,
+		.offset = object_file_offset(obj, section),
+		.kind = kind,
+		.symbol = object_file_symbol(obj, name),
+		.addend = addend,
+	};
+	g_array_append_val(obj->relocations, reloc);
+
+	uint8_t zeros[sizeof(int64_t)] = {0};
+	object_file_append(obj, section, zeros,
+					   kind == OBJECT_RELOC_ABS64 ? sizeof(int64_t)
+												  : sizeof(int32_t));
+}
+
+bool object_file_resolve(ObjectFile *obj)
+{
+	bool ok = true;
+	for (guint i = 0; i < obj->symbols->len; i++)
+	{
+		ObjectSymbol *symbol = g_ptr_array_index(obj->symbols, i);
+		if (!symbol->defined && !symbol->global)
+		{
+			fprintf(stderr, "Object Error: undefined symbol '%s'\n",
+					symbol->name);
+			ok = false;
+		}
+	}
+
+	// Relative references within one section never change when the
+	// section moves, so they are final now.
+	guint kept = 0;
+	for (guint i = 0; i < obj->relocations->len; i++)
+	{
+		ObjectRelocation reloc =
+			g_array_index(obj->relocations, ObjectRelocation, i);
+		ObjectSymbol *symbol = reloc.symbol;
+		if (reloc.kind == OBJECT_RELOC_PC32 && symbol->defined &&
+			symbol->section == reloc.section)
+		{
+			int64_t distance = (int64_t)symbol->offset +
+							   reloc.addend - (int64_t)reloc.offset;
+			assert(distance == (int32_t)distance &&
+				   "Relative reference out of range");
+			int32_t field = (int32_t)distance;
+			memcpy(obj->sections[reloc.section]->data + reloc.offset,
+				   &field, sizeof(field));
+			continue;
+		}
+		g_array_index(obj->relocations, ObjectRelocation, kept++) =
+			reloc;
+	}
+	g_array_set_size(obj->relocations, kept);
+	return ok;
+}
+
+// ELF section header indices, in file order.
+enum
+{
+	ELF_SECTION_NULL,
+	ELF_SECTION_FIRST_CONTENT, // .text, .data, .rodata
+	ELF_SECTION_FIRST_RELA =
+		ELF_SECTION_FIRST_CONTENT + OBJECT_SECTION_COUNT,
+	ELF_SECTION_SYMTAB =
+		ELF_SECTION_FIRST_RELA + OBJECT_SECTION_COUNT,
+	ELF_SECTION_STRTAB,
+	ELF_SECTION_SHSTRTAB,
+	ELF_SECTION_NOTE_STACK,
+
+	ELF_SECTION_COUNT
+};
+
+static uint32_t string_table_add(GByteArray *table, const char *str)
+{
+	uint32_t offset = table->len;
+	g_byte_array_append(table, (const guint8 *)str, strlen(str) + 1);
+	return offset;
+}
+
+// Locals must precede globals in the symbol table; the section
+// symbols lead the locals.
+static GArray *elf_build_symbols(ObjectFile *obj,
+								 GByteArray *strtab,
+								 GHashTable *indices,
+								 uint32_t *first_global)
+{
+	GArray *syms = g_array_new(FALSE, TRUE, sizeof(Elf64_Sym));
+	Elf64_Sym null_sym = {0};
+	g_array_append_val(syms, null_sym);
+	for (int i = 0; i < OBJECT_SECTION_COUNT; i++)
+	{
+		Elf64_Sym sym = {
+			.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION),
+			.st_shndx = ELF_SECTION_FIRST_CONTENT + i,
+		};
+		g_array_append_val(syms, sym);
+	}
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		bool want_global = pass == 1;
+		if (want_global)
+		{
+			*first_global = syms->len;
+		}
+		for (guint i = 0; i < obj->symbols->len; i++)
+		{
+			ObjectSymbol *symbol = g_ptr_array_index(obj->symbols, i);
+			if (symbol->global != want_global)
+			{
+				continue;
+			}
+			Elf64_Sym sym = {
+				.st_name = string_table_add(strtab, symbol->name),
+				.st_info = ELF64_ST_INFO(
+					want_global ? STB_GLOBAL : STB_LOCAL, STT_NOTYPE),
+				.st_shndx = symbol->defined
+								? ELF_SECTION_FIRST_CONTENT +
+									  symbol->section
+								: SHN_UNDEF,
+				.st_value = symbol->defined ? symbol->offset : 0,
+			};
+			g_hash_table_insert(indices, symbol,
+								GUINT_TO_POINTER(syms->len));
+			g_array_append_val(syms, sym);
+		}
+	}
+	return syms;
+}
+
+static GArray *elf_build_relas(ObjectFile *obj,
+							   ObjectSection section,
+							   GHashTable *indices)
+{
+	GArray *relas = g_array_new(FALSE, TRUE, sizeof(Elf64_Rela));
+	for (guint i = 0; i < obj->relocations->len; i++)
+	{
+		ObjectRelocation *reloc =
+			&g_array_index(obj->relocations, ObjectRelocation, i);
+		if (reloc->section != section)
+		{
+			continue;
+		}
+		uint32_t sym_index = GPOINTER_TO_UINT(
+			g_hash_table_lookup(indices, reloc->symbol));
+		uint32_t type = reloc->kind == OBJECT_RELOC_ABS64
+							? R_X86_64_64
+							: R_X86_64_PC32;
+		Elf64_Rela rela = {
+			.r_offset = reloc->offset,
+			.r_info = ELF64_R_INFO(sym_index, type),
+			.r_addend = reloc->addend,
+		};
+		g_array_append_val(relas, rela);
+	}
+	return relas;
+}
+
+// Appends a section's contents to the image and fills in where it
+// landed.
+static void elf_place(GByteArray *image,
+					  Elf64_Shdr *header,
+					  const void *bytes,
+					  size_t len)
+{
+	pad_to_alignment(image, header->sh_addralign);
+	header->sh_offset = image->len;
+	header->sh_size = len;
+	g_byte_array_append(image, bytes, len);
+}
+
+bool object_file_write_elf(ObjectFile *obj, const char *filename)
+{
+	GByteArray *strtab = g_byte_array_new();
+	GByteArray *shstrtab = g_byte_array_new();
+	string_table_add(strtab, "");
+	string_table_add(shstrtab, "");
+
+	GHashTable *indices = g_hash_table_new(g_direct_hash,
+										   g_direct_equal);
+	uint32_t first_global = 0;
+	GArray *syms =
+		elf_build_symbols(obj, strtab, indices, &first_global);
+
+	Elf64_Shdr headers[ELF_SECTION_COUNT] = {0};
+	GByteArray *image = g_byte_array_new();
+	Elf64_Ehdr ehdr = {0};
+	g_byte_array_append(image, (const guint8 *)&ehdr, sizeof(ehdr));
+
+	static const uint64_t CONTENT_FLAGS[] = {
+		SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC | SHF_WRITE, SHF_ALLOC};
+	for (int i = 0; i < OBJECT_SECTION_COUNT; i++)
+	{
+		Elf64_Shdr *header = &headers[ELF_SECTION_FIRST_CONTENT + i];
+		header->sh_name =
+			string_table_add(shstrtab, SECTION_NAMES[i]);
+		header->sh_type = SHT_PROGBITS;
+		header->sh_flags = CONTENT_FLAGS[i];
+		header->sh_addralign = i == OBJECT_SECTION_TEXT ? 16 : 8;
+		elf_place(image, header, obj->sections[i]->data,
+				  obj->sections[i]->len);
+	}
+
+	for (int i = 0; i < OBJECT_SECTION_COUNT; i++)
+	{
+		GArray *relas = elf_build_relas(obj, i, indices);
+		Elf64_Shdr *header = &headers[ELF_SECTION_FIRST_RELA + i];
+		header->sh_name =
+			string_table_add(shstrtab, RELA_SECTION_NAMES[i]);
+		header->sh_type = SHT_RELA;
+		header->sh_flags = SHF_INFO_LINK;
+		header->sh_link = ELF_SECTION_SYMTAB;
+		header->sh_info = ELF_SECTION_FIRST_CONTENT + i;
+		header->sh_addralign = 8;
+		header->sh_entsize = sizeof(Elf64_Rela);
+		elf_place(image, header, relas->data,
+				  relas->len * sizeof(Elf64_Rela));
+		g_array_free(relas, TRUE);
+	}
+
+	Elf64_Shdr *symtab = &headers[ELF_SECTION_SYMTAB];
+	symtab->sh_name = string_table_add(shstrtab, ".symtab");
+	symtab->sh_type = SHT_SYMTAB;
+	symtab->sh_link = ELF_SECTION_STRTAB;
+	symtab->sh_info = first_global;
+	symtab->sh_addralign = 8;
+	symtab->sh_entsize = sizeof(Elf64_Sym);
+	elf_place(image, symtab, syms->data,
+			  syms->len * sizeof(Elf64_Sym));
+
+	Elf64_Shdr *strtab_header = &headers[ELF_SECTION_STRTAB];
+	strtab_header->sh_name = string_table_add(shstrtab, ".strtab");
+	strtab_header->sh_type = SHT_STRTAB;
+	strtab_header->sh_addralign = 1;
+	elf_place(image, strtab_header, strtab->data, strtab->len);
+
+	// Without this note the linker assumes the stack is executable.
+	Elf64_Shdr *note = &headers[ELF_SECTION_NOTE_STACK];
+	note->sh_name = string_table_add(shstrtab, ".note.GNU-stack");
+	note->sh_type = SHT_PROGBITS;
+	note->sh_addralign = 1;
+	note->sh_offset = image->len;
+
+	// Named last, since naming itself grows the table.
+	Elf64_Shdr *shstrtab_header = &headers[ELF_SECTION_SHSTRTAB];
+	shstrtab_header->sh_name =
+		string_table_add(shstrtab, ".shstrtab");
+	shstrtab_header->sh_type = SHT_STRTAB;
+	shstrtab_header->sh_addralign = 1;
+	elf_place(image, shstrtab_header, shstrtab->data, shstrtab->len);
+
+	pad_to_alignment(image, sizeof(uint64_t));
+	uint64_t section_headers_offset = image->len;
+	g_byte_array_append(image, (const guint8 *)headers,
+						sizeof(headers));
+
+	memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+	ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+	ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+	ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	ehdr.e_type = ET_REL;
+	ehdr.e_machine = EM_X86_64;
+	ehdr.e_version = EV_CURRENT;
+	ehdr.e_shoff = section_headers_offset;
+	ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+	ehdr.e_shentsize = sizeof(Elf64_Shdr);
+	ehdr.e_shnum = ELF_SECTION_COUNT;
+	ehdr.e_shstrndx = ELF_SECTION_SHSTRTAB;
+	memcpy(image->data, &ehdr, sizeof(ehdr));
+
+	bool ok = false;
+	FILE *file = fopen(filename, "wb");
+	if (file)
+	{
+		ok = fwrite(image->data, 1, image->len, file) == image->len;
+		ok = fclose(file) == 0 && ok;
+	}
+	if (!ok)
+	{
+		perror("Failed to write object file");
+	}
+
+	g_byte_array_free(image, TRUE);
+	g_array_free(syms, TRUE);
+	g_hash_table_destroy(indices);
+	g_byte_array_free(strtab, TRUE);
+	g_byte_array_free(shstrtab, TRUE);
+	return ok;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum ObjectSection
+{
+	OBJECT_SECTION_TEXT,
+	OBJECT_SECTION_DATA,
+	OBJECT_SECTION_RODATA,
+
+	OBJECT_SECTION_COUNT
+} ObjectSection;
+
+typedef enum ObjectRelocationKind
+{
+	// the 64-bit address of the symbol plus the addend
+	OBJECT_RELOC_ABS64,
+	// the 32-bit distance from the patched field to the symbol plus
+	// the addend
+	OBJECT_RELOC_PC32,
+} ObjectRelocationKind;
+
+typedef struct ObjectSymbol
+{
+	char *name;
+	bool defined;
+	// exported, or, when not defined, provided by another object
+	bool global;
+	ObjectSection section;
+	uint64_t offset;
+} ObjectSymbol;
+
+typedef struct ObjectRelocation
+{
+	ObjectSection section;
+	uint64_t offset;
+	ObjectRelocationKind kind;
+	ObjectSymbol *symbol;
+	int64_t addend;
+} ObjectRelocation;
+
+/**
+ * @brief Machine code and data being assembled into a relocatable
+ * object. Symbols may be referenced before they are defined; the
+ * references stay relocations until object_file_resolve.
+ */
+typedef struct ObjectFile
+{
+	GByteArray *sections[OBJECT_SECTION_COUNT];
+	// where data directives currently go, .data or .rodata
+	ObjectSection data_section;
+	// name -> ObjectSymbol, in the order first mentioned
+	GHashTable *symbols_by_name;
+	GPtrArray *symbols;
+	// ObjectRelocation
+	GArray *relocations;
+} ObjectFile;
+
+ObjectFile *object_file_create(void);
+void object_file_free(ObjectFile *obj);
+
+/** @brief Current size of a section, the offset of the next byte. */
+uint64_t object_file_offset(ObjectFile *obj, ObjectSection section);
+
+void object_file_append(ObjectFile *obj,
+						ObjectSection section,
+						const void *bytes,
+						size_t len);
+
+/** @brief Pads a section with zeros to a multiple of alignment. */
+void object_file_align(ObjectFile *obj,
+					   ObjectSection section,
+					   int alignment);
+
+/** @brief Returns the symbol called name, creating it undefined. */
+ObjectSymbol *object_file_symbol(ObjectFile *obj, const char *name);
+
+/** @brief Defines name at the current end of section. */
+void object_file_define(ObjectFile *obj,
+						ObjectSection section,
+						const char *name);
+
+/** @brief Marks name as exported if defined, or external if not. */
+void object_file_declare_global(ObjectFile *obj, const char *name);
+
+/**
+ * @brief Appends a zeroed field, 8 bytes for ABS64 and 4 for PC32,
+ * that is patched to refer to name plus addend.
+ */
+void object_file_append_reloc(ObjectFile *obj,
+							  ObjectSection section,
+							  ObjectRelocationKind kind,
+							  const char *name,
+							  int64_t addend);
+
+/**
+ * @brief Patches every PC32 reference to a symbol in the same section
+ * and drops its relocation. Fails, reporting the name, if a symbol
+ * is neither defined nor declared global.
+ */
+bool object_file_resolve(ObjectFile *obj);
+
+/**
+ * @brief Writes a resolved object as an ELF64 x86-64 relocatable
+ * file that the system linker accepts.
+ */
+bool object_file_write_elf(ObjectFile *obj, const char *filename);
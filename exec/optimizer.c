@@ -0,0 +1,499 @@
+#include "optimizer.h"
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+// Constants visible at some point in the program, one scope per let,
+// function or the top level. A name mapped to NULL is shadowed by a
+// binding that is not a constant.
+typedef struct ConstScope
+{
+	GHashTable *names; // name -> owned literal Node, or NULL
+	struct ConstScope *parent;
+} ConstScope;
+
+// A numeric literal while it is being folded.
+typedef struct FoldNum
+{
+	bool is_float;
+	long i_val;
+	double f_val;
+} FoldNum;
+
+static Node *fold_node(Node *node, ConstScope *scope);
+
+static ConstScope *const_scope_push(ConstScope *parent)
+{
+	ConstScope *scope = g_new(ConstScope, 1);
+	scope->names = g_hash_table_new_full(g_str_hash, g_str_equal,
+										 g_free, node_free_v);
+	scope->parent = parent;
+	return scope;
+}
+
+static ConstScope *const_scope_pop(ConstScope *scope)
+{
+	ConstScope *parent = scope->parent;
+	g_hash_table_destroy(scope->names);
+	g_free(scope);
+	return parent;
+}
+
+static void const_scope_bind(ConstScope *scope,
+							 const char *name,
+							 Node *literal)
+{
+	g_hash_table_insert(scope->names, g_strdup(name),
+						literal ? node_copy(literal) : NULL);
+}
+
+// Returns the constant bound to name, or NULL if it is shadowed or
+// not a known constant.
+static Node *const_scope_lookup(ConstScope *scope, const char *name)
+{
+	for (; scope; scope = scope->parent)
+	{
+		gpointer value;
+		if (g_hash_table_lookup_extended(scope->names, name, NULL,
+										 &value))
+		{
+			return value;
+		}
+	}
+	return NULL;
+}
+
+// Only constants that cost nothing to repeat are propagated: ints
+// and bools are immediates, and every copy of a float literal shares
+// one boxed constant in static data.
+static bool is_propagatable_literal(Node *node)
+{
+	return node->type == NODE_LITERAL &&
+		   (node->literal.lit_type == LIT_INT ||
+			node->literal.lit_type == LIT_FLOAT ||
+			node->literal.lit_type == LIT_BOOL);
+}
+
+static bool literal_to_num(Node *node, FoldNum *out)
+{
+	if (node->type != NODE_LITERAL)
+	{
+		return false;
+	}
+	if (node->literal.lit_type == LIT_INT)
+	{
+		*out = (FoldNum){.is_float = false,
+						 .i_val = node->literal.i_val};
+		return true;
+	}
+	if (node->literal.lit_type == LIT_FLOAT)
+	{
+		*out = (FoldNum){.is_float = true,
+						 .f_val = node->literal.f_val};
+		return true;
+	}
+	return false;
+}
+
+static double num_as_double(FoldNum num)
+{
+	return num.is_float ? num.f_val : (double)num.i_val;
+}
+
+// Applies one step of + - * the way the runtime does: in doubles if
+// either side is a float, otherwise in integers. Integer results must
+// stay within the range of an int literal.
+static bool fold_arith_step(char op,
+							FoldNum a,
+							FoldNum b,
+							FoldNum *out)
+{
+	if (a.is_float || b.is_float)
+	{
+		double x = num_as_double(a);
+		double y = num_as_double(b);
+		out->is_float = true;
+		out->f_val = (op == '+')   ? x + y
+					 : (op == '-') ? x - y
+								   : x * y;
+		return true;
+	}
+
+	// Both operands fit in an int, so the long result is exact.
+	long result = (op == '+')	? a.i_val + b.i_val
+				  : (op == '-') ? a.i_val - b.i_val
+								: a.i_val * b.i_val;
+	if (result < INT_MIN || result > INT_MAX)
+	{
+		return false;
+	}
+	out->is_float = false;
+	out->i_val = result;
+	return true;
+}
+
+static Node *fold_arith(char op, NodeArray *args)
+{
+	guint num_args = args->_array->len;
+	FoldNum acc;
+	if (num_args < 2 ||
+		!literal_to_num(node_array_index(args, 0), &acc))
+	{
+		return NULL;
+	}
+	for (guint i = 1; i < num_args; i++)
+	{
+		FoldNum next;
+		if (!literal_to_num(node_array_index(args, i), &next) ||
+			!fold_arith_step(op, acc, next, &acc))
+		{
+			return NULL;
+		}
+	}
+	return acc.is_float ? node_create_literal_float(acc.f_val)
+						: node_create_literal_int((int)acc.i_val);
+}
+
+static Node *fold_equal(NodeArray *args)
+{
+	if (args->_array->len != 2)
+	{
+		return NULL;
+	}
+	Node *lhs = node_array_index(args, 0);
+	Node *rhs = node_array_index(args, 1);
+
+	FoldNum a, b;
+	if (literal_to_num(lhs, &a) && literal_to_num(rhs, &b))
+	{
+		if (!a.is_float && !b.is_float)
+		{
+			return node_create_literal_bool(a.i_val == b.i_val);
+		}
+		return node_create_literal_bool(num_as_double(a) ==
+										num_as_double(b));
+	}
+	if (lhs->type == NODE_LITERAL && rhs->type == NODE_LITERAL &&
+		lhs->literal.lit_type == LIT_BOOL &&
+		rhs->literal.lit_type == LIT_BOOL)
+	{
+		return node_create_literal_bool(lhs->literal.b_val ==
+										rhs->literal.b_val);
+	}
+	return NULL;
+}
+
+// Folds < > <= >= over two numeric literals, comparing in doubles if
+// either is a float, like the runtime.
+static Node *fold_order(const char *name, NodeArray *args)
+{
+	FoldNum a, b;
+	if (args->_array->len != 2 ||
+		!literal_to_num(node_array_index(args, 0), &a) ||
+		!literal_to_num(node_array_index(args, 1), &b))
+	{
+		return NULL;
+	}
+
+	bool less, greater;
+	if (!a.is_float && !b.is_float)
+	{
+		less = a.i_val < b.i_val;
+		greater = a.i_val > b.i_val;
+	}
+	else
+	{
+		less = num_as_double(a) < num_as_double(b);
+		greater = num_as_double(a) > num_as_double(b);
+	}
+	// With a NaN neither holds, and neither does <= or >=.
+	bool equal = !a.is_float && !b.is_float
+					 ? a.i_val == b.i_val
+					 : num_as_double(a) == num_as_double(b);
+
+	if (strcmp(name, "<") == 0)
+		return node_create_literal_bool(less);
+	if (strcmp(name, ">") == 0)
+		return node_create_literal_bool(greater);
+	if (strcmp(name, "<=") == 0)
+		return node_create_literal_bool(less || equal);
+	return node_create_literal_bool(greater || equal);
+}
+
+// Returns a literal for a call to a pure builtin over literals, or
+// NULL if the call has to run.
+static Node *fold_builtin_call(Node *call_node)
+{
+	Node *fn = call_node->call.fn;
+	if (fn->type != NODE_VARIABLE)
+	{
+		return NULL;
+	}
+
+	const char *name = fn->variable.name;
+	if (strcmp(name, "+") == 0 || strcmp(name, "-") == 0 ||
+		strcmp(name, "*") == 0)
+	{
+		return fold_arith(name[0], call_node->call.args);
+	}
+	if (strcmp(name, "=") == 0)
+	{
+		return fold_equal(call_node->call.args);
+	}
+	if (strcmp(name, "<") == 0 || strcmp(name, ">") == 0 ||
+		strcmp(name, "<=") == 0 || strcmp(name, ">=") == 0)
+	{
+		return fold_order(name, call_node->call.args);
+	}
+	return NULL;
+}
+
+static void fold_node_array(NodeArray *nodes, ConstScope *scope)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		Node *folded = fold_node(node_array_index(nodes, i), scope);
+		g_ptr_array_index(nodes->_array, i) = folded;
+	}
+}
+
+static Node *fold_call(Node *node, ConstScope *scope)
+{
+	node->call.fn = fold_node(node->call.fn, scope);
+	fold_node_array(node->call.args, scope);
+
+	Node *folded = fold_builtin_call(node);
+	if (folded)
+	{
+		node_free(node);
+		return folded;
+	}
+	return node;
+}
+
+static bool literal_is_truthy(Node *literal)
+{
+	return !(literal->literal.lit_type == LIT_BOOL &&
+			 !literal->literal.b_val);
+}
+
+static Node *fold_if(Node *node, ConstScope *scope)
+{
+	node->if_expr.condition =
+		fold_node(node->if_expr.condition, scope);
+	node->if_expr.then_branch =
+		fold_node(node->if_expr.then_branch, scope);
+	if (node->if_expr.else_branch)
+	{
+		node->if_expr.else_branch =
+			fold_node(node->if_expr.else_branch, scope);
+	}
+
+	Node *condition = node->if_expr.condition;
+	if (condition->type != NODE_LITERAL)
+	{
+		return node;
+	}
+
+	Node *taken = NULL;
+	if (literal_is_truthy(condition))
+	{
+		taken = node->if_expr.then_branch;
+		node->if_expr.then_branch = NULL;
+	}
+	else if (node->if_expr.else_branch)
+	{
+		taken = node->if_expr.else_branch;
+		node->if_expr.else_branch = NULL;
+	}
+	else
+	{
+		// No else branch evaluates to nil, which has no literal.
+		return node;
+	}
+	node_free(node);
+	return taken;
+}
+
+static Node *fold_let(Node *node, ConstScope *scope)
+{
+	scope = const_scope_push(scope);
+
+	GPtrArray *bindings = node->let.bindings->_array;
+	for (guint i = 0; i < bindings->len;)
+	{
+		VarBinding *binding = g_ptr_array_index(bindings, i);
+		binding->value_expr = fold_node(binding->value_expr, scope);
+		if (is_propagatable_literal(binding->value_expr))
+		{
+			// Every use below is replaced, so the binding is dead.
+			const_scope_bind(scope, binding->name,
+							 binding->value_expr);
+			g_ptr_array_remove_index(bindings, i);
+			continue;
+		}
+		const_scope_bind(scope, binding->name, NULL);
+		i++;
+	}
+
+	fold_node_array(node->let.body, scope);
+	const_scope_pop(scope);
+
+	NodeArray *body = node->let.body;
+	if (bindings->len == 0 && body->_array->len == 1)
+	{
+		Node *only_expr = node_array_index(body, 0);
+		g_ptr_array_index(body->_array, 0) = NULL;
+		node_free(node);
+		return only_expr;
+	}
+	return node;
+}
+
+static Node *fold_function(Node *node, ConstScope *scope)
+{
+	ConstScope *body_scope = const_scope_push(scope);
+	StringArray *params = node->function.param_names;
+	for (guint i = 0; i < params->_array->len; i++)
+	{
+		const_scope_bind(body_scope, string_array_index(params, i),
+						 NULL);
+	}
+	fold_node_array(node->function.body, body_scope);
+	const_scope_pop(body_scope);
+
+	// Captured constants were substituted into the body, so the
+	// closure no longer needs to carry them.
+	GPtrArray *free_vars = node->function.free_var_names->_array;
+	for (guint i = 0; i < free_vars->len;)
+	{
+		const char *name = g_ptr_array_index(free_vars, i);
+		if (const_scope_lookup(scope, name))
+		{
+			g_ptr_array_remove_index(free_vars, i);
+			continue;
+		}
+		i++;
+	}
+	return node;
+}
+
+static Node *fold_node(Node *node, ConstScope *scope)
+{
+	switch (node->type)
+	{
+	case NODE_VARIABLE:
+	{
+		Node *constant =
+			const_scope_lookup(scope, node->variable.name);
+		if (constant)
+		{
+			node_free(node);
+			return node_copy(constant);
+		}
+		return node;
+	}
+	case NODE_CALL:
+		return fold_call(node, scope);
+	case NODE_IF:
+		return fold_if(node, scope);
+	case NODE_LET:
+		return fold_let(node, scope);
+	case NODE_FUNCTION:
+		return fold_function(node, scope);
+	case NODE_DEF:
+		node->def.binding->value_expr =
+			fold_node(node->def.binding->value_expr, scope);
+		return node;
+	case NODE_LITERAL:
+	case NODE_QUOTE:
+	case NODE_PLACEHOLDER:
+		return node;
+	}
+	assert(false && "Unhandled node type");
+	return node;
+}
+
+static void count_defs(Node *node, GHashTable *def_counts);
+
+static void count_defs_in_array(NodeArray *nodes,
+								GHashTable *def_counts)
+{
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		count_defs(node_array_index(nodes, i), def_counts);
+	}
+}
+
+// Counts the defs of every global name anywhere in the program.
+static void count_defs(Node *node, GHashTable *def_counts)
+{
+	if (!node)
+	{
+		return;
+	}
+	switch (node->type)
+	{
+	case NODE_DEF:
+	{
+		const char *name = node->def.binding->name;
+		int count = GPOINTER_TO_INT(
+			g_hash_table_lookup(def_counts, name));
+		g_hash_table_insert(def_counts, g_strdup(name),
+							GINT_TO_POINTER(count + 1));
+		count_defs(node->def.binding->value_expr, def_counts);
+		break;
+	}
+	case NODE_LET:
+		for (guint i = 0; i < node->let.bindings->_array->len; i++)
+		{
+			VarBinding *binding =
+				var_binding_array_index(node->let.bindings, i);
+			count_defs(binding->value_expr, def_counts);
+		}
+		count_defs_in_array(node->let.body, def_counts);
+		break;
+	case NODE_FUNCTION:
+		count_defs_in_array(node->function.body, def_counts);
+		break;
+	case NODE_CALL:
+		count_defs(node->call.fn, def_counts);
+		count_defs_in_array(node->call.args, def_counts);
+		break;
+	case NODE_IF:
+		count_defs(node->if_expr.condition, def_counts);
+		count_defs(node->if_expr.then_branch, def_counts);
+		count_defs(node->if_expr.else_branch, def_counts);
+		break;
+	default:
+		break;
+	}
+}
+
+void optimizer_run(NodeArray *ast)
+{
+	GHashTable *def_counts =
+		g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	count_defs_in_array(ast, def_counts);
+
+	ConstScope *globals = const_scope_push(NULL);
+	for (guint i = 0; i < ast->_array->len; i++)
+	{
+		Node *node = fold_node(node_array_index(ast, i), globals);
+		g_ptr_array_index(ast->_array, i) = node;
+
+		// A global defined once is constant in every later top-level
+		// form; earlier forms still read it at run time.
+		if (node->type == NODE_DEF &&
+			is_propagatable_literal(node->def.binding->value_expr) &&
+			GPOINTER_TO_INT(g_hash_table_lookup(
+				def_counts, node->def.binding->name)) == 1)
+		{
+			const_scope_bind(globals, node->def.binding->name,
+							 node->def.binding->value_expr);
+		}
+	}
+
+	const_scope_pop(globals);
+	g_hash_table_destroy(def_counts);
+}
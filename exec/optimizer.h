@@ -0,0 +1,11 @@
+#pragma once
+
+#include "node.h"
+
+/**
+ * @brief Rewrites the AST in place between parsing and codegen.
+ * Folds the pure builtins (+ - * =) over literals, propagates int and
+ * bool constants bound by let or by a top-level def that is never
+ * redefined, and drops if branches whose condition is a constant.
+ */
+void optimizer_run(NodeArray *ast);
@@ -11,6 +11,7 @@ static Node *parse_def(ParserContext *ctx, ParserEnv *env);
 static Node *parse_let(ParserContext *ctx, ParserEnv *env);
 static Node *parse_function(ParserContext *ctx, ParserEnv *env);
 static Node *parse_quote(ParserContext *ctx, ParserEnv *env);
+static Node *parse_literal_number(Token *token);
 static void synchronize(ParserContext *ctx);
 static void skip_whitespace_and_comments(struct ParserContext *ctx);
 
@@ -585,12 +586,98 @@ static Node *parse_let(ParserContext *ctx, ParserEnv *env)
 	return node_create_let(bindings, body_expressions, let_env);
 }
 
-static Node *parse_quote(ParserContext *ctx, ParserEnv *env)
+static Node *parse_datum(ParserContext *ctx);
+
+static Node *parse_datum_list(ParserContext *ctx)
+{
+	consume(ctx, TOKEN_LPAREN, "");
+	NodeArray *elements = node_array_new();
+
+	skip_whitespace_and_comments(ctx);
+	while (ctx->current_token.type != TOKEN_RPAREN)
+	{
+		if (ctx->current_token.type == TOKEN_EOF)
+		{
+			error_at_current_token(ctx, "Unterminated quoted list.");
+			node_array_free(elements);
+			return NULL;
+		}
+		Node *element = parse_datum(ctx);
+		if (element == NULL)
+		{
+			node_array_free(elements);
+			return NULL;
+		}
+		node_array_add(elements, element);
+		skip_whitespace_and_comments(ctx);
+	}
+	advance(ctx);
+	return node_create_quote_list(elements);
+}
+
+// Reads a datum without evaluating it: symbols are not looked up
+// and lists are not calls or special forms. 'x inside a datum reads
+// as (quote x).
+static Node *parse_datum(ParserContext *ctx)
 {
-	Node *quoted_expr = parse_expression(ctx, env);
-	if (quoted_expr == NULL)
+	skip_whitespace_and_comments(ctx);
+	Node *literal = NULL;
+	switch (ctx->current_token.type)
+	{
+	case TOKEN_LPAREN:
+		return parse_datum_list(ctx);
+	case TOKEN_QUOTE:
+	{
+		advance(ctx);
+		Node *quoted = parse_datum(ctx);
+		if (quoted == NULL)
+		{
+			return NULL;
+		}
+		Node *quote_symbol =
+			node_create_quote(node_create_literal_symbol("quote"));
+		NodeArray *elements = node_array_new();
+		node_array_add(elements, quote_symbol);
+		node_array_add(elements, quoted);
+		return node_create_quote_list(elements);
+	}
+	case TOKEN_NUMBER:
+		literal = parse_literal_number(&ctx->current_token);
+		break;
+	case TOKEN_SYMBOL:
+	{
+		const char *name = ctx->current_token.lexeme;
+		if (strcmp(name, "#t") == 0 || strcmp(name, "#f") == 0)
+		{
+			literal = node_create_literal_bool(name[1] == 't');
+		}
+		else
+		{
+			literal = node_create_literal_symbol(name);
+		}
+		break;
+	}
+	case TOKEN_EOF:
+		error_at_current_token(ctx, "Expected a datum after quote.");
 		return NULL;
-	return node_create_quote(quoted_expr);
+	case TOKEN_RPAREN:
+		error_at_current_token(ctx, "Unexpected ')'");
+		return NULL;
+	case TOKEN_ERROR:
+		error_at_current_token(ctx, ctx->current_token.lexeme);
+		return NULL;
+	default:
+		error_at_current_token(ctx, "Unsupported quoted datum.");
+		return NULL;
+	}
+	advance(ctx);
+	return node_create_quote(literal);
+}
+
+static Node *parse_quote(ParserContext *ctx, ParserEnv *env)
+{
+	(void)env;
+	return parse_datum(ctx);
 }
 
 static Node *
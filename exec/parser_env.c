@@ -60,12 +60,18 @@ Node *parser_env_lookup(ParserEnv *env, const char *name)
 				// ...and that ancestor scope is NOT the global scope
 				// (which has a NULL parent)...
 				// ...then it's a true lexical free variable that
-				// needs to be captured.
+				// needs to be captured, by every scope in between so
+				// that closures nested several levels deep can copy
+				// it from their parent.
 				if (current_env->parent != NULL)
 				{
-					g_hash_table_insert(env->free_vars,
-										g_strdup(name),
-										DUMMY_SET_VALUE);
+					for (ParserEnv *e = env; e != current_env;
+						 e = e->parent)
+					{
+						g_hash_table_insert(e->free_vars,
+											g_strdup(name),
+											DUMMY_SET_VALUE);
+					}
 				}
 			}
 			// We found what we were looking for. Return it directly.
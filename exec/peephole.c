@@ -0,0 +1,316 @@
+#include "peephole.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Register liveness is tracked only forward, within straight-line
+ * code: a label, jump, ret or syscall ends the scan and counts as a
+ * read of every register, so a rewrite never depends on code that
+ * is reachable another way.
+ */
+
+typedef uint64_t RegisterSet;
+
+static const char *PATTERN_NAMES[PEEPHOLE_PATTERN_COUNT] = {
+	[PEEPHOLE_PUSH_POP] = "push/pop pairs to mov",
+	[PEEPHOLE_FORWARD_MOVE] = "moves forwarded",
+	[PEEPHOLE_FORWARD_PUSH] = "pushes forwarded",
+	[PEEPHOLE_REDUNDANT_MOVE] = "redundant moves",
+	[PEEPHOLE_DEAD_STORE] = "dead stores",
+	[PEEPHOLE_JUMP_TO_NEXT] = "jumps to the next instruction",
+};
+
+static RegisterSet reg_bit(enum Register reg)
+{
+	return (RegisterSet)1 << reg;
+}
+
+static RegisterSet regs_range(enum Register first, enum Register last)
+{
+	return (reg_bit(last) << 1) - reg_bit(first);
+}
+
+// What a call reads: the argument registers, the argument count and
+// the closure pointer.
+static RegisterSet call_reads(void)
+{
+	return reg_bit(REG_RDI) | reg_bit(REG_RSI) | reg_bit(REG_RDX) |
+		   reg_bit(REG_RCX) | reg_bit(REG_R8) | reg_bit(REG_R9) |
+		   reg_bit(REG_R10) | reg_bit(REG_R12) | reg_bit(REG_RSP);
+}
+
+// What a call may overwrite: every caller-saved register.
+static RegisterSet call_clobbers(void)
+{
+	return reg_bit(REG_RAX) | reg_bit(REG_RCX) | reg_bit(REG_RDX) |
+		   reg_bit(REG_RSI) | reg_bit(REG_RDI) |
+		   regs_range(REG_R8, REG_R11) |
+		   regs_range(REG_XMM0, REG_XMM15);
+}
+
+static RegisterSet operand_reads(const AsmOperand *operand)
+{
+	switch (operand->kind)
+	{
+	case ASM_OPERAND_REG:
+	case ASM_OPERAND_MEMBASE:
+		return reg_bit(operand->reg);
+	default:
+		return 0;
+	}
+}
+
+static bool ends_straight_line(AsmOpcode opcode)
+{
+	switch (opcode)
+	{
+	case ASM_LABEL:
+	case ASM_JMP:
+	case ASM_JE:
+	case ASM_JNE:
+	case ASM_JA:
+	case ASM_JL:
+	case ASM_JLE:
+	case ASM_JG:
+	case ASM_JGE:
+	case ASM_JO:
+	case ASM_RET:
+	case ASM_SYSCALL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// The registers instr reads and the ones it overwrites. Anything
+// that both reads and writes a register, like add, counts as a read.
+static void instr_effects(const AsmInstr *instr,
+						  RegisterSet *reads,
+						  RegisterSet *writes)
+{
+	const AsmOperand *dest = &instr->dest;
+	RegisterSet dest_reg =
+		dest->kind == ASM_OPERAND_REG ? reg_bit(dest->reg) : 0;
+	*reads = operand_reads(&instr->src);
+	*writes = 0;
+	switch (instr->opcode)
+	{
+	case ASM_MOV:
+	case ASM_LEA:
+	case ASM_MOVSD:
+		if (dest_reg)
+			*writes = dest_reg;
+		else
+			*reads |= operand_reads(dest);
+		break;
+	case ASM_PUSH:
+		*reads |= operand_reads(dest) | reg_bit(REG_RSP);
+		break;
+	case ASM_POP:
+		*reads |= reg_bit(REG_RSP);
+		*writes = dest_reg;
+		break;
+	case ASM_CALL:
+		*reads |= operand_reads(dest) | call_reads();
+		*writes = call_clobbers();
+		break;
+	default:
+		*reads |= operand_reads(dest);
+		break;
+	}
+}
+
+// Index of the first instruction at or after i that is not a
+// comment; comments exist only in the text output, and must not
+// change what the pass does.
+static guint skip_comments(GArray *code, guint i)
+{
+	while (i < code->len &&
+		   g_array_index(code, AsmInstr, i).opcode == ASM_COMMENT)
+	{
+		i++;
+	}
+	return i;
+}
+
+// Whether the value in reg after instruction i is never read.
+static bool is_dead_after(GArray *code, guint i, enum Register reg)
+{
+	if (reg == REG_RSP || reg == REG_RBP)
+		return false;
+	for (guint k = skip_comments(code, i + 1); k < code->len;
+		 k = skip_comments(code, k + 1))
+	{
+		const AsmInstr *instr = &g_array_index(code, AsmInstr, k);
+		if (ends_straight_line(instr->opcode))
+			return false;
+		RegisterSet reads, writes;
+		instr_effects(instr, &reads, &writes);
+		if (reads & reg_bit(reg))
+			return false;
+		if (writes & reg_bit(reg))
+			return true;
+	}
+	return false;
+}
+
+static bool is_general_reg(const AsmOperand *operand)
+{
+	return operand->kind == ASM_OPERAND_REG &&
+		   operand->reg < REG_XMM0 && operand->reg != REG_RSP;
+}
+
+static bool is_reg(const AsmOperand *operand, enum Register reg)
+{
+	return operand->kind == ASM_OPERAND_REG && operand->reg == reg;
+}
+
+// A mov between general registers, or into one.
+static bool is_move_to_reg(const AsmInstr *instr)
+{
+	return instr->opcode == ASM_MOV && is_general_reg(&instr->dest);
+}
+
+// Whether a push can take operand directly: push has no 64-bit
+// immediate form.
+static bool can_push(const AsmOperand *operand)
+{
+	switch (operand->kind)
+	{
+	case ASM_OPERAND_REG:
+	case ASM_OPERAND_MEMBASE:
+	case ASM_OPERAND_MEM_LABEL:
+		return true;
+	case ASM_OPERAND_IMM:
+		return operand->value == (int32_t)operand->value;
+	default:
+		return false;
+	}
+}
+
+// Whether the labels starting at index i include label.
+static bool labels_include(GArray *code, guint i, const char *label)
+{
+	for (i = skip_comments(code, i); i < code->len;
+		 i = skip_comments(code, i + 1))
+	{
+		const AsmInstr *instr = &g_array_index(code, AsmInstr, i);
+		if (instr->opcode != ASM_LABEL)
+			return false;
+		if (g_str_equal(instr->dest.label, label))
+			return true;
+	}
+	return false;
+}
+
+// Tries every pattern on the instruction at i, and the one after it
+// when the pattern spans two. Returns whether anything changed.
+static bool rewrite_at(GArray *code, guint i, PeepholeStats *stats)
+{
+	AsmInstr *first = &g_array_index(code, AsmInstr, i);
+	guint j = skip_comments(code, i + 1);
+	AsmInstr *second =
+		j < code->len ? &g_array_index(code, AsmInstr, j) : NULL;
+
+	if (is_move_to_reg(first) && is_reg(&first->src, first->dest.reg))
+	{
+		g_array_remove_index(code, i);
+		stats->hits[PEEPHOLE_REDUNDANT_MOVE]++;
+		return true;
+	}
+
+	if (first->opcode == ASM_JMP &&
+		first->dest.kind == ASM_OPERAND_LABEL &&
+		labels_include(code, i + 1, first->dest.label))
+	{
+		g_array_remove_index(code, i);
+		stats->hits[PEEPHOLE_JUMP_TO_NEXT]++;
+		return true;
+	}
+
+	bool sets_reg =
+		is_move_to_reg(first) ||
+		(first->opcode == ASM_LEA && is_general_reg(&first->dest));
+	if (sets_reg && is_dead_after(code, i, first->dest.reg))
+	{
+		g_array_remove_index(code, i);
+		stats->hits[PEEPHOLE_DEAD_STORE]++;
+		return true;
+	}
+
+	if (!second)
+		return false;
+
+	if (first->opcode == ASM_PUSH && second->opcode == ASM_POP &&
+		is_general_reg(&second->dest) &&
+		(first->dest.kind != ASM_OPERAND_REG ||
+		 is_general_reg(&first->dest)))
+	{
+		second->opcode = ASM_MOV;
+		second->src = first->dest;
+		g_array_remove_index(code, i);
+		stats->hits[PEEPHOLE_PUSH_POP]++;
+		return true;
+	}
+
+	if (!is_move_to_reg(first))
+		return false;
+	enum Register temp = first->dest.reg;
+
+	if (is_move_to_reg(second) && is_general_reg(&first->src) &&
+		is_reg(&second->dest, first->src.reg) &&
+		is_reg(&second->src, temp))
+	{
+		g_array_remove_index(code, j);
+		stats->hits[PEEPHOLE_REDUNDANT_MOVE]++;
+		return true;
+	}
+
+	if (is_move_to_reg(second) && is_reg(&second->src, temp) &&
+		is_dead_after(code, j, temp))
+	{
+		second->src = first->src;
+		g_array_remove_index(code, i);
+		stats->hits[PEEPHOLE_FORWARD_MOVE]++;
+		return true;
+	}
+
+	if (second->opcode == ASM_PUSH && is_reg(&second->dest, temp) &&
+		can_push(&first->src) && is_dead_after(code, j, temp))
+	{
+		second->dest = first->src;
+		g_array_remove_index(code, i);
+		stats->hits[PEEPHOLE_FORWARD_PUSH]++;
+		return true;
+	}
+	return false;
+}
+
+void peephole_run(GArray *code, PeepholeStats *stats)
+{
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (guint i = 0; i < code->len; i++)
+		{
+			// retry the same spot: a rewrite may enable another
+			while (i < code->len && rewrite_at(code, i, stats))
+			{
+				changed = true;
+			}
+		}
+	}
+}
+
+void peephole_print_stats(const PeepholeStats *stats, FILE *out)
+{
+	long total = 0;
+	for (int i = 0; i < PEEPHOLE_PATTERN_COUNT; i++)
+	{
+		fprintf(out, "  %-30s %ld\n", PATTERN_NAMES[i],
+				stats->hits[i]);
+		total += stats->hits[i];
+	}
+	fprintf(out, "  %-30s %ld\n", "total", total);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "asm_instr.h"
+#include <glib.h>
+#include <stdio.h>
+
+typedef enum PeepholePattern
+{
+	// push X; pop Y -> mov Y, X
+	PEEPHOLE_PUSH_POP,
+	// mov R, X; mov Y, R -> mov Y, X, when R is dead after
+	PEEPHOLE_FORWARD_MOVE,
+	// mov R, X; push R -> push X, when R is dead after
+	PEEPHOLE_FORWARD_PUSH,
+	// mov R, R, and the second of mov A, B; mov B, A
+	PEEPHOLE_REDUNDANT_MOVE,
+	// mov R, X or lea R, X, when R is written again before any read
+	PEEPHOLE_DEAD_STORE,
+	// jmp L straight before L:
+	PEEPHOLE_JUMP_TO_NEXT,
+
+	PEEPHOLE_PATTERN_COUNT
+} PeepholePattern;
+
+typedef struct PeepholeStats
+{
+	long hits[PEEPHOLE_PATTERN_COUNT];
+} PeepholeStats;
+
+/**
+ * @brief Rewrites one function's instructions in place until no
+ * pattern applies, counting each rewrite in stats.
+ * @param code AsmInstr records, as buffered by the writer.
+ */
+void peephole_run(GArray *code, PeepholeStats *stats);
+
+/** @brief Prints the hit count of every pattern, one per line. */
+void peephole_print_stats(const PeepholeStats *stats, FILE *out);
@@ -0,0 +1,40 @@
+#include "runtime_symbols.h"
+#include "gc.h"
+#include "runtime.h"
+#include "symbol.h"
+#include <string.h>
+
+const RuntimeSymbol RUNTIME_SYMBOLS[] = {
+	{"gc_alloc", NULL, (void *)gc_alloc},
+	{"lisp_gc_init", NULL, (void *)lisp_gc_init},
+	{"lisp_nursery", NULL, (void *)lisp_nursery},
+	{"lisp_symbols_init", NULL, (void *)lisp_symbols_init},
+	{"lispvalue_create_float", NULL, (void *)lispvalue_create_float},
+	{"lisp_arity_error", NULL, (void *)lisp_arity_error},
+	{"lisp_unbox_double", NULL, (void *)lisp_unbox_double},
+	{"lisp_print", "print-debug", (void *)lisp_print},
+	{"lisp_add", "+", (void *)lisp_add},
+	{"lisp_subtract", "-", (void *)lisp_subtract},
+	{"lisp_multiply", "*", (void *)lisp_multiply},
+	{"lisp_divide", "/", (void *)lisp_divide},
+	{"lisp_equal", "=", (void *)lisp_equal},
+	{"lisp_less", "<", (void *)lisp_less},
+	{"lisp_greater", ">", (void *)lisp_greater},
+	{"lisp_less_equal", "<=", (void *)lisp_less_equal},
+	{"lisp_greater_equal", ">=", (void *)lisp_greater_equal},
+};
+
+const size_t NUM_RUNTIME_SYMBOLS =
+	sizeof(RUNTIME_SYMBOLS) / sizeof(RUNTIME_SYMBOLS[0]);
+
+void *runtime_symbol_address(const char *name)
+{
+	for (size_t i = 0; i < NUM_RUNTIME_SYMBOLS; i++)
+	{
+		if (strcmp(RUNTIME_SYMBOLS[i].name, name) == 0)
+		{
+			return RUNTIME_SYMBOLS[i].address;
+		}
+	}
+	return NULL;
+}
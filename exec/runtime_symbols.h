@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief A runtime function or variable that generated code refers
+ * to by name.
+ */
+typedef struct RuntimeSymbol
+{
+	const char *name;
+	// the Lisp builtin the function implements, or NULL
+	const char *builtin;
+	void *address;
+} RuntimeSymbol;
+
+// Everything generated code may declare extern. Codegen emits the
+// externs and maps builtins from it, and the JIT binds it, so a new
+// entry point only needs adding here.
+extern const RuntimeSymbol RUNTIME_SYMBOLS[];
+extern const size_t NUM_RUNTIME_SYMBOLS;
+
+/** @brief The address of a runtime symbol, or NULL if unknown. */
+void *runtime_symbol_address(const char *name);
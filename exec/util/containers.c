@@ -81,6 +81,18 @@ void string_array_sort(StringArray *array)
 	g_ptr_array_sort(array->_array, (GCompareFunc)compare_strings);
 }
 
+bool string_array_contains(StringArray *array, const char *element)
+{
+	for (guint i = 0; i < array->_array->len; i++)
+	{
+		if (g_strcmp0(string_array_index(array, i), element) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 void string_array_free(StringArray *array)
 {
 	g_ptr_array_free(array->_array, TRUE);
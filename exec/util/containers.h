@@ -24,6 +24,7 @@ void string_array_add(StringArray *array, char *element);
 char *string_array_index(StringArray *array, int index);
 StringArray *string_array_copy(StringArray *array);
 void string_array_sort(StringArray *array);
+bool string_array_contains(StringArray *array, const char *element);
 void string_array_free(StringArray *array);
 
 typedef struct VarBinding
@@ -0,0 +1,451 @@
+#include "x86_encoder.h"
+#include <assert.h>
+
+#define REX_BASE 0x40
+#define REX_W 0x08
+#define REX_R 0x04
+#define REX_B 0x01
+
+#define PREFIX_NONE 0x00
+#define PREFIX_SCALAR_DOUBLE 0xF2
+
+#define MOD_DISP0 0x00
+#define MOD_DISP8 0x40
+#define MOD_DISP32 0x80
+#define MOD_REGISTER 0xC0
+#define RM_NEEDS_SIB 4
+#define RM_RIP_OR_DISP32 5
+#define SIB_NO_INDEX 0x24
+
+static void put_byte(ObjectFile *obj, uint8_t byte)
+{
+	object_file_append(obj, OBJECT_SECTION_TEXT, &byte, 1);
+}
+
+static void put_imm32(ObjectFile *obj, int32_t imm)
+{
+	object_file_append(obj, OBJECT_SECTION_TEXT, &imm, sizeof(imm));
+}
+
+static void put_imm64(ObjectFile *obj, int64_t imm)
+{
+	object_file_append(obj, OBJECT_SECTION_TEXT, &imm, sizeof(imm));
+}
+
+static bool fits_int8(int64_t value)
+{
+	return value == (int8_t)value;
+}
+
+static bool fits_int32(int64_t value)
+{
+	return value == (int32_t)value;
+}
+
+// The 4-bit hardware number; XMM registers count from zero too.
+static int reg_number(enum Register reg)
+{
+	return reg >= REG_XMM0 ? reg - REG_XMM0 : reg;
+}
+
+// Emits the legacy prefix, the REX byte when one is needed, and an
+// opcode of one or two bytes (0x0F escapes included).
+static void put_prefix_rex_opcode(ObjectFile *obj,
+								  uint8_t prefix,
+								  bool wide,
+								  int reg,
+								  int rm,
+								  uint32_t opcode)
+{
+	if (prefix != PREFIX_NONE)
+	{
+		put_byte(obj, prefix);
+	}
+	uint8_t rex = (wide ? REX_W : 0) | (reg >= 8 ? REX_R : 0) |
+				  (rm >= 8 ? REX_B : 0);
+	if (rex)
+	{
+		put_byte(obj, REX_BASE | rex);
+	}
+	if (opcode > 0xFF)
+	{
+		put_byte(obj, opcode >> 8);
+	}
+	put_byte(obj, opcode & 0xFF);
+}
+
+// op reg, rm with both operands in registers. reg may also be the
+// /digit opcode extension.
+static void encode_reg_reg(ObjectFile *obj,
+						   uint8_t prefix,
+						   bool wide,
+						   uint32_t opcode,
+						   int reg,
+						   int rm)
+{
+	put_prefix_rex_opcode(obj, prefix, wide, reg, rm, opcode);
+	put_byte(obj, MOD_REGISTER | (reg & 7) << 3 | (rm & 7));
+}
+
+// op reg, [base + offset], with the shortest displacement. RSP and
+// R12 as a base need a SIB byte, and RBP and R13 always need a
+// displacement.
+static void encode_reg_membase(ObjectFile *obj,
+							   uint8_t prefix,
+							   bool wide,
+							   uint32_t opcode,
+							   int reg,
+							   int base,
+							   int32_t offset)
+{
+	put_prefix_rex_opcode(obj, prefix, wide, reg, base, opcode);
+	int rm = base & 7;
+	uint8_t mod = MOD_DISP32;
+	if (offset == 0 && rm != RM_RIP_OR_DISP32)
+	{
+		mod = MOD_DISP0;
+	}
+	else if (fits_int8(offset))
+	{
+		mod = MOD_DISP8;
+	}
+	put_byte(obj, mod | (reg & 7) << 3 | rm);
+	if (rm == RM_NEEDS_SIB)
+	{
+		put_byte(obj, SIB_NO_INDEX);
+	}
+	if (mod == MOD_DISP8)
+	{
+		put_byte(obj, (uint8_t)offset);
+	}
+	else if (mod == MOD_DISP32)
+	{
+		put_imm32(obj, offset);
+	}
+}
+
+// op reg, [rel label + addend]. The displacement is the last field
+// of every instruction using this form, so it is relative to the
+// address 4 bytes past its start.
+static void encode_reg_rip(ObjectFile *obj,
+						   uint8_t prefix,
+						   bool wide,
+						   uint32_t opcode,
+						   int reg,
+						   const char *label,
+						   int64_t addend)
+{
+	put_prefix_rex_opcode(obj, prefix, wide, reg, 0, opcode);
+	put_byte(obj, MOD_DISP0 | (reg & 7) << 3 | RM_RIP_OR_DISP32);
+	object_file_append_reloc(obj, OBJECT_SECTION_TEXT,
+							 OBJECT_RELOC_PC32, label,
+							 addend - (int64_t)sizeof(int32_t));
+}
+
+static void put_rel32(ObjectFile *obj, const char *label)
+{
+	object_file_append_reloc(obj, OBJECT_SECTION_TEXT,
+							 OBJECT_RELOC_PC32, label,
+							 -(int64_t)sizeof(int32_t));
+}
+
+static bool is_general(enum Register reg) { return reg < REG_XMM0; }
+
+static bool is_xmm(enum Register reg)
+{
+	return reg >= REG_XMM0 && reg < REG_COUNT;
+}
+
+void x86_encode_push_reg(ObjectFile *obj, enum Register reg)
+{
+	assert(is_general(reg));
+	put_prefix_rex_opcode(obj, PREFIX_NONE, false, 0, reg,
+						  0x50 + (reg & 7));
+}
+
+void x86_encode_push_imm(ObjectFile *obj, int32_t imm)
+{
+	if (fits_int8(imm))
+	{
+		put_byte(obj, 0x6A);
+		put_byte(obj, (uint8_t)imm);
+		return;
+	}
+	put_byte(obj, 0x68);
+	put_imm32(obj, imm);
+}
+
+void x86_encode_push_rip(ObjectFile *obj,
+						 const char *label,
+						 int64_t addend)
+{
+	encode_reg_rip(obj, PREFIX_NONE, false, 0xFF, 6, label, addend);
+}
+
+void x86_encode_push_membase(ObjectFile *obj,
+							 enum Register base,
+							 int32_t offset)
+{
+	assert(is_general(base));
+	encode_reg_membase(obj, PREFIX_NONE, false, 0xFF, 6, base,
+					   offset);
+}
+
+void x86_encode_pop_reg(ObjectFile *obj, enum Register reg)
+{
+	assert(is_general(reg));
+	put_prefix_rex_opcode(obj, PREFIX_NONE, false, 0, reg,
+						  0x58 + (reg & 7));
+}
+
+void x86_encode_mov_reg_reg(ObjectFile *obj,
+							enum Register dest,
+							enum Register src)
+{
+	assert(is_general(dest) && is_general(src));
+	encode_reg_reg(obj, PREFIX_NONE, true, 0x89, src, dest);
+}
+
+void x86_encode_mov_reg_imm(ObjectFile *obj,
+							enum Register dest,
+							int64_t imm)
+{
+	assert(is_general(dest));
+	if (imm >= 0 && imm <= UINT32_MAX)
+	{
+		// A 32-bit mov clears the upper half.
+		put_prefix_rex_opcode(obj, PREFIX_NONE, false, 0, dest,
+							  0xB8 + (dest & 7));
+		put_imm32(obj, (int32_t)(uint32_t)imm);
+	}
+	else if (fits_int32(imm))
+	{
+		encode_reg_reg(obj, PREFIX_NONE, true, 0xC7, 0, dest);
+		put_imm32(obj, (int32_t)imm);
+	}
+	else
+	{
+		put_prefix_rex_opcode(obj, PREFIX_NONE, true, 0, dest,
+							  0xB8 + (dest & 7));
+		put_imm64(obj, imm);
+	}
+}
+
+void x86_encode_mov_reg_address(ObjectFile *obj,
+								enum Register dest,
+								const char *label,
+								int64_t addend)
+{
+	assert(is_general(dest));
+	put_prefix_rex_opcode(obj, PREFIX_NONE, true, 0, dest,
+						  0xB8 + (dest & 7));
+	object_file_append_reloc(obj, OBJECT_SECTION_TEXT,
+							 OBJECT_RELOC_ABS64, label, addend);
+}
+
+void x86_encode_mov_reg_rip(ObjectFile *obj,
+							enum Register dest,
+							const char *label,
+							int64_t addend)
+{
+	assert(is_general(dest));
+	encode_reg_rip(obj, PREFIX_NONE, true, 0x8B, dest, label, addend);
+}
+
+void x86_encode_mov_rip_reg(ObjectFile *obj,
+							const char *label,
+							int64_t addend,
+							enum Register src)
+{
+	assert(is_general(src));
+	encode_reg_rip(obj, PREFIX_NONE, true, 0x89, src, label, addend);
+}
+
+void x86_encode_mov_reg_membase(ObjectFile *obj,
+								enum Register dest,
+								enum Register base,
+								int32_t offset)
+{
+	assert(is_general(dest) && is_general(base));
+	encode_reg_membase(obj, PREFIX_NONE, true, 0x8B, dest, base,
+					   offset);
+}
+
+void x86_encode_mov_membase_reg(ObjectFile *obj,
+								enum Register base,
+								int32_t offset,
+								enum Register src)
+{
+	assert(is_general(src) && is_general(base));
+	encode_reg_membase(obj, PREFIX_NONE, true, 0x89, src, base,
+					   offset);
+}
+
+void x86_encode_lea_reg_membase(ObjectFile *obj,
+								enum Register dest,
+								enum Register base,
+								int32_t offset)
+{
+	assert(is_general(dest) && is_general(base));
+	encode_reg_membase(obj, PREFIX_NONE, true, 0x8D, dest, base,
+					   offset);
+}
+
+void x86_encode_movsd_reg_rip(ObjectFile *obj,
+							  enum Register dest,
+							  const char *label,
+							  int64_t addend)
+{
+	assert(is_xmm(dest));
+	encode_reg_rip(obj, PREFIX_SCALAR_DOUBLE, false, 0x0F10,
+				   reg_number(dest), label, addend);
+}
+
+void x86_encode_movsd_reg_membase(ObjectFile *obj,
+								  enum Register dest,
+								  enum Register base,
+								  int32_t offset)
+{
+	assert(is_xmm(dest) && is_general(base));
+	encode_reg_membase(obj, PREFIX_SCALAR_DOUBLE, false, 0x0F10,
+					   reg_number(dest), base, offset);
+}
+
+void x86_encode_movsd_membase_reg(ObjectFile *obj,
+								  enum Register base,
+								  int32_t offset,
+								  enum Register src)
+{
+	assert(is_xmm(src) && is_general(base));
+	encode_reg_membase(obj, PREFIX_SCALAR_DOUBLE, false, 0x0F11,
+					   reg_number(src), base, offset);
+}
+
+void x86_encode_sse_reg_reg(ObjectFile *obj,
+							X86SseOp op,
+							enum Register dest,
+							enum Register src)
+{
+	assert(is_xmm(dest) && is_xmm(src));
+	encode_reg_reg(obj, PREFIX_SCALAR_DOUBLE, false, 0x0F00 | op,
+				   reg_number(dest), reg_number(src));
+}
+
+void x86_encode_cvtsi2sd_reg_reg(ObjectFile *obj,
+								 enum Register dest,
+								 enum Register src)
+{
+	assert(is_xmm(dest) && is_general(src));
+	encode_reg_reg(obj, PREFIX_SCALAR_DOUBLE, true, 0x0F2A,
+				   reg_number(dest), src);
+}
+
+void x86_encode_alu_reg_reg(ObjectFile *obj,
+							X86AluOp op,
+							enum Register dest,
+							enum Register src)
+{
+	assert(is_general(dest) && is_general(src));
+	encode_reg_reg(obj, PREFIX_NONE, true, op << 3 | 0x01, src, dest);
+}
+
+void x86_encode_alu_reg_imm(ObjectFile *obj,
+							X86AluOp op,
+							enum Register reg,
+							int32_t imm)
+{
+	assert(is_general(reg));
+	if (fits_int8(imm))
+	{
+		encode_reg_reg(obj, PREFIX_NONE, true, 0x83, op, reg);
+		put_byte(obj, (uint8_t)imm);
+		return;
+	}
+	encode_reg_reg(obj, PREFIX_NONE, true, 0x81, op, reg);
+	put_imm32(obj, imm);
+}
+
+void x86_encode_cmp_reg_membase(ObjectFile *obj,
+								enum Register reg,
+								enum Register base,
+								int32_t offset)
+{
+	assert(is_general(reg) && is_general(base));
+	encode_reg_membase(obj, PREFIX_NONE, true,
+					   X86_ALU_CMP << 3 | 0x03, reg, base, offset);
+}
+
+void x86_encode_imul_reg_reg(ObjectFile *obj,
+							 enum Register dest,
+							 enum Register src)
+{
+	assert(is_general(dest) && is_general(src));
+	encode_reg_reg(obj, PREFIX_NONE, true, 0x0FAF, dest, src);
+}
+
+void x86_encode_sar_reg_imm(ObjectFile *obj,
+							enum Register reg,
+							uint8_t imm)
+{
+	assert(is_general(reg));
+	if (imm == 1)
+	{
+		encode_reg_reg(obj, PREFIX_NONE, true, 0xD1, 7, reg);
+		return;
+	}
+	encode_reg_reg(obj, PREFIX_NONE, true, 0xC1, 7, reg);
+	put_byte(obj, imm);
+}
+
+void x86_encode_test_reg_imm(ObjectFile *obj,
+							 enum Register reg,
+							 int32_t imm)
+{
+	assert(is_general(reg));
+	encode_reg_reg(obj, PREFIX_NONE, true, 0xF7, 0, reg);
+	put_imm32(obj, imm);
+}
+
+void x86_encode_call_reg(ObjectFile *obj, enum Register target)
+{
+	assert(is_general(target));
+	encode_reg_reg(obj, PREFIX_NONE, false, 0xFF, 2, target);
+}
+
+void x86_encode_call_label(ObjectFile *obj, const char *label)
+{
+	put_byte(obj, 0xE8);
+	put_rel32(obj, label);
+}
+
+void x86_encode_jmp_label(ObjectFile *obj, const char *label)
+{
+	put_byte(obj, 0xE9);
+	put_rel32(obj, label);
+}
+
+void x86_encode_jcc_label(ObjectFile *obj,
+						  X86Condition cc,
+						  const char *label)
+{
+	put_byte(obj, 0x0F);
+	put_byte(obj, 0x80 | cc);
+	put_rel32(obj, label);
+}
+
+void x86_encode_jmp_membase(ObjectFile *obj,
+							enum Register base,
+							int32_t offset)
+{
+	assert(is_general(base));
+	encode_reg_membase(obj, PREFIX_NONE, false, 0xFF, 4, base,
+					   offset);
+}
+
+void x86_encode_ret(ObjectFile *obj) { put_byte(obj, 0xC3); }
+
+void x86_encode_syscall(ObjectFile *obj)
+{
+	put_byte(obj, 0x0F);
+	put_byte(obj, 0x05);
+}
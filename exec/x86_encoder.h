@@ -0,0 +1,148 @@
+#pragma once
+
+#include "asm_instr.h"
+#include "object_file.h"
+#include <stdint.h>
+
+// Machine code for the instructions the code generator emits. Every
+// function appends one instruction to the text section of obj.
+// Label operands may be defined anywhere, before or after the
+// reference, and are resolved through obj's relocations.
+
+// The /digit of the 0x83 and 0x81 group, and opcode bits 3-5 of the
+// register forms.
+typedef enum X86AluOp
+{
+	X86_ALU_ADD = 0,
+	X86_ALU_OR = 1,
+	X86_ALU_AND = 4,
+	X86_ALU_SUB = 5,
+	X86_ALU_XOR = 6,
+	X86_ALU_CMP = 7,
+} X86AluOp;
+
+// The condition nibble of Jcc.
+typedef enum X86Condition
+{
+	X86_CC_O = 0x0,
+	X86_CC_E = 0x4,
+	X86_CC_NE = 0x5,
+	X86_CC_A = 0x7,
+	X86_CC_L = 0xC,
+	X86_CC_GE = 0xD,
+	X86_CC_LE = 0xE,
+	X86_CC_G = 0xF,
+} X86Condition;
+
+// The second opcode byte of the scalar double instructions.
+typedef enum X86SseOp
+{
+	X86_SSE_ADD = 0x58,
+	X86_SSE_MUL = 0x59,
+	X86_SSE_SUB = 0x5C,
+	X86_SSE_DIV = 0x5E,
+} X86SseOp;
+
+void x86_encode_push_reg(ObjectFile *obj, enum Register reg);
+void x86_encode_push_imm(ObjectFile *obj, int32_t imm);
+// push qword [label + addend]
+void x86_encode_push_rip(ObjectFile *obj,
+						 const char *label,
+						 int64_t addend);
+// push qword [base + offset]
+void x86_encode_push_membase(ObjectFile *obj,
+							 enum Register base,
+							 int32_t offset);
+void x86_encode_pop_reg(ObjectFile *obj, enum Register reg);
+
+void x86_encode_mov_reg_reg(ObjectFile *obj,
+							enum Register dest,
+							enum Register src);
+/** @brief Picks the shortest of the three mov-immediate forms. */
+void x86_encode_mov_reg_imm(ObjectFile *obj,
+							enum Register dest,
+							int64_t imm);
+// mov dest, label + addend (the absolute address)
+void x86_encode_mov_reg_address(ObjectFile *obj,
+								enum Register dest,
+								const char *label,
+								int64_t addend);
+// mov dest, [label + addend]
+void x86_encode_mov_reg_rip(ObjectFile *obj,
+							enum Register dest,
+							const char *label,
+							int64_t addend);
+// mov [label + addend], src
+void x86_encode_mov_rip_reg(ObjectFile *obj,
+							const char *label,
+							int64_t addend,
+							enum Register src);
+void x86_encode_mov_reg_membase(ObjectFile *obj,
+								enum Register dest,
+								enum Register base,
+								int32_t offset);
+void x86_encode_mov_membase_reg(ObjectFile *obj,
+								enum Register base,
+								int32_t offset,
+								enum Register src);
+void x86_encode_lea_reg_membase(ObjectFile *obj,
+								enum Register dest,
+								enum Register base,
+								int32_t offset);
+
+// movsd dest, [label + addend]
+void x86_encode_movsd_reg_rip(ObjectFile *obj,
+							  enum Register dest,
+							  const char *label,
+							  int64_t addend);
+void x86_encode_movsd_reg_membase(ObjectFile *obj,
+								  enum Register dest,
+								  enum Register base,
+								  int32_t offset);
+void x86_encode_movsd_membase_reg(ObjectFile *obj,
+								  enum Register base,
+								  int32_t offset,
+								  enum Register src);
+void x86_encode_sse_reg_reg(ObjectFile *obj,
+							X86SseOp op,
+							enum Register dest,
+							enum Register src);
+void x86_encode_cvtsi2sd_reg_reg(ObjectFile *obj,
+								 enum Register dest,
+								 enum Register src);
+
+void x86_encode_alu_reg_reg(ObjectFile *obj,
+							X86AluOp op,
+							enum Register dest,
+							enum Register src);
+void x86_encode_alu_reg_imm(ObjectFile *obj,
+							X86AluOp op,
+							enum Register reg,
+							int32_t imm);
+// cmp reg, [base + offset]
+void x86_encode_cmp_reg_membase(ObjectFile *obj,
+								enum Register reg,
+								enum Register base,
+								int32_t offset);
+void x86_encode_imul_reg_reg(ObjectFile *obj,
+							 enum Register dest,
+							 enum Register src);
+void x86_encode_sar_reg_imm(ObjectFile *obj,
+							enum Register reg,
+							uint8_t imm);
+void x86_encode_test_reg_imm(ObjectFile *obj,
+							 enum Register reg,
+							 int32_t imm);
+
+void x86_encode_call_reg(ObjectFile *obj, enum Register target);
+void x86_encode_call_label(ObjectFile *obj, const char *label);
+void x86_encode_jmp_label(ObjectFile *obj, const char *label);
+void x86_encode_jcc_label(ObjectFile *obj,
+						  X86Condition cc,
+						  const char *label);
+// jmp [base + offset]
+void x86_encode_jmp_membase(ObjectFile *obj,
+							enum Register base,
+							int32_t offset);
+void x86_encode_ret(ObjectFile *obj);
+void x86_encode_syscall(ObjectFile *obj);
@@ -0,0 +1,522 @@
+#include "gc.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mark-sweep collector over a size-classed block heap. Small objects
+// are bump-allocated from per-class nursery blocks and recycled
+// through per-class free lists; large objects are malloc'd singly. A
+// conservative scan of the machine stack needs to tell heap payloads
+// from other words, which the block and large-object sets provide.
+
+#define GC_BLOCK_SIZE (64 * 1024)
+#define GC_INITIAL_THRESHOLD (1 << 20)
+#define GC_SET_INITIAL_CAPACITY 64
+
+typedef struct GcBlock
+{
+	struct GcBlock *next;
+	int size_class;
+	size_t slot_size;
+	char *slots; // header of the first slot
+	char *top;	 // end of the bump-allocated part, once retired
+	char *end;
+} GcBlock;
+
+typedef struct LargeObject
+{
+	struct LargeObject *next;
+	size_t size;
+	uint64_t _pad;
+	GcHeader header;
+} LargeObject;
+
+typedef struct
+{
+	void **slots;
+	size_t capacity;
+	size_t count;
+} PointerSet;
+
+GcNursery lisp_nursery[GC_NUM_SIZE_CLASSES];
+
+static struct
+{
+	bool initialized;
+	void *stack_base;
+	LispValue ***global_roots;
+	long num_global_roots;
+
+	GcBlock *blocks;
+	GcBlock *nursery_blocks[GC_NUM_SIZE_CLASSES];
+	void *free_lists[GC_NUM_SIZE_CLASSES];
+	LargeObject *large_objects;
+
+	PointerSet block_set;
+	PointerSet large_set;
+
+	size_t bytes_since_collect;
+	size_t threshold;
+
+	void **mark_stack;
+	size_t mark_stack_len;
+	size_t mark_stack_capacity;
+} gc = {.threshold = GC_INITIAL_THRESHOLD};
+
+static void gc_fatal(const char *message)
+{
+	printf("Runtime Error: %s\n", message);
+	exit(1);
+}
+
+static inline GcHeader *header_of(void *payload)
+{
+	return (GcHeader *)payload - 1;
+}
+
+static inline size_t hash_pointer(void *ptr, size_t capacity)
+{
+	uintptr_t x = (uintptr_t)ptr >> 3;
+	x ^= x >> 17;
+	x *= 0x9E3779B97F4A7C15ull;
+	return (x >> 7) & (capacity - 1);
+}
+
+static void pointer_set_insert_unchecked(PointerSet *set, void *ptr)
+{
+	size_t i = hash_pointer(ptr, set->capacity);
+	while (set->slots[i])
+	{
+		i = (i + 1) & (set->capacity - 1);
+	}
+	set->slots[i] = ptr;
+	set->count++;
+}
+
+static void pointer_set_reset(PointerSet *set, size_t capacity)
+{
+	if (capacity < GC_SET_INITIAL_CAPACITY)
+		capacity = GC_SET_INITIAL_CAPACITY;
+	free(set->slots);
+	set->slots = calloc(capacity, sizeof(void *));
+	if (!set->slots)
+		gc_fatal("Out of memory in collector");
+	set->capacity = capacity;
+	set->count = 0;
+}
+
+static void pointer_set_insert(PointerSet *set, void *ptr)
+{
+	if (!set->slots)
+	{
+		pointer_set_reset(set, GC_SET_INITIAL_CAPACITY);
+	}
+	if ((set->count + 1) * 2 > set->capacity)
+	{
+		void **old = set->slots;
+		size_t old_capacity = set->capacity;
+		set->slots = NULL;
+		pointer_set_reset(set, old_capacity * 2);
+		for (size_t i = 0; i < old_capacity; i++)
+		{
+			if (old[i])
+				pointer_set_insert_unchecked(set, old[i]);
+		}
+		free(old);
+	}
+	pointer_set_insert_unchecked(set, ptr);
+}
+
+static bool pointer_set_contains(PointerSet *set, void *ptr)
+{
+	if (!set->slots)
+		return false;
+	size_t i = hash_pointer(ptr, set->capacity);
+	while (set->slots[i])
+	{
+		if (set->slots[i] == ptr)
+			return true;
+		i = (i + 1) & (set->capacity - 1);
+	}
+	return false;
+}
+
+void lisp_gc_init(void *stack_base,
+				  LispValue ***global_roots,
+				  long num_global_roots)
+{
+	gc.stack_base = stack_base;
+	gc.global_roots = global_roots;
+	gc.num_global_roots = num_global_roots;
+	gc.initialized = true;
+}
+
+static inline char *block_top(GcBlock *block)
+{
+	if (gc.nursery_blocks[block->size_class] == block)
+	{
+		return lisp_nursery[block->size_class].ptr;
+	}
+	return block->top;
+}
+
+// Maps an arbitrary word to the header of the heap object whose
+// payload starts there, or NULL.
+static GcHeader *gc_find_object(void *word)
+{
+	if (!lisp_is_heap_object(word))
+		return NULL;
+
+	uintptr_t block_mask = ~(uintptr_t)(GC_BLOCK_SIZE - 1);
+	GcBlock *block = (GcBlock *)((uintptr_t)word & block_mask);
+	if (pointer_set_contains(&gc.block_set, block))
+	{
+		char *header = (char *)header_of(word);
+		if (header < block->slots || header >= block_top(block) ||
+			(size_t)(header - block->slots) % block->slot_size != 0)
+		{
+			return NULL;
+		}
+		GcHeader *found = (GcHeader *)header;
+		return found->kind == GC_KIND_FREE ? NULL : found;
+	}
+
+	if (pointer_set_contains(&gc.large_set, word))
+	{
+		return header_of(word);
+	}
+	return NULL;
+}
+
+static void mark_stack_push(void *payload)
+{
+	if (gc.mark_stack_len == gc.mark_stack_capacity)
+	{
+		size_t capacity =
+			gc.mark_stack_capacity ? gc.mark_stack_capacity * 2 : 256;
+		void **grown =
+			realloc(gc.mark_stack, capacity * sizeof(void *));
+		if (!grown)
+			gc_fatal("Out of memory in collector");
+		gc.mark_stack = grown;
+		gc.mark_stack_capacity = capacity;
+	}
+	gc.mark_stack[gc.mark_stack_len++] = payload;
+}
+
+// Accepts any word: tagged immediates, fixnums and pointers that are
+// not heap payloads are ignored.
+static void gc_mark_word(void *word)
+{
+	GcHeader *header = gc_find_object(word);
+	if (!header || header->marked)
+		return;
+	header->marked = 1;
+	mark_stack_push(word);
+}
+
+static void gc_trace(void *payload)
+{
+	switch (header_of(payload)->kind)
+	{
+	case GC_KIND_VALUE:
+	{
+		LispValue *val = payload;
+		if (val->type == LISP_CONS)
+		{
+			gc_mark_word(val->as.cons.car);
+			gc_mark_word(val->as.cons.cdr);
+		}
+		else if (val->type == LISP_CELL)
+		{
+			gc_mark_word(val->as.cell);
+		}
+		break;
+	}
+	case GC_KIND_CELL:
+		gc_mark_word(((LispCell *)payload)->value);
+		break;
+	case GC_KIND_CLOSURE:
+	{
+		LispClosureObject *closure = payload;
+		for (long i = 0; i < closure->num_free_vars; i++)
+		{
+			gc_mark_word(closure->free_vars[i]);
+		}
+		break;
+	}
+	case GC_KIND_FREE:
+		break;
+	}
+}
+
+static void gc_drain_mark_stack(void)
+{
+	while (gc.mark_stack_len > 0)
+	{
+		gc_trace(gc.mark_stack[--gc.mark_stack_len]);
+	}
+}
+
+static void __attribute__((noinline)) gc_mark_machine_stack(void)
+{
+	void *closure_register;
+	__asm__ volatile("mov %%r12, %0" : "=r"(closure_register));
+	gc_mark_word(closure_register);
+
+	// Spill the remaining callee-saved registers onto our frame so
+	// the scan below sees them.
+	jmp_buf registers;
+	setjmp(registers);
+
+	void **top = (void **)&registers;
+	void **bottom = (void **)gc.stack_base;
+	for (void **slot = top; slot <= bottom; slot++)
+	{
+		gc_mark_word(*slot);
+	}
+}
+
+static void gc_finalize(GcHeader *header)
+{
+	if (header->kind != GC_KIND_VALUE)
+		return;
+
+	LispValue *val = (LispValue *)(header + 1);
+	if (val->type == LISP_STRING || val->type == LISP_SYMBOL)
+	{
+		free(val->as.s_val);
+	}
+}
+
+// Returns the number of live bytes left in the block.
+static size_t gc_sweep_block_slots(GcBlock *block, bool rebuild_free)
+{
+	size_t live_bytes = 0;
+	char *top = block_top(block);
+	for (char *slot = block->slots; slot < top;
+		 slot += block->slot_size)
+	{
+		GcHeader *header = (GcHeader *)slot;
+		if (header->marked)
+		{
+			if (rebuild_free)
+				header->marked = 0;
+			live_bytes += block->slot_size;
+		}
+		else if (rebuild_free)
+		{
+			if (header->kind != GC_KIND_FREE)
+			{
+				gc_finalize(header);
+				header->kind = GC_KIND_FREE;
+			}
+			void **payload = (void **)(header + 1);
+			*payload = gc.free_lists[block->size_class];
+			gc.free_lists[block->size_class] = payload;
+		}
+	}
+	return live_bytes;
+}
+
+static void gc_release_block_objects(GcBlock *block)
+{
+	char *top = block_top(block);
+	for (char *slot = block->slots; slot < top;
+		 slot += block->slot_size)
+	{
+		GcHeader *header = (GcHeader *)slot;
+		if (header->kind != GC_KIND_FREE)
+			gc_finalize(header);
+	}
+}
+
+static size_t gc_sweep_blocks(void)
+{
+	size_t live_bytes = 0;
+	memset(gc.free_lists, 0, sizeof(gc.free_lists));
+	pointer_set_reset(&gc.block_set, gc.block_set.capacity);
+
+	GcBlock **link = &gc.blocks;
+	while (*link)
+	{
+		GcBlock *block = *link;
+		size_t block_live = gc_sweep_block_slots(block, false);
+		bool is_nursery =
+			gc.nursery_blocks[block->size_class] == block;
+
+		if (block_live == 0)
+		{
+			gc_release_block_objects(block);
+			if (is_nursery)
+			{
+				// Keep the block and rewind its bump pointer.
+				lisp_nursery[block->size_class].ptr = block->slots;
+			}
+			else
+			{
+				*link = block->next;
+				free(block);
+				continue;
+			}
+		}
+		else
+		{
+			live_bytes += gc_sweep_block_slots(block, true);
+		}
+
+		pointer_set_insert(&gc.block_set, block);
+		link = &block->next;
+	}
+	return live_bytes;
+}
+
+static size_t gc_sweep_large_objects(void)
+{
+	size_t live_bytes = 0;
+	pointer_set_reset(&gc.large_set, gc.large_set.capacity);
+
+	LargeObject **link = &gc.large_objects;
+	while (*link)
+	{
+		LargeObject *object = *link;
+		if (object->header.marked)
+		{
+			object->header.marked = 0;
+			live_bytes += object->size;
+			pointer_set_insert(&gc.large_set, &object->header + 1);
+			link = &object->next;
+		}
+		else
+		{
+			*link = object->next;
+			gc_finalize(&object->header);
+			free(object);
+		}
+	}
+	return live_bytes;
+}
+
+void lisp_gc_collect(void)
+{
+	if (!gc.initialized)
+		return;
+
+	for (long i = 0; i < gc.num_global_roots; i++)
+	{
+		gc_mark_word(*gc.global_roots[i]);
+	}
+	gc_mark_machine_stack();
+	gc_drain_mark_stack();
+
+	size_t live_bytes = gc_sweep_blocks() + gc_sweep_large_objects();
+	gc.bytes_since_collect = 0;
+	gc.threshold = live_bytes * 2 > GC_INITIAL_THRESHOLD
+					   ? live_bytes * 2
+					   : GC_INITIAL_THRESHOLD;
+}
+
+static void gc_maybe_collect(size_t upcoming_bytes)
+{
+	if (gc.bytes_since_collect + upcoming_bytes > gc.threshold)
+	{
+		lisp_gc_collect();
+	}
+	gc.bytes_since_collect += upcoming_bytes;
+}
+
+static void *gc_alloc_large(size_t size, GcObjectKind kind)
+{
+	size_t total_size = sizeof(LargeObject) + size;
+	gc_maybe_collect(total_size);
+
+	LargeObject *object = calloc(1, total_size);
+	if (!object)
+		gc_fatal("Out of memory");
+
+	object->size = total_size;
+	object->header.kind = kind;
+	object->header.size_class = GC_LARGE_SIZE_CLASS;
+	object->next = gc.large_objects;
+	gc.large_objects = object;
+
+	void *payload = &object->header + 1;
+	pointer_set_insert(&gc.large_set, payload);
+	return payload;
+}
+
+static void gc_new_nursery_block(int size_class)
+{
+	GcBlock *block = aligned_alloc(GC_BLOCK_SIZE, GC_BLOCK_SIZE);
+	if (!block)
+		gc_fatal("Out of memory");
+
+	block->size_class = size_class;
+	block->slot_size = gc_slot_size(size_class);
+	block->slots = (char *)block + sizeof(GcBlock);
+	block->end = (char *)block + GC_BLOCK_SIZE;
+	block->top = block->slots;
+	block->next = gc.blocks;
+	gc.blocks = block;
+	pointer_set_insert(&gc.block_set, block);
+
+	GcBlock *retired = gc.nursery_blocks[size_class];
+	if (retired)
+	{
+		retired->top = lisp_nursery[size_class].ptr;
+	}
+	gc.nursery_blocks[size_class] = block;
+	lisp_nursery[size_class].ptr = block->slots;
+	lisp_nursery[size_class].limit = block->end;
+}
+
+static void *gc_take_slot(int size_class)
+{
+	GcNursery *nursery = &lisp_nursery[size_class];
+	size_t slot_size = gc_slot_size(size_class);
+	if (nursery->ptr && nursery->ptr + slot_size <= nursery->limit)
+	{
+		GcHeader *header = (GcHeader *)nursery->ptr;
+		nursery->ptr += slot_size;
+		return header + 1;
+	}
+
+	void **free_slot = gc.free_lists[size_class];
+	if (free_slot)
+	{
+		gc.free_lists[size_class] = *free_slot;
+		return free_slot;
+	}
+	return NULL;
+}
+
+void *gc_alloc(size_t size, GcObjectKind kind)
+{
+	int size_class = gc_size_class(size);
+	if (size_class == GC_LARGE_SIZE_CLASS)
+	{
+		return gc_alloc_large(size, kind);
+	}
+
+	void *payload = gc_take_slot(size_class);
+	if (!payload)
+	{
+		gc_maybe_collect(GC_BLOCK_SIZE);
+		payload = gc_take_slot(size_class);
+	}
+	if (!payload)
+	{
+		gc_new_nursery_block(size_class);
+		payload = gc_take_slot(size_class);
+	}
+
+	size_t slot_payload = gc_slot_size(size_class) - sizeof(GcHeader);
+	memset(payload, 0, slot_payload);
+	GcHeader *header = header_of(payload);
+	header->kind = kind;
+	header->marked = 0;
+	header->size_class = size_class;
+	return payload;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "lispvalue.h"
+#include <stddef.h>
+
+// How the collector traces an object's outgoing references.
+typedef enum
+{
+	GC_KIND_FREE,	 // an unused slot on a free list
+	GC_KIND_VALUE,	 // a LispValue
+	GC_KIND_CELL,	 // a LispCell
+	GC_KIND_CLOSURE, // a LispClosureObject
+} GcObjectKind;
+
+// Every object payload is preceded by one 8-byte header word.
+typedef struct
+{
+	uint8_t kind;
+	uint8_t marked;
+	uint16_t size_class;
+	uint32_t _reserved;
+} GcHeader;
+
+/*
+ * Small objects live in size-classed blocks. Each class has a nursery
+ * (a bump pointer into its current block) and a free list of slots
+ * reclaimed by the last sweep. Class c holds payloads of up to
+ * (c + 1) * 8 bytes; anything larger is allocated on its own.
+ *
+ * The nursery table is read and bumped directly by generated code, so
+ * its layout and the header encoding are part of the codegen ABI.
+ */
+#define GC_NUM_SIZE_CLASSES 16
+#define GC_LARGE_SIZE_CLASS 0xFFFF
+#define GC_GRANULE 8
+
+typedef struct
+{
+	char *ptr;	 // header of the next slot to hand out
+	char *limit; // end of the current block
+} GcNursery;
+
+extern GcNursery lisp_nursery[GC_NUM_SIZE_CLASSES];
+
+static inline int gc_size_class(size_t payload_size)
+{
+	size_t granules = (payload_size + GC_GRANULE - 1) / GC_GRANULE;
+	if (granules == 0)
+		granules = 1;
+	return granules > GC_NUM_SIZE_CLASSES ? GC_LARGE_SIZE_CLASS
+										  : (int)granules - 1;
+}
+
+static inline size_t gc_slot_size(int size_class)
+{
+	return sizeof(GcHeader) + (size_class + 1) * GC_GRANULE;
+}
+
+static inline uint64_t gc_header_word(GcObjectKind kind,
+									  int size_class)
+{
+	return (uint64_t)kind | ((uint64_t)size_class << 16);
+}
+
+/**
+ * @brief Called once from the generated `main` before any allocation.
+ * @param stack_base The frame pointer of `main`; the machine stack is
+ * scanned conservatively from the collector's frame up to here.
+ * @param global_roots Addresses of every `global_var_*` slot emitted
+ * by codegen.
+ * @param num_global_roots Number of entries in global_roots.
+ */
+void lisp_gc_init(void *stack_base,
+				  LispValue ***global_roots,
+				  long num_global_roots);
+
+/**
+ * @brief Allocates a zeroed, collector-managed object. This is also
+ * the slow path of the inline nursery allocation in generated code.
+ * May run a collection first.
+ */
+void *gc_alloc(size_t size, GcObjectKind kind);
+
+void lisp_gc_collect(void);
@@ -52,4 +52,77 @@ typedef struct
 	long arity;
 	long num_free_vars;
 	LispValue *free_vars[];
-} LispClosureObject;
\ No newline at end of file
+} LispClosureObject;
+
+/*
+ * A LispValue * is a tagged machine word rather than always being a
+ * heap pointer:
+ *
+ *   ...xxxx1  fixnum, the integer lives in the upper 63 bits
+ *   ...xx000  pointer to a heap LispValue or LispClosureObject
+ *   ...xx010  immediate constant (nil, #f, #t)
+ *
+ * Integers that do not fit in a fixnum are boxed as a heap LISP_INT.
+ * The plain integer constants below are shared with codegen, which
+ * emits them directly as instruction immediates.
+ */
+#define LISP_FIXNUM_TAG 0x1
+#define LISP_FIXNUM_SHIFT 1
+#define LISP_IMMEDIATE_MASK 0x7
+#define LISP_IMMEDIATE_TAG 0x2
+
+#define LISP_IMM_NIL 0x02
+#define LISP_IMM_FALSE 0x0A
+#define LISP_IMM_TRUE 0x12
+
+#define LISP_FIXNUM_MAX (INT64_MAX >> LISP_FIXNUM_SHIFT)
+#define LISP_FIXNUM_MIN (INT64_MIN >> LISP_FIXNUM_SHIFT)
+
+static inline bool lisp_is_fixnum(const LispValue *val)
+{
+	return ((uintptr_t)val & LISP_FIXNUM_TAG) != 0;
+}
+
+static inline bool lisp_is_immediate(const LispValue *val)
+{
+	return ((uintptr_t)val & LISP_IMMEDIATE_MASK) ==
+		   LISP_IMMEDIATE_TAG;
+}
+
+static inline bool lisp_is_heap_object(const LispValue *val)
+{
+	return val && ((uintptr_t)val & LISP_IMMEDIATE_MASK) == 0;
+}
+
+static inline bool lisp_fixnum_fits(long value)
+{
+	return value >= LISP_FIXNUM_MIN && value <= LISP_FIXNUM_MAX;
+}
+
+static inline LispValue *lisp_make_fixnum(long value)
+{
+	return (LispValue *)(((uintptr_t)value << LISP_FIXNUM_SHIFT) |
+						 LISP_FIXNUM_TAG);
+}
+
+static inline long lisp_fixnum_value(const LispValue *val)
+{
+	return (intptr_t)val >> LISP_FIXNUM_SHIFT;
+}
+
+static inline LispValueType lisp_type_of(const LispValue *val)
+{
+	if (lisp_is_fixnum(val))
+		return LISP_INT;
+
+	switch ((uintptr_t)val)
+	{
+	case LISP_IMM_NIL:
+		return LISP_NIL;
+	case LISP_IMM_FALSE:
+	case LISP_IMM_TRUE:
+		return LISP_BOOL;
+	default:
+		return val->type;
+	}
+}
@@ -1,6 +1,9 @@
+#include "gc.h"
 #include "lispvalue.h"
+#include "runtime.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -20,8 +23,12 @@ static void runtime_assert(bool condition, const char *message)
 
 LispValue *lispvalue_create_int(long value)
 {
-	LispValue *lv = malloc(sizeof(LispValue));
-	runtime_assert(lv, "Out of memory");
+	if (lisp_fixnum_fits(value))
+	{
+		return lisp_make_fixnum(value);
+	}
+
+	LispValue *lv = gc_alloc(sizeof(LispValue), GC_KIND_VALUE);
 
 	lv->type = LISP_INT;
 	lv->as.i_val = value;
@@ -30,8 +37,7 @@ LispValue *lispvalue_create_int(long value)
 
 LispValue *lispvalue_create_float(double value)
 {
-	LispValue *lv = malloc(sizeof(LispValue));
-	runtime_assert(lv, "Out of memory");
+	LispValue *lv = gc_alloc(sizeof(LispValue), GC_KIND_VALUE);
 
 	lv->type = LISP_FLOAT;
 	lv->as.f_val = value;
@@ -40,26 +46,20 @@ LispValue *lispvalue_create_float(double value)
 
 LispValue *lispvalue_create_bool(long value)
 {
-	LispValue *lv = malloc(sizeof(LispValue));
-	runtime_assert(lv, "Out of memory");
-
-	lv->type = LISP_BOOL;
-	lv->as.b_val = (value != 0);
-	return lv;
+	return (LispValue *)(uintptr_t)(value ? LISP_IMM_TRUE
+										  : LISP_IMM_FALSE);
 }
 
 LispCell *lispcell_create(LispValue *initial_value)
 {
-	LispCell *cell = malloc(sizeof(LispCell));
-	assert(cell && "Out of memory");
+	LispCell *cell = gc_alloc(sizeof(LispCell), GC_KIND_CELL);
 	cell->value = initial_value;
 	return cell;
 }
 
 LispValue *lispvalue_create_cell(LispCell *cell)
 {
-	LispValue *lv = malloc(sizeof(LispValue));
-	runtime_assert(lv, "Out of memory");
+	LispValue *lv = gc_alloc(sizeof(LispValue), GC_KIND_VALUE);
 	lv->type = LISP_CELL;
 	lv->as.cell = cell;
 	return lv;
@@ -73,8 +73,7 @@ LispValue *lispvalue_create_closure(void (*code_ptr)(void),
 	size_t total_size = sizeof(LispClosureObject) +
 						(num_free_vars * sizeof(LispValue *));
 	LispClosureObject *closure_obj =
-		(LispClosureObject *)malloc(total_size);
-	runtime_assert(closure_obj, "Out of memory creating closure");
+		gc_alloc(total_size, GC_KIND_CLOSURE);
 
 	closure_obj->type = LISP_CLOSURE;
 	closure_obj->code_ptr = code_ptr;
@@ -103,59 +102,72 @@ LispValue *lispvalue_create_closure(void (*code_ptr)(void),
 	return (LispValue *)closure_obj;
 }
 
-void lispvalue_free(LispValue *val)
+// Called from a closure's checked entry when it is passed the wrong
+// number of arguments.
+void lisp_arity_error(LispClosureObject *closure, long num_args)
 {
-	if (!val)
-		return;
-	switch (val->type)
-	{
-	case LISP_CLOSURE:
-		break;
-	case LISP_STRING:
-	case LISP_SYMBOL:
-		free(val->as.s_val);
-		break;
-	default:
-		break;
-	}
-	free(val);
+	printf("Runtime Error: closure expects %ld arguments, got %ld\n",
+		   closure->arity, num_args);
+	exit(1);
 }
 
 long lisp_is_truthy(LispValue *val)
 {
-	if (!val || val->type == LISP_NIL)
+	uintptr_t word = (uintptr_t)val;
+	return !(word == 0 || word == LISP_IMM_NIL ||
+			 word == LISP_IMM_FALSE);
+}
+
+static long lisp_int_value(LispValue *val)
+{
+	if (lisp_is_fixnum(val))
 	{
-		return 0;
+		return lisp_fixnum_value(val);
 	}
+	return val->as.i_val;
+}
 
-	if (val->type == LISP_BOOL && val->as.b_val == false)
+static void lisp_print_value(LispValue *val);
+
+// Prints the elements of a list after its opening paren, with a
+// dotted tail if it does not end in nil.
+static void lisp_print_list(LispValue *val)
+{
+	printf("(");
+	lisp_print_value(val->as.cons.car);
+	LispValue *rest = val->as.cons.cdr;
+	while (lisp_type_of(rest) == LISP_CONS)
 	{
-		return 0;
+		printf(" ");
+		lisp_print_value(rest->as.cons.car);
+		rest = rest->as.cons.cdr;
 	}
-
-	return 1;
+	if (lisp_type_of(rest) != LISP_NIL)
+	{
+		printf(" . ");
+		lisp_print_value(rest);
+	}
+	printf(")");
 }
 
-void lisp_print(LispValue *val)
+static void lisp_print_value(LispValue *val)
 {
 	if (!val)
 	{
 		printf("NULL");
-		printf("\n");
-		fflush(stdout);
 		return;
 	}
 
-	switch (val->type)
+	switch (lisp_type_of(val))
 	{
 	case LISP_NIL:
 		printf("()");
 		break;
 	case LISP_BOOL:
-		printf(val->as.b_val ? "#t" : "#f");
+		printf(lisp_is_truthy(val) ? "#t" : "#f");
 		break;
 	case LISP_INT:
-		printf("%ld", val->as.i_val);
+		printf("%ld", lisp_int_value(val));
 		break;
 	case LISP_FLOAT:
 		printf("%f", val->as.f_val);
@@ -167,9 +179,7 @@ void lisp_print(LispValue *val)
 		printf("%s", val->as.s_val);
 		break;
 	case LISP_CONS:
-		printf("(");
-		lisp_print(val->as.cons.car);
-		printf(" ...)");
+		lisp_print_list(val);
 		break;
 	case LISP_CLOSURE:
 		LispClosureObject *closure_obj = (LispClosureObject *)val;
@@ -177,12 +187,15 @@ void lisp_print(LispValue *val)
 			   closure_obj->code_ptr, closure_obj->arity,
 			   closure_obj->num_free_vars);
 		break;
-		break;
 	default:
 		printf("#<unknown_type:%d>", val->type);
 		break;
 	}
+}
 
+void lisp_print(LispValue *val)
+{
+	lisp_print_value(val);
 	printf("\n");
 	fflush(stdout);
 }
@@ -191,11 +204,12 @@ static double get_numeric_value_as_double(LispValue *lv)
 {
 	runtime_assert(lv, "Unexpected NULL value in numeric operation.");
 
-	if (lv->type == LISP_INT)
+	LispValueType type = lisp_type_of(lv);
+	if (type == LISP_INT)
 	{
-		return (double)lv->as.i_val;
+		return (double)lisp_int_value(lv);
 	}
-	if (lv->type == LISP_FLOAT)
+	if (type == LISP_FLOAT)
 	{
 		return lv->as.f_val;
 	}
@@ -205,6 +219,13 @@ static double get_numeric_value_as_double(LispValue *lv)
 	return 0.0;
 }
 
+// Called by compiled float arithmetic for operands that are not
+// fixnums; raises the usual error for non-numbers.
+double lisp_unbox_double(LispValue *val)
+{
+	return get_numeric_value_as_double(val);
+}
+
 typedef long (*integer_op_func)(long a, long b);
 typedef double (*float_op_func)(double a, double b);
 
@@ -218,16 +239,24 @@ static LispValue *lisp_execute_numeric_op(LispValue *a,
 		runtime_error("NULL argument passed to numeric operation.");
 	}
 
-	if (a->type == LISP_FLOAT || b->type == LISP_FLOAT)
+	if (lisp_is_fixnum(a) && lisp_is_fixnum(b))
+	{
+		return lispvalue_create_int(
+			int_op(lisp_fixnum_value(a), lisp_fixnum_value(b)));
+	}
+
+	LispValueType type_a = lisp_type_of(a);
+	LispValueType type_b = lisp_type_of(b);
+	if (type_a == LISP_FLOAT || type_b == LISP_FLOAT)
 	{
 		double val_a = get_numeric_value_as_double(a);
 		double val_b = get_numeric_value_as_double(b);
 		return lispvalue_create_float(float_op(val_a, val_b));
 	}
-	else if (a->type == LISP_INT && b->type == LISP_INT)
+	else if (type_a == LISP_INT && type_b == LISP_INT)
 	{
-		long val_a = a->as.i_val;
-		long val_b = b->as.i_val;
+		long val_a = lisp_int_value(a);
+		long val_b = lisp_int_value(b);
 		return lispvalue_create_int(int_op(val_a, val_b));
 	}
 	else
@@ -238,52 +267,138 @@ static LispValue *lisp_execute_numeric_op(LispValue *a,
 	}
 }
 
-static long op_add_int(long a, long b) { return a + b; }
+// Results that do not fit in a long, which only boxed operands or a
+// product of fixnums can produce, are reported rather than wrapped.
+static long op_add_int(long a, long b)
+{
+	long result;
+	runtime_assert(!__builtin_add_overflow(a, b, &result),
+				   "Integer overflow.");
+	return result;
+}
 static double op_add_float(double a, double b) { return a + b; }
 LispValue *lisp_add(LispValue *a, LispValue *b)
 {
 	return lisp_execute_numeric_op(a, b, op_add_int, op_add_float);
 }
 
-static long op_sub_int(long a, long b) { return a - b; }
+static long op_sub_int(long a, long b)
+{
+	long result;
+	runtime_assert(!__builtin_sub_overflow(a, b, &result),
+				   "Integer overflow.");
+	return result;
+}
 static double op_sub_float(double a, double b) { return a - b; }
 LispValue *lisp_subtract(LispValue *a, LispValue *b)
 {
 	return lisp_execute_numeric_op(a, b, op_sub_int, op_sub_float);
 }
 
-static long op_mult_int(long a, long b) { return a * b; }
+static long op_mult_int(long a, long b)
+{
+	long result;
+	runtime_assert(!__builtin_mul_overflow(a, b, &result),
+				   "Integer overflow.");
+	return result;
+}
 static double op_mult_float(double a, double b) { return a * b; }
 LispValue *lisp_multiply(LispValue *a, LispValue *b)
 {
 	return lisp_execute_numeric_op(a, b, op_mult_int, op_mult_float);
 }
 
+static long op_div_int(long a, long b)
+{
+	runtime_assert(b != 0, "Division by zero.");
+	runtime_assert(a != LONG_MIN || b != -1, "Integer overflow.");
+	return a / b;
+}
+static double op_div_float(double a, double b) { return a / b; }
+LispValue *lisp_divide(LispValue *a, LispValue *b)
+{
+	return lisp_execute_numeric_op(a, b, op_div_int, op_div_float);
+}
+
+typedef bool (*integer_cmp_func)(long a, long b);
+typedef bool (*float_cmp_func)(double a, double b);
+
+// Integers compare exactly; a float on either side compares both as
+// doubles.
+static LispValue *lisp_execute_comparison(LispValue *a,
+										  LispValue *b,
+										  integer_cmp_func int_cmp,
+										  float_cmp_func float_cmp)
+{
+	runtime_assert(a && b, "NULL argument to comparison");
+
+	if (lisp_type_of(a) == LISP_INT && lisp_type_of(b) == LISP_INT)
+	{
+		return lispvalue_create_bool(
+			int_cmp(lisp_int_value(a), lisp_int_value(b)));
+	}
+	return lispvalue_create_bool(
+		float_cmp(get_numeric_value_as_double(a),
+				  get_numeric_value_as_double(b)));
+}
+
+static bool op_less_int(long a, long b) { return a < b; }
+static bool op_less_float(double a, double b) { return a < b; }
+LispValue *lisp_less(LispValue *a, LispValue *b)
+{
+	return lisp_execute_comparison(a, b, op_less_int, op_less_float);
+}
+
+static bool op_greater_int(long a, long b) { return a > b; }
+static bool op_greater_float(double a, double b) { return a > b; }
+LispValue *lisp_greater(LispValue *a, LispValue *b)
+{
+	return lisp_execute_comparison(a, b, op_greater_int,
+								   op_greater_float);
+}
+
+static bool op_less_equal_int(long a, long b) { return a <= b; }
+static bool op_less_equal_float(double a, double b) { return a <= b; }
+LispValue *lisp_less_equal(LispValue *a, LispValue *b)
+{
+	return lisp_execute_comparison(a, b, op_less_equal_int,
+								   op_less_equal_float);
+}
+
+static bool op_greater_equal_int(long a, long b) { return a >= b; }
+static bool op_greater_equal_float(double a, double b)
+{
+	return a >= b;
+}
+LispValue *lisp_greater_equal(LispValue *a, LispValue *b)
+{
+	return lisp_execute_comparison(a, b, op_greater_equal_int,
+								   op_greater_equal_float);
+}
+
 LispValue *lisp_equal(LispValue *a, LispValue *b)
 {
 	runtime_assert(a && b, "NULL argument to '='");
 
+	LispValueType type_a = lisp_type_of(a);
+	LispValueType type_b = lisp_type_of(b);
+
+	if (type_a == LISP_INT && type_b == LISP_INT)
+	{
+		return lispvalue_create_bool(lisp_int_value(a) ==
+									 lisp_int_value(b));
+	}
+
 	//  (= 1 1.0) should be true
-	if ((a->type == LISP_INT || a->type == LISP_FLOAT) &&
-		(b->type == LISP_INT || b->type == LISP_FLOAT))
+	if ((type_a == LISP_INT || type_a == LISP_FLOAT) &&
+		(type_b == LISP_INT || type_b == LISP_FLOAT))
 	{
 		double val_a = get_numeric_value_as_double(a);
 		double val_b = get_numeric_value_as_double(b);
 		return lispvalue_create_bool(val_a == val_b);
 	}
 
-	if (a->type != b->type)
-	{
-		return lispvalue_create_bool(false);
-	}
-
-	switch (a->type)
-	{
-	case LISP_BOOL:
-		return lispvalue_create_bool(a->as.b_val == b->as.b_val);
-	case LISP_NIL:
-		return lispvalue_create_bool(true); // nil == nil
-	default:
-		return lispvalue_create_bool(a == b);
-	}
+	// nil and the booleans are immediates and symbols are interned,
+	// so identity is equality
+	return lispvalue_create_bool(a == b);
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "lispvalue.h"
+
+/*
+ * The entry points generated code calls by name. Builtins take and
+ * return tagged values; a runtime error prints a message and exits.
+ */
+
+LispValue *lispvalue_create_int(long value);
+LispValue *lispvalue_create_float(double value);
+LispValue *lispvalue_create_bool(long value);
+LispCell *lispcell_create(LispValue *initial_value);
+LispValue *lispvalue_create_cell(LispCell *cell);
+
+/**
+ * @brief Allocates a closure over code_ptr. The num_free_vars
+ * variadic arguments are its free variables; a NULL stands for the
+ * closure itself.
+ */
+LispValue *lispvalue_create_closure(void (*code_ptr)(void),
+									int arity,
+									int num_free_vars,
+									...);
+
+/** @brief Reports a closure called with the wrong argument count. */
+void lisp_arity_error(LispClosureObject *closure, long num_args);
+
+long lisp_is_truthy(LispValue *val);
+void lisp_print(LispValue *val);
+
+/** @brief Converts a fixnum or float to a double, or fails. */
+double lisp_unbox_double(LispValue *val);
+
+LispValue *lisp_add(LispValue *a, LispValue *b);
+LispValue *lisp_subtract(LispValue *a, LispValue *b);
+LispValue *lisp_multiply(LispValue *a, LispValue *b);
+LispValue *lisp_divide(LispValue *a, LispValue *b);
+
+LispValue *lisp_less(LispValue *a, LispValue *b);
+LispValue *lisp_greater(LispValue *a, LispValue *b);
+LispValue *lisp_less_equal(LispValue *a, LispValue *b);
+LispValue *lisp_greater_equal(LispValue *a, LispValue *b);
+LispValue *lisp_equal(LispValue *a, LispValue *b);
@@ -0,0 +1,145 @@
+#include "symbol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Open-addressed table from name to symbol. Each entry keeps the
+// hash of its name, so a lookup compares strings only on a hash
+// match and growing never hashes a name again.
+
+#define SYMBOL_TABLE_INITIAL_CAPACITY 256
+
+typedef struct
+{
+	uint64_t hash;
+	LispValue *symbol; // NULL for an empty slot
+} SymbolEntry;
+
+static struct
+{
+	SymbolEntry *entries;
+	size_t capacity;
+	size_t count;
+} symbols;
+
+static void symbol_fatal(const char *message)
+{
+	printf("Runtime Error: %s\n", message);
+	exit(1);
+}
+
+// FNV-1a
+static uint64_t hash_name(const char *name)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const unsigned char *p = (const unsigned char *)name; *p;
+		 p++)
+	{
+		hash ^= *p;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// Returns the slot holding name, or the empty slot it would go in.
+static SymbolEntry *symbol_table_find(const char *name, uint64_t hash)
+{
+	size_t i = hash & (symbols.capacity - 1);
+	while (symbols.entries[i].symbol)
+	{
+		SymbolEntry *entry = &symbols.entries[i];
+		if (entry->hash == hash &&
+			strcmp(entry->symbol->as.s_val, name) == 0)
+		{
+			return entry;
+		}
+		i = (i + 1) & (symbols.capacity - 1);
+	}
+	return &symbols.entries[i];
+}
+
+static void symbol_table_reset(size_t capacity)
+{
+	symbols.entries = calloc(capacity, sizeof(SymbolEntry));
+	if (!symbols.entries)
+		symbol_fatal("Out of memory in symbol table");
+	symbols.capacity = capacity;
+	symbols.count = 0;
+}
+
+static void symbol_table_insert(SymbolEntry *slot,
+								uint64_t hash,
+								LispValue *symbol)
+{
+	slot->hash = hash;
+	slot->symbol = symbol;
+	symbols.count++;
+	if (symbols.count * 2 <= symbols.capacity)
+	{
+		return;
+	}
+
+	SymbolEntry *old = symbols.entries;
+	size_t old_capacity = symbols.capacity;
+	symbol_table_reset(old_capacity * 2);
+	for (size_t i = 0; i < old_capacity; i++)
+	{
+		if (!old[i].symbol)
+			continue;
+		size_t j = old[i].hash & (symbols.capacity - 1);
+		while (symbols.entries[j].symbol)
+		{
+			j = (j + 1) & (symbols.capacity - 1);
+		}
+		symbols.entries[j] = old[i];
+		symbols.count++;
+	}
+	free(old);
+}
+
+static void symbol_table_ensure(void)
+{
+	if (!symbols.entries)
+	{
+		symbol_table_reset(SYMBOL_TABLE_INITIAL_CAPACITY);
+	}
+}
+
+void lisp_symbols_init(LispValue **static_symbols, long num_symbols)
+{
+	symbol_table_ensure();
+	for (long i = 0; i < num_symbols; i++)
+	{
+		const char *name = static_symbols[i]->as.s_val;
+		uint64_t hash = hash_name(name);
+		SymbolEntry *slot = symbol_table_find(name, hash);
+		if (slot->symbol)
+		{
+			symbol_fatal("Duplicate static symbol");
+		}
+		symbol_table_insert(slot, hash, static_symbols[i]);
+	}
+}
+
+LispValue *lisp_intern(const char *name)
+{
+	symbol_table_ensure();
+	uint64_t hash = hash_name(name);
+	SymbolEntry *slot = symbol_table_find(name, hash);
+	if (slot->symbol)
+	{
+		return slot->symbol;
+	}
+
+	// Interned symbols are never freed, so they live outside the
+	// collected heap.
+	LispValue *symbol = malloc(sizeof(LispValue));
+	char *copy = strdup(name);
+	if (!symbol || !copy)
+		symbol_fatal("Out of memory in symbol table");
+	symbol->type = LISP_SYMBOL;
+	symbol->as.s_val = copy;
+	symbol_table_insert(slot, hash, symbol);
+	return symbol;
+}
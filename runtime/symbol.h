@@ -0,0 +1,26 @@
+#pragma once
+
+#include "lispvalue.h"
+
+/*
+ * Symbols are interned: there is exactly one LISP_SYMBOL object per
+ * name, so two symbols are equal exactly when they are the same
+ * pointer. Symbols that appear in the program are static objects
+ * emitted by codegen; any other name is allocated once, on first
+ * use, and lives for the rest of the run.
+ */
+
+/**
+ * @brief Called once from the generated `main` to seed the symbol
+ * table with the program's static symbols.
+ * @param symbols Every static LISP_SYMBOL object emitted by codegen,
+ * each with a distinct name.
+ * @param num_symbols Number of entries in symbols.
+ */
+void lisp_symbols_init(LispValue **symbols, long num_symbols);
+
+/**
+ * @brief Returns the symbol named name, creating it if no symbol of
+ * that name exists yet. The name is copied.
+ */
+LispValue *lisp_intern(const char *name);
@@ -0,0 +1,12 @@
+;; Calling a closure with the wrong number of arguments stops the
+;; program with an error and a nonzero exit status.
+
+(def (make-adder n) (lambda (x) (+ x n)))
+(def (call-with-two f) (f 1 2))
+(def add5 (make-adder 5))
+; Expected: 6
+(print-debug (add5 1))
+; Expected: Runtime Error: closure expects 1 arguments, got 2
+(print-debug (call-with-two add5))
+; Never reached
+(print-debug 0)
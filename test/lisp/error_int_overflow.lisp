@@ -0,0 +1,13 @@
+;; Integer arithmetic that does not fit in 64 bits is a runtime
+;; error rather than a wrapped result.
+
+(def (id x) x)
+
+; 2^62 - 1 is the largest fixnum
+(def max-fixnum (+ (* 1073741824 1073741824 2) (- (* 1073741824 1073741824 2) 1)))
+; Expected: 9223372036854775806
+(print-debug (* max-fixnum (id 2)))
+; Expected: Runtime Error: Integer overflow.
+(print-debug (* max-fixnum (id 4)))
+; Never reached
+(print-debug 0)
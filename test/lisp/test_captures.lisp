@@ -0,0 +1,39 @@
+;; Captured bindings are copied into the closure by value.
+
+(def (id x) x)
+
+; Captured through two levels of closures
+(def (make-adder3 a)
+  (lambda (b)
+    (lambda (c) (+ a b c))))
+; Expected: 6
+(print-debug (((make-adder3 1) 2) 3))
+
+; Captured floats and boxed ints stay reachable across collections
+(def (make-scaler k)
+  (lambda (x) (* k x)))
+(def scale (make-scaler 2.5))
+(def big (make-scaler (* (id 1073741824) 1073741824 4)))
+(def (churn n) (if (= n 0) 0 (churn (- (id (+ n 0.5)) 1.5))))
+(churn 20000)
+; Expected: 10.000000
+(print-debug (scale 4))
+; Expected: 4611686018427387904
+(print-debug (big 1))
+
+; Closures over the same binding see the same value
+(let ((v (id 41)))
+  (def get-a (lambda () (+ v 1)))
+  (def get-b (lambda () (- v 1))))
+; Expected: 42
+(print-debug (get-a))
+; Expected: 40
+(print-debug (get-b))
+
+; A let inside a lambda still sees bindings from outside both
+(def (make-offset base)
+  (lambda (x)
+    (let ((y (id x)))
+      (+ base y))))
+; Expected: 105
+(print-debug ((make-offset 100) 5))
@@ -0,0 +1,18 @@
+;; Closures are allocated inline from the nursery; ones too large for
+;; a size class go through the collector's allocator.
+
+(def (make-adder n) (lambda (x) (+ x n)))
+
+; Many short-lived closures force nursery refills and collections
+(def (sum-adders i acc)
+  (if (= i 0)
+      acc
+      (sum-adders (- i 1) ((make-adder i) acc))))
+; Expected: 50005000
+(print-debug (sum-adders 10000 0))
+
+; Sixteen free variables do not fit a small size class
+(def (make-big a b c d e f g h i j k l m n o p)
+  (lambda () (+ a b c d e f g h i j k l m n o p)))
+; Expected: 136
+(print-debug ((make-big 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16)))
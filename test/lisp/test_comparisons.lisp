@@ -0,0 +1,51 @@
+;; < > <= >= and / as builtins. Comparisons used as if conditions
+;; branch on the operands directly.
+
+(def (id x) x)
+
+(def (count-down n acc)
+  (if (<= n 0)
+      acc
+      (count-down (- n 1) (+ acc 1))))
+; Expected: 100000
+(print-debug (count-down 100000 0))
+
+(def (max a b) (if (> a b) a b))
+(def (min a b) (if (< a b) a b))
+; Expected: 7
+(print-debug (max 3 7))
+; Expected: -3
+(print-debug (min -3 (id 7)))
+
+; Comparisons as values
+; Expected: #t
+(print-debug (< (id 1) (id 2)))
+; Expected: #f
+(print-debug (>= (id 1) (id 2)))
+; Expected: #t
+(print-debug (= (id 5) (id 5)))
+
+; Floats and boxed integers take the runtime path
+; Expected: #t
+(print-debug (< (id 1.5) (id 2)))
+; Expected: #f
+(print-debug (> (id 1.5) (id 2.5)))
+(def big (* (id 1073741824) 1073741824 4))
+; Expected: #t
+(print-debug (> big (id 1)))
+; Expected: big
+(print-debug (if (>= big (id big)) 'big 'small))
+; Expected: float
+(print-debug (if (< (id 0.5) 1) 'float 'int))
+
+; Division truncates integers and is exact in floats
+; Expected: 3
+(print-debug (/ (id 7) 2))
+; Expected: -3
+(print-debug (/ (id -7) 2))
+; Expected: 3.500000
+(print-debug (/ (id 7) 2.0))
+; Expected: 5
+(print-debug (/ (id 100) 2 10))
+; Expected: 0.250000
+(print-debug (/ 1.0 (id 2) (id 2)))
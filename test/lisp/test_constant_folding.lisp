@@ -0,0 +1,23 @@
+;; Pure builtins over literals are folded at compile time, constant
+;; let bindings and once-defined globals are propagated, and if
+;; branches with a constant condition are dropped.
+
+; Expected: 12
+(print-debug (* 2 (- 10 4)))
+; Expected: 3.500000
+(print-debug (+ 1.5 2))
+
+(def width 8)
+(def (area h) (* width h))
+; Expected: 24
+(print-debug (area 3))
+
+; A propagated constant is no longer captured by the closure
+(def scaled
+  (let ((factor (+ 2 3)) (bias 1))
+    (lambda (n) (+ (* n factor) bias))))
+; Expected: 21
+(print-debug (scaled 4))
+
+; Expected: 7
+(print-debug (if (= width 8) 7 (area 100000)))
@@ -0,0 +1,38 @@
+;; + - * run inline when both operands are fixnums, and fall back to
+;; the runtime on boxed or float operands and on overflow.
+
+; Expected: 3
+(print-debug (+ 1 2))
+; Expected: -15
+(print-debug (- 10 25))
+; Expected: -42
+(print-debug (* -7 6))
+; Expected: 15
+(print-debug (+ 1 2 3 4 5))
+; Expected: 94
+(print-debug (- 100 1 2 3))
+; Expected: 720
+(print-debug (* 1 2 3 4 5 6))
+
+; Float operands take the slow path
+; Expected: 3.500000
+(print-debug (+ 1.5 2))
+; Expected: 7.500000
+(print-debug (* 3 2.5))
+
+; 2^62 - 1 is the largest fixnum
+(def max-fixnum (+ (* 1073741824 1073741824 2) (- (* 1073741824 1073741824 2) 1)))
+; Expected: 4611686018427387903
+(print-debug max-fixnum)
+
+; Overflowing add, sub and mul are boxed
+; Expected: 4611686018427387904
+(print-debug (+ max-fixnum 1))
+; Expected: -4611686018427387905
+(print-debug (- (- 0 max-fixnum) 2))
+; Expected: 9223372036854775806
+(print-debug (* max-fixnum 2))
+
+; Boxed results flow back through the fast-path check
+; Expected: 4611686018427387903
+(print-debug (- (+ max-fixnum 1) 1))
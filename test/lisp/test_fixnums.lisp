@@ -0,0 +1,25 @@
+;; Integers are tagged fixnums; results that leave the fixnum range
+;; are boxed on the heap instead of wrapping.
+
+(def (factorial n)
+  (if (= n 0)
+      1
+      (* n (factorial (- n 1)))))
+
+; Expected: 2432902008176640000
+(print-debug (factorial 20))
+
+; Still a fixnum
+; Expected: 4000000000000000000
+(print-debug (* 2000000000 2000000000))
+
+; Larger than the fixnum range, boxed
+; Expected: 8000000000000000000
+(def big (* 2000000000 2000000000 2))
+(print-debug big)
+
+; Boxed and fixnum operands mix freely
+; Expected: 7999999999999999999
+(print-debug (- big 1))
+; Expected: #t
+(print-debug (= big (+ (* 2000000000 2000000000) (* 2000000000 2000000000))))
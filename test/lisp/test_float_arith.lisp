@@ -0,0 +1,31 @@
+;; Arithmetic that involves a float is computed unboxed in XMM
+;; registers and boxed once at the end.
+
+(def (half x) (* x 0.5))
+(def (id x) x)
+
+; Expected: 2.500000
+(print-debug (half 5))
+; Expected: 4.000000
+(print-debug (+ 1.5 (id 2.5)))
+
+; Nested float trees keep intermediates unboxed
+; Expected: 11.000000
+(print-debug (* 2 (+ 0.5 (id 5))))
+; Expected: 1.250000
+(print-debug (- (half 5) (id 1) (* 0.25 (id 1))))
+
+; Boxed ints and floats from calls are unboxed by the runtime
+(def big (* (id 1073741824) 1073741824 4))
+; Expected: 4611686018427387904.000000
+(print-debug (+ 0.0 big))
+; Expected: 6.000000
+(print-debug (+ (half 2) (half 2) (half 2) (id 3)))
+
+; Only the first step promotes; an int-only head stays exact
+; Expected: 10.500000
+(print-debug (+ (id 3) (id 7) 0.5))
+
+(let ((x 1.5) (n (id 4)))
+  ; Expected: 7.500000
+  (print-debug (+ x (* n x))))
@@ -0,0 +1,37 @@
+;; Float literals are static objects in the data section, shared by
+;; every occurrence of the same value and never collected.
+
+(def (id x) x)
+
+(def (make-scaler)
+  (lambda (x) (* x 2.5)))
+
+(def (churn n acc)
+  (if (= n 0)
+      acc
+      (churn (- n 1) (+ acc ((make-scaler) (id 1))))))
+
+; Values keep every bit of their literal
+; Expected: 1.000000
+(print-debug (* (id 0.0000001) 10000000))
+; Expected: 0.000000
+(print-debug (- (+ 0.1 (id 0.2)) 0.3000000000000000444))
+
+; A literal returned as a value is the static object itself
+(def pi 3.25)
+; Expected: 3.250000
+(print-debug pi)
+; Expected: 3.250000
+(print-debug (id 3.25))
+
+; Static literals live through collections
+; Expected: 25000.000000
+(print-debug (churn 10000 0))
+; Expected: 3.250000
+(print-debug pi)
+
+; Negative zero is not folded into zero
+; Expected: -0.000000
+(print-debug -0.0)
+; Expected: 0.000000
+(print-debug 0.0)
@@ -0,0 +1,30 @@
+;; Allocation-heavy loops. Without the collector these retain every
+;; boxed float and closure they create.
+
+(def (make-adder x)
+  (lambda (y) (+ x y)))
+
+(def (float-loop n acc)
+  (if (= n 0)
+      acc
+      (float-loop (- n 1) (+ acc 0.5))))
+
+(def (closure-loop n acc)
+  (if (= n 0)
+      acc
+      (closure-loop (- n 1) ((make-adder 1) acc))))
+
+(def (outer k acc)
+  (if (= k 0)
+      acc
+      (outer (- k 1) (float-loop 5000 acc))))
+
+(def kept (make-adder 1000))
+
+; Expected: 100000.000000
+(print-debug (outer 40 0))
+; Expected: 5000
+(print-debug (closure-loop 5000 0))
+; Values reachable from globals survive collections
+; Expected: 1042
+(print-debug (kept 42))
@@ -15,4 +15,29 @@
 
 
 ; Expected to print 30
-(print-debug (if a (+ a b) (- a b)))
\ No newline at end of file
+(print-debug (if a (+ a b) (- a b)))
+; Truthiness of values only known at run time: only #f and the empty
+; list are false
+(def (id x) x)
+(def (truthy x) (if (id x) 'yes 'no))
+
+; Expected to print no
+(print-debug (truthy #f))
+
+; Expected to print no
+(print-debug (truthy '()))
+
+; Expected to print yes
+(print-debug (truthy 0))
+
+; Expected to print yes
+(print-debug (truthy 0.0))
+
+; Expected to print yes
+(print-debug (truthy #t))
+
+; Expected to print yes
+(print-debug (truthy 'nil))
+
+; Expected to print yes
+(print-debug (truthy truthy))
@@ -0,0 +1,36 @@
+;; Small global functions are inlined at their call sites.
+
+(def (id x) x)
+(def (add a b) (+ a b))
+(def (square x) (* x x))
+(def (sum-of-squares a b) (add (square a) (square b)))
+
+; Expected: 25
+(print-debug (sum-of-squares (id 3) 4))
+
+; Arguments that are calls are bound once and reused
+; Expected: 49
+(print-debug (square (add (id 3) 4)))
+
+; Recursive functions are still called
+(def (count-down n) (if (= n 0) 0 (count-down (- n 1))))
+; Expected: 0
+(print-debug (count-down (id 1000)))
+
+; A local that shadows a global the body reads blocks inlining
+(def base 100)
+(def (add-base x) (+ x base))
+(let ((base 1))
+  ; Expected: 105
+  (print-debug (add-base (id 5))))
+
+; An argument naming an earlier parameter of the callee still reads
+; the caller's variable
+(def (f a b) (+ a b))
+(def (g a) (f 1 a))
+; Expected: 11
+(print-debug (g 10))
+(def (h x y) (- x y))
+(def (k2 x) (h 1 x))
+; Expected: -9
+(print-debug (k2 10))
@@ -0,0 +1,32 @@
+;; Globals bound once to a function without free variables are
+;; called directly; everything else still goes through the closure.
+
+(def (square x) (* x x))
+(def (sum-squares a b) (+ (square a) (square b)))
+; Expected: 25
+(print-debug (sum-squares 3 4))
+
+; A known function is still a first-class closure value
+(def (twice f x) (f (f x)))
+; Expected: 81
+(print-debug (twice square 3))
+
+; A parameter shadowing a known function is called indirectly
+(def (call-with-square square) (square 6))
+; Expected: 7
+(print-debug (call-with-square (lambda (n) (+ n 1))))
+
+; A global defined twice is called through whatever it holds
+(def (greeting) 1)
+; Expected: 1
+(print-debug (greeting))
+(def (greeting) 2)
+; Expected: 2
+(print-debug (greeting))
+
+; Captures a free variable, so it is not a known function
+(def offset-by
+  (let ((delta 100))
+    (lambda (n) (+ n delta))))
+; Expected: 142
+(print-debug (offset-by 42))
@@ -0,0 +1,27 @@
+;; Let-bound lambdas that are only called become top-level functions
+;; that take their captured variables as extra arguments.
+
+(def (id x) x)
+
+; Expected: 16
+(def (add-twice x k)
+  (let ((add-k (lambda (v) (+ v k))))
+    (add-k (add-k (+ x k)))))
+(print-debug (add-twice 10 2))
+
+; Helpers inside helpers, with captures from both levels
+(def (poly x a b)
+  (let ((outer (lambda (y)
+                 (let ((inner (lambda (z) (+ (* a z) b y))))
+                   (inner y)))))
+    (outer x)))
+; Expected: 23
+(print-debug (poly 5 3 3))
+
+; A capture shadowed at the call site keeps the closure
+(def (shadowed k)
+  (let ((add-k (lambda (x) (+ x k))))
+    (let ((k (add-k k)))
+      (add-k k))))
+; Expected: 12
+(print-debug (shadowed (id 4)))
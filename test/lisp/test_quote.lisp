@@ -0,0 +1,41 @@
+;; Quoted data is laid out at compile time as static cons cells and
+;; symbols in a read-only section.
+
+(def (id x) x)
+
+; Expected: foo
+(print-debug 'foo)
+; Expected: 42
+(print-debug '42)
+; Expected: 1.500000
+(print-debug '1.5)
+; Expected: ()
+(print-debug '())
+; Expected: (1 2 3)
+(print-debug '(1 2 3))
+
+; Symbols are not looked up and lists are not calls
+; Expected: (let ((x 1)) (undefined-fn x #t #f))
+(print-debug (quote (let ((x 1)) (undefined-fn x #t #f))))
+; Expected: (a (quote b) 2.500000)
+(print-debug '(a 'b 2.5))
+
+; A quoted list is a value like any other
+(def table '((one 1) (two 2) (three 3)))
+; Expected: ((one 1) (two 2) (three 3))
+(print-debug (id table))
+
+; Quoting inside a loop builds nothing at run time
+(def (last-quoted n)
+  (if (= n 0)
+      '(done)
+      (last-quoted (- n 1))))
+; Expected: (done)
+(print-debug (last-quoted 100000))
+
+; Symbols are interned, so equal names are the same object
+(def (same? a b) (= a b))
+; Expected: #t
+(print-debug (same? 'foo (id 'foo)))
+; Expected: #f
+(print-debug (same? 'foo 'bar))
@@ -0,0 +1,39 @@
+;; let-bound locals live in callee-saved registers while they fit,
+;; and spill to the stack beyond that. Values must survive calls,
+;; closure capture and tail calls.
+
+; More bindings than local registers
+; Expected: 21
+(let ((a 1) (b 2) (c 3))
+  (let ((d 4) (e 5) (f 6))
+    (print-debug (+ a b c d e f))))
+
+; Locals survive calls into functions that use their own locals
+(def (inner x)
+  (let ((p (* x 2)) (q (* x 3)))
+    (+ p q)))
+(def (outer x)
+  (let ((m (+ x 1)) (n (+ x 2)))
+    (+ (inner m) (inner n) m n)))
+; Expected: 54
+(print-debug (outer 3))
+
+; Captured locals are copied into the closure
+(def (make-scaler k)
+  (let ((factor (* k 10)))
+    (lambda (v) (* v factor))))
+(def scale-by-30 (make-scaler 3))
+; Expected: 210
+(print-debug (scale-by-30 7))
+
+; Tail call from inside a let restores the caller's registers
+(def (loop-sum n acc)
+  (let ((next (- n 1)) (total (+ acc n)))
+    (if (= n 0)
+        acc
+        (loop-sum next total))))
+(let ((keep 99))
+  ; Expected: 5050
+  (print-debug (loop-sum 100 0))
+  ; Expected: 99
+  (print-debug keep))
@@ -0,0 +1,61 @@
+;; A let-bound lambda that is only ever called keeps its closure
+;; object in the enclosing frame. Lambda lifting turns most of these
+;; into top-level functions first; it leaves the ones whose captures
+;; are rebound, which are the cases that still get a frame closure.
+
+(def (id x) x)
+
+(def (sum-squares-offset n k)
+  (let ((sq (lambda (x) (+ (* x x) k))))
+    (+ (sq n) (sq (+ n 1)))))
+; Expected: 27
+(print-debug (sum-squares-offset 3 1))
+
+; Helpers built on every iteration of a loop
+(def (loop i acc)
+  (if (= i 0)
+      acc
+      (let ((step (lambda (x) (+ x i))))
+        (loop (- i 1) (step acc)))))
+; Expected: 5000050000
+(print-debug (loop 100000 0))
+
+; A call to the helper in tail position still sees its closure
+(def (apply-twice-offset x k)
+  (let ((add-k (lambda (v) (+ v k))))
+    (add-k (add-k x))))
+; Expected: 14
+(print-debug (apply-twice-offset (id 10) 2))
+
+; A capture rebound later in the same let
+(def (rebound-offset n k)
+  (let ((add-k (lambda (x) (+ x k)))
+        (k (* k 100)))
+    (+ (add-k n) k)))
+; Expected: 106
+(print-debug (rebound-offset 5 1))
+
+; A frame closure built on every iteration of a loop
+(def (shadow-loop i acc)
+  (if (= i 0)
+      acc
+      (let ((step (lambda (x) (+ x i))))
+        (let ((i (- i 1)))
+          (shadow-loop i (step acc))))))
+; Expected: 5000050000
+(print-debug (shadow-loop 100000 0))
+
+; A tail call to a frame closure must not reuse the frame it lives in
+(def (tail-shadowed x k)
+  (let ((add-k (lambda (v) (+ v k))))
+    (let ((k (* k 10)))
+      (add-k (+ x k)))))
+; Expected: 32
+(print-debug (tail-shadowed (id 10) 2))
+
+; Escaping helpers stay on the heap
+(def (make-helper k)
+  (let ((h (lambda (v) (* v k))))
+    h))
+; Expected: 21
+(print-debug ((make-helper 3) 7))
@@ -0,0 +1,30 @@
+;; Top-level functions without free variables are closure objects in
+;; the data section; their globals hold them from the start.
+
+(def (apply-to f x) (f x))
+(def (twice f x) (f (f x)))
+
+(def (inc x) (+ x 1))
+(def (square x) (* x x))
+
+; Passed around as values, the static closure is called through
+; its code pointer
+; Expected: 8
+(print-debug (apply-to inc 7))
+; Expected: 81
+(print-debug (twice square 3))
+
+; Kept in a local and chosen at run time
+(def (pick n) (if (= n 0) inc square))
+(let ((f (pick 1)) (g (pick 0)))
+  ; Expected: 36
+  (print-debug (f 6))
+  ; Expected: 7
+  (print-debug (g 6)))
+
+; A global bound to a computed function is stored when its def runs
+(def h (pick 1))
+; Expected: 25
+(print-debug (apply-to h 5))
+; Expected: 25
+(print-debug (h (apply-to inc 4)))
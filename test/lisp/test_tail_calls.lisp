@@ -0,0 +1,46 @@
+;; Calls in tail position reuse the caller's frame, so these loops
+;; would overflow the machine stack if each iteration pushed a frame.
+
+; Expected: 0
+(def (count-down n)
+  (if (= n 0)
+      0
+      (count-down (- n 1))))
+(print-debug (count-down 1000000))
+
+; Accumulator threaded through a let in tail position
+; Expected: 500000500000
+(def (sum-to n acc)
+  (let ((next (- n 1)))
+    (if (= n 0)
+        acc
+        (sum-to next (+ acc n)))))
+(print-debug (sum-to 1000000 0))
+
+; Mutual recursion
+; Expected: #t
+; Expected: #f
+(def (my-even n)
+  (if (= n 0)
+      #t
+      (my-odd (- n 1))))
+(def (my-odd n)
+  (if (= n 0)
+      #f
+      (my-even (- n 1))))
+(print-debug (my-even 1000000))
+(print-debug (my-even 777777))
+
+; A closure's free variables are still reachable after it makes a
+; non-tail call
+; Expected: 142
+(def (make-counter base)
+  (lambda (n) (+ (count-down n) (+ base (count-down n)))))
+(def counter (make-counter 142))
+(print-debug (counter 10))
+
+; Functions with stack-passed arguments still use ordinary calls
+; Expected: 55
+(def (sum-many a b c d e f g) (+ a b c d e f g))
+(def (tail-many x) (sum-many x 2 3 4 5 6 7))
+(print-debug (+ (tail-many 1) 27))
@@ -13,7 +13,8 @@ static void test_reg2string(void)
 		{REG_RSI, "rsi"}, {REG_RDI, "rdi"},	 {REG_R8, "r8"},
 		{REG_R9, "r9"},	  {REG_R10, "r10"},	 {REG_R11, "r11"},
 		{REG_R12, "r12"}, {REG_R13, "r13"},	 {REG_R14, "r14"},
-		{REG_R15, "r15"}, {REG_XMM0, "xmm0"}};
+		{REG_R15, "r15"}, {REG_XMM0, "xmm0"}, {REG_XMM1, "xmm1"},
+		{REG_XMM9, "xmm9"}, {REG_XMM15, "xmm15"}};
 
 	for (guint i = 0; i < G_N_ELEMENTS(test_cases); i++)
 	{
@@ -58,6 +59,7 @@ static void mock_file_cleanup(MockFile *file)
 static void assert_text_emitted(TestEmitterFixture *fixture,
 								const char *expected)
 {
+	asm_file_writer_flush(fixture->writer);
 	fflush(fixture->text.stream);
 
 	gchar *stripped_actual = g_strdup(fixture->text.buffer);
@@ -203,6 +205,11 @@ static void test_emit_mov_ops(TestEmitterFixture *fixture,
 	assert_text_emitted(fixture,
 						"mov [rbp + 8], rdi ; store arg 1 on stack");
 	assert_data_emitted(fixture, "");
+
+	emit_lea_reg_membase(fixture->writer, REG_RCX, REG_RAX, 24,
+						 "bump");
+	assert_text_emitted(fixture, "lea rcx, [rax + 24] ; bump");
+	assert_data_emitted(fixture, "");
 }
 
 static void test_emit_float_ops(TestEmitterFixture *fixture,
@@ -229,6 +236,31 @@ static void test_emit_float_ops(TestEmitterFixture *fixture,
 	assert_text_emitted(fixture,
 						"movsd [rsp + 0], xmm0 ; store float result");
 	assert_data_emitted(fixture, "");
+
+	emit_movsd_reg_membase(fixture->writer, REG_XMM1, REG_RSP, 8,
+						   NULL);
+	assert_text_emitted(fixture, "movsd xmm1, [rsp + 8]");
+	assert_data_emitted(fixture, "");
+
+	emit_addsd_reg_reg(fixture->writer, REG_XMM0, REG_XMM1, NULL);
+	assert_text_emitted(fixture, "addsd xmm0, xmm1");
+	assert_data_emitted(fixture, "");
+
+	emit_subsd_reg_reg(fixture->writer, REG_XMM2, REG_XMM3, "diff");
+	assert_text_emitted(fixture, "subsd xmm2, xmm3 ; diff");
+	assert_data_emitted(fixture, "");
+
+	emit_mulsd_reg_reg(fixture->writer, REG_XMM14, REG_XMM15, NULL);
+	assert_text_emitted(fixture, "mulsd xmm14, xmm15");
+	assert_data_emitted(fixture, "");
+
+	emit_divsd_reg_reg(fixture->writer, REG_XMM4, REG_XMM5, NULL);
+	assert_text_emitted(fixture, "divsd xmm4, xmm5");
+	assert_data_emitted(fixture, "");
+
+	emit_cvtsi2sd_reg_reg(fixture->writer, REG_XMM0, REG_RAX, NULL);
+	assert_text_emitted(fixture, "cvtsi2sd xmm0, rax");
+	assert_data_emitted(fixture, "");
 }
 
 static void test_emit_call_ops(TestEmitterFixture *fixture,
@@ -275,6 +307,72 @@ static void test_emit_control_flow_ops(TestEmitterFixture *fixture,
 	emit_je(fixture->writer, "L_ELSE_CLAUSE_1", NULL);
 	assert_text_emitted(fixture, "je L_ELSE_CLAUSE_1");
 	assert_data_emitted(fixture, "");
+
+	emit_jne(fixture->writer, "L_func_1_arity_error", NULL);
+	assert_text_emitted(fixture, "jne L_func_1_arity_error");
+	assert_data_emitted(fixture, "");
+
+	emit_ja(fixture->writer, "L_alloc_slow_1", NULL);
+	assert_text_emitted(fixture, "ja L_alloc_slow_1");
+	assert_data_emitted(fixture, "");
+
+	emit_jo(fixture->writer, "L_arith_slow_1", NULL);
+	assert_text_emitted(fixture, "jo L_arith_slow_1");
+	assert_data_emitted(fixture, "");
+
+	emit_jl(fixture->writer, "L_else_1", NULL);
+	assert_text_emitted(fixture, "jl L_else_1");
+	emit_jle(fixture->writer, "L_else_2", NULL);
+	assert_text_emitted(fixture, "jle L_else_2");
+	emit_jg(fixture->writer, "L_else_3", NULL);
+	assert_text_emitted(fixture, "jg L_else_3");
+	emit_jge(fixture->writer, "L_else_4", "not <");
+	assert_text_emitted(fixture, "jge L_else_4 ; not <");
+	assert_data_emitted(fixture, "");
+
+	emit_jmp_membase(fixture->writer, REG_R12, 8, "tail call");
+	assert_text_emitted(fixture, "jmp [r12 + 8] ; tail call");
+	assert_data_emitted(fixture, "");
+}
+
+static void test_emit_arith_ops(TestEmitterFixture *fixture,
+								gconstpointer user_data)
+{
+	emit_add_reg_reg(fixture->writer, REG_RAX, REG_RSI, NULL);
+	assert_text_emitted(fixture, "add rax, rsi");
+	assert_data_emitted(fixture, "");
+
+	emit_sub_reg_reg(fixture->writer, REG_RAX, REG_RSI, "diff");
+	assert_text_emitted(fixture, "sub rax, rsi ; diff");
+	assert_data_emitted(fixture, "");
+
+	emit_imul_reg_reg(fixture->writer, REG_RAX, REG_RCX, NULL);
+	assert_text_emitted(fixture, "imul rax, rcx");
+	assert_data_emitted(fixture, "");
+
+	emit_and_reg_reg(fixture->writer, REG_RAX, REG_RSI, NULL);
+	assert_text_emitted(fixture, "and rax, rsi");
+	assert_data_emitted(fixture, "");
+
+	emit_add_reg_imm(fixture->writer, REG_RSP, 8, NULL);
+	assert_text_emitted(fixture, "add rsp, 8");
+	assert_data_emitted(fixture, "");
+
+	emit_sub_reg_imm(fixture->writer, REG_RAX, 1, "drop tag");
+	assert_text_emitted(fixture, "sub rax, 1 ; drop tag");
+	assert_data_emitted(fixture, "");
+
+	emit_or_reg_imm(fixture->writer, REG_RAX, 1, NULL);
+	assert_text_emitted(fixture, "or rax, 1");
+	assert_data_emitted(fixture, "");
+
+	emit_sar_reg_imm(fixture->writer, REG_RAX, 1, NULL);
+	assert_text_emitted(fixture, "sar rax, 1");
+	assert_data_emitted(fixture, "");
+
+	emit_test_reg_imm(fixture->writer, REG_RAX, 1, "fixnum?");
+	assert_text_emitted(fixture, "test rax, 1 ; fixnum?");
+	assert_data_emitted(fixture, "");
 }
 
 static void test_emit_misc_ops(TestEmitterFixture *fixture,
@@ -293,6 +391,14 @@ static void test_emit_misc_ops(TestEmitterFixture *fixture,
 	assert_text_emitted(fixture, "cmp rax, 0 ; check if rax is zero");
 	assert_data_emitted(fixture, "");
 
+	emit_cmp_reg_reg(fixture->writer, REG_RDI, REG_RSI, NULL);
+	assert_text_emitted(fixture, "cmp rdi, rsi");
+	assert_data_emitted(fixture, "");
+
+	emit_cmp_reg_membase(fixture->writer, REG_RCX, REG_RDX, 8, NULL);
+	assert_text_emitted(fixture, "cmp rcx, [rdx + 8]");
+	assert_data_emitted(fixture, "");
+
 	emit_xor_reg_reg(fixture->writer, REG_RAX, REG_RAX,
 					 "zero out rax");
 	assert_text_emitted(fixture, "xor rax, rax ; zero out rax");
@@ -321,6 +427,26 @@ static void test_emit_comment_only(TestEmitterFixture *fixture,
 	assert_text_emitted(fixture, "; Processing item #5");
 	assert_data_emitted(fixture, "");
 }
+static void test_emit_nested_functions(TestEmitterFixture *fixture,
+									   gconstpointer user_data)
+{
+	asm_file_writer_begin_function(fixture->writer);
+	emit_label(fixture->writer, "outer", NULL);
+	emit_jmp(fixture->writer, "outer_end", NULL);
+
+	asm_file_writer_begin_function(fixture->writer);
+	emit_label(fixture->writer, "inner", NULL);
+	emit_ret(fixture->writer, NULL);
+	asm_file_writer_end_function(fixture->writer);
+
+	emit_label(fixture->writer, "outer_end", NULL);
+	asm_file_writer_end_function(fixture->writer);
+	// the inner function is written out first, whole
+	assert_text_emitted(fixture, "inner:\n\tret\nouter:\n"
+								 "\tjmp outer_end\nouter_end:");
+	assert_data_emitted(fixture, "");
+}
+
 static void test_emit_data_ops(TestEmitterFixture *fixture,
 							   gconstpointer user_data)
 {
@@ -354,6 +480,32 @@ static void test_emit_data_ops(TestEmitterFixture *fixture,
 	emit_data_string(fixture->writer, "L_empty_string", "", NULL);
 	assert_data_emitted(fixture, "L_empty_string: db 0");
 	assert_text_emitted(fixture, "");
+
+	const char *roots[] = {"global_var_a", "global_var_b"};
+	emit_data_dq_labels(fixture->writer, "gc_global_roots", roots, 2,
+						"%d roots", 2);
+	assert_data_emitted(
+		fixture,
+		"gc_global_roots: dq global_var_a, global_var_b ; 2 roots");
+	assert_text_emitted(fixture, "");
+
+	const int64_t object[] = {3, -1, 0};
+	emit_data_dq_imms(fixture->writer, "L_float_1", object, 3,
+					  "float %f", 1.5);
+	assert_data_emitted(fixture,
+						"L_float_1: dq 3, -1, 0 ; float 1.500000");
+	assert_text_emitted(fixture, "");
+
+	emit_data_align(fixture->writer, 8, NULL);
+	assert_data_emitted(fixture, "align 8");
+
+	emit_data_section(fixture->writer, ".rodata", NULL);
+	assert_data_emitted(fixture, "section .rodata");
+
+	emit_data_dq_labels(fixture->writer, "L_empty_table", NULL, 0,
+						NULL);
+	assert_data_emitted(fixture, "L_empty_table:");
+	assert_text_emitted(fixture, "");
 }
 
 int main(int argc, char **argv)
@@ -383,12 +535,18 @@ int main(int argc, char **argv)
 	g_test_add("/emitter/control_flow_ops", TestEmitterFixture, NULL,
 			   emitter_fixture_setup, test_emit_control_flow_ops,
 			   emitter_fixture_teardown);
+	g_test_add("/emitter/arith_ops", TestEmitterFixture, NULL,
+			   emitter_fixture_setup, test_emit_arith_ops,
+			   emitter_fixture_teardown);
 	g_test_add("/emitter/misc_ops", TestEmitterFixture, NULL,
 			   emitter_fixture_setup, test_emit_misc_ops,
 			   emitter_fixture_teardown);
 	g_test_add("/emitter/comment_only", TestEmitterFixture, NULL,
 			   emitter_fixture_setup, test_emit_comment_only,
 			   emitter_fixture_teardown);
+	g_test_add("/emitter/nested_functions", TestEmitterFixture, NULL,
+			   emitter_fixture_setup, test_emit_nested_functions,
+			   emitter_fixture_teardown);
 	g_test_add("/emitter/data_ops", TestEmitterFixture, NULL,
 			   emitter_fixture_setup, test_emit_data_ops,
 			   emitter_fixture_teardown);
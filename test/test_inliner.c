@@ -0,0 +1,190 @@
+#include <glib.h>
+
+#include "inliner.h"
+#include "optimizer.h"
+#include "parser.h"
+
+#define SETUP_TEST(source, budget, p_ctx, p_nodes)                   \
+	p_ctx = parser_create(source);                                   \
+	p_nodes = parser_parse(p_ctx);                                   \
+	parser_print_errors(p_ctx);                                      \
+	g_assert_cmpint(p_ctx->errors->len, ==, 0);                      \
+	inliner_run(p_nodes, budget)
+
+#define CLEANUP_TEST(p_ctx, p_nodes)                                 \
+	node_array_free(p_nodes);                                        \
+	parser_cleanup(p_ctx)
+
+static void test_inline_small_function(void)
+{
+	char *source_code = "(def (add a b) (+ a b)) (add 1 (add 2 3))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, INLINER_DEFAULT_BUDGET, parser,
+			   node_array);
+
+	Node *outer = node_array_index(node_array, 1);
+	g_assert_cmpint(outer->type, ==, NODE_LET);
+	g_assert_cmpint(outer->let.bindings->_array->len, ==, 2);
+	VarBinding *b = var_binding_array_index(outer->let.bindings, 1);
+	g_assert_cmpstr(b->name, ==, "b");
+	g_assert_cmpint(b->value_expr->type, ==, NODE_LET);
+
+	// Folding afterwards sees straight through the inlined calls.
+	optimizer_run(node_array);
+	Node *sum = node_array_index(node_array, 1);
+	g_assert_cmpint(sum->type, ==, NODE_LITERAL);
+	g_assert_cmpint(sum->literal.i_val, ==, 6);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_respect_budget(void)
+{
+	char *source_code = "(def (add a b) (+ a b)) (add 1 2)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, 2, parser, node_array);
+
+	Node *call = node_array_index(node_array, 1);
+	g_assert_cmpint(call->type, ==, NODE_CALL);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_recursion_stays_a_call(void)
+{
+	char *source_code = "(def (down n) (if (= n 0) 0 (down (- n 1))))"
+						"(down 3)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, INLINER_DEFAULT_BUDGET, parser,
+			   node_array);
+
+	// The body of down still calls itself.
+	Node *def_node = node_array_index(node_array, 0);
+	Node *fn = def_node->def.binding->value_expr;
+	Node *if_node = node_array_index(fn->function.body, 0);
+	Node *else_branch = if_node->if_expr.else_branch;
+	g_assert_cmpint(else_branch->type, ==, NODE_CALL);
+
+	// The top-level call is expanded once, and the copy calls down.
+	Node *let_node = node_array_index(node_array, 1);
+	g_assert_cmpint(let_node->type, ==, NODE_LET);
+	Node *copy = node_array_index(let_node->let.body, 0);
+	g_assert_cmpint(copy->if_expr.else_branch->type, ==, NODE_CALL);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_keep_call_when_global_is_shadowed(void)
+{
+	char *source_code = "(def g 10) (def (get-g) g)"
+						"(let ((g 1)) (get-g))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, INLINER_DEFAULT_BUDGET, parser,
+			   node_array);
+
+	Node *let_node = node_array_index(node_array, 2);
+	Node *call = node_array_index(let_node->let.body, 0);
+	g_assert_cmpint(call->type, ==, NODE_CALL);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static int count_nodes(Node *node);
+
+static int count_nodes_in(NodeArray *nodes)
+{
+	int count = 0;
+	for (guint i = 0; i < nodes->_array->len; i++)
+	{
+		count += count_nodes(node_array_index(nodes, i));
+	}
+	return count;
+}
+
+// Counts nodes the way the inliner's budget does.
+static int count_nodes(Node *node)
+{
+	if (!node)
+	{
+		return 0;
+	}
+	switch (node->type)
+	{
+	case NODE_CALL:
+		return 1 + count_nodes(node->call.fn) +
+			   count_nodes_in(node->call.args);
+	case NODE_IF:
+		return 1 + count_nodes(node->if_expr.condition) +
+			   count_nodes(node->if_expr.then_branch) +
+			   count_nodes(node->if_expr.else_branch);
+	case NODE_LET:
+	{
+		int count = 1 + count_nodes_in(node->let.body);
+		VarBindingArray *bindings = node->let.bindings;
+		for (guint i = 0; i < bindings->_array->len; i++)
+		{
+			count += count_nodes(
+				var_binding_array_index(bindings, i)->value_expr);
+		}
+		return count;
+	}
+	case NODE_FUNCTION:
+		return 1 + count_nodes_in(node->function.body);
+	case NODE_DEF:
+		return 1 + count_nodes(node->def.binding->value_expr);
+	default:
+		return 1;
+	}
+}
+
+static void test_call_chain_stays_within_budget(void)
+{
+	// Each function calls the one before it twice, so expanding
+	// every level into the next would double the code each time.
+	char *source_code = "(def (c0 x) (+ x 1))"
+						"(def (c1 x) (c0 (c0 x)))"
+						"(def (c2 x) (c1 (c1 x)))"
+						"(def (c3 x) (c2 (c2 x)))"
+						"(def (c4 x) (c3 (c3 x)))"
+						"(def (c5 x) (c4 (c4 x)))"
+						"(def (c6 x) (c5 (c5 x)))"
+						"(c6 1)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, INLINER_DEFAULT_BUDGET, parser,
+			   node_array);
+
+	// An expanded call is a let around at most a budget's worth of
+	// copied body, plus the argument.
+	Node *top = node_array_index(node_array, 7);
+	g_test_message("top-level call has %d nodes", count_nodes(top));
+	g_assert_cmpint(count_nodes(top), <=,
+					INLINER_DEFAULT_BUDGET + 2);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/inliner/small", test_inline_small_function);
+	g_test_add_func("/inliner/budget", test_respect_budget);
+	g_test_add_func("/inliner/recursion",
+					test_recursion_stays_a_call);
+	g_test_add_func("/inliner/shadowed_global",
+					test_keep_call_when_global_is_shadowed);
+	g_test_add_func("/inliner/call_chain",
+					test_call_chain_stays_within_budget);
+
+	return g_test_run();
+}
@@ -0,0 +1,108 @@
+#include "jit.h"
+#include "lispvalue.h"
+#include "object_file.h"
+#include "runtime_symbols.h"
+#include "x86_encoder.h"
+#include <glib.h>
+
+static void test_run_code_reading_data(void)
+{
+	ObjectFile *obj = object_file_create();
+	int64_t value = 42;
+	object_file_define(obj, OBJECT_SECTION_DATA, "value");
+	object_file_append(obj, OBJECT_SECTION_DATA, &value,
+					   sizeof(value));
+	object_file_define(obj, OBJECT_SECTION_TEXT, "answer");
+	x86_encode_mov_reg_rip(obj, REG_RAX, "value", 0);
+	x86_encode_ret(obj);
+	g_assert_true(object_file_resolve(obj));
+
+	JitImage *image = jit_load(obj);
+	object_file_free(obj);
+	g_assert_nonnull(image);
+
+	int64_t (*answer)(void) =
+		(int64_t (*)(void))jit_symbol_address(image, "answer");
+	g_assert_nonnull(answer);
+	g_assert_cmpint(answer(), ==, 42);
+	g_assert_null(jit_symbol_address(image, "missing"));
+
+	jit_free(image);
+}
+
+static void test_call_into_runtime(void)
+{
+	ObjectFile *obj = object_file_create();
+	object_file_declare_global(obj, "lisp_add");
+	object_file_define(obj, OBJECT_SECTION_TEXT, "add");
+	x86_encode_mov_reg_imm(obj, REG_RDI,
+						   (int64_t)lisp_make_fixnum(2));
+	x86_encode_mov_reg_imm(obj, REG_RSI,
+						   (int64_t)lisp_make_fixnum(3));
+	x86_encode_alu_reg_imm(obj, X86_ALU_SUB, REG_RSP, 8);
+	x86_encode_call_label(obj, "lisp_add");
+	x86_encode_alu_reg_imm(obj, X86_ALU_ADD, REG_RSP, 8);
+	x86_encode_ret(obj);
+	g_assert_true(object_file_resolve(obj));
+
+	JitImage *image = jit_load(obj);
+	object_file_free(obj);
+	g_assert_nonnull(image);
+
+	LispValue *(*add)(void) =
+		(LispValue *(*)(void))jit_symbol_address(image, "add");
+	LispValue *sum = add();
+	g_assert_true(lisp_is_fixnum(sum));
+	g_assert_cmpint(lisp_fixnum_value(sum), ==, 5);
+
+	jit_free(image);
+}
+
+static void test_reject_unknown_runtime_symbol(void)
+{
+	ObjectFile *obj = object_file_create();
+	object_file_declare_global(obj, "not_in_runtime");
+	x86_encode_call_label(obj, "not_in_runtime");
+	g_assert_true(object_file_resolve(obj));
+
+	g_assert_null(jit_load(obj));
+
+	object_file_free(obj);
+}
+
+static void test_every_runtime_symbol_loads(void)
+{
+	// Every extern that codegen emits comes from RUNTIME_SYMBOLS, so
+	// a program referring to all of them must load.
+	ObjectFile *obj = object_file_create();
+	object_file_define(obj, OBJECT_SECTION_TEXT, "refs");
+	for (size_t i = 0; i < NUM_RUNTIME_SYMBOLS; i++)
+	{
+		const char *name = RUNTIME_SYMBOLS[i].name;
+		g_assert_nonnull(runtime_symbol_address(name));
+		object_file_declare_global(obj, name);
+		x86_encode_mov_reg_address(obj, REG_RAX, name, 0);
+	}
+	x86_encode_ret(obj);
+	g_assert_true(object_file_resolve(obj));
+
+	JitImage *image = jit_load(obj);
+	object_file_free(obj);
+	g_assert_nonnull(image);
+	jit_free(image);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/jit/run_code_reading_data",
+					test_run_code_reading_data);
+	g_test_add_func("/jit/call_into_runtime", test_call_into_runtime);
+	g_test_add_func("/jit/unknown_runtime_symbol",
+					test_reject_unknown_runtime_symbol);
+	g_test_add_func("/jit/every_runtime_symbol_loads",
+					test_every_runtime_symbol_loads);
+
+	return g_test_run();
+}
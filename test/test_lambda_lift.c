@@ -0,0 +1,114 @@
+#include <glib.h>
+
+#include "lambda_lift.h"
+#include "parser.h"
+
+#define SETUP_TEST(source, p_ctx, p_nodes)                           \
+	p_ctx = parser_create(source);                                   \
+	p_nodes = parser_parse(p_ctx);                                   \
+	parser_print_errors(p_ctx);                                      \
+	g_assert_cmpint(p_ctx->errors->len, ==, 0);                      \
+	lambda_lift_run(p_nodes)
+
+#define CLEANUP_TEST(p_ctx, p_nodes)                                 \
+	node_array_free(p_nodes);                                        \
+	parser_cleanup(p_ctx)
+
+static void assert_variable(Node *node, const char *name)
+{
+	g_assert_cmpint(node->type, ==, NODE_VARIABLE);
+	g_assert_cmpstr(node->variable.name, ==, name);
+}
+
+static void test_lift_called_lambda(void)
+{
+	char *source_code = "(def (f k)"
+						"  (let ((add-k (lambda (x) (+ x k))))"
+						"    (add-k (add-k 1))))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	g_assert_cmpint(node_array->_array->len, ==, 2);
+	Node *lifted = node_array_index(node_array, 0);
+	g_assert_cmpint(lifted->type, ==, NODE_DEF);
+	g_assert_cmpstr(lifted->def.binding->name, ==, "add-k__lifted_0");
+
+	Node *fn = lifted->def.binding->value_expr;
+	g_assert_cmpint(fn->type, ==, NODE_FUNCTION);
+	g_assert_cmpint(fn->function.free_var_names->_array->len, ==, 0);
+	StringArray *params = fn->function.param_names;
+	g_assert_cmpint(params->_array->len, ==, 2);
+	g_assert_cmpstr(string_array_index(params, 0), ==, "k");
+	g_assert_cmpstr(string_array_index(params, 1), ==, "x");
+
+	// The let had nothing else to bind, so only its body is left.
+	Node *def_f = node_array_index(node_array, 1);
+	Node *f = def_f->def.binding->value_expr;
+	Node *outer = node_array_index(f->function.body, 0);
+	g_assert_cmpint(outer->type, ==, NODE_CALL);
+	assert_variable(outer->call.fn, "add-k__lifted_0");
+	g_assert_cmpint(outer->call.args->_array->len, ==, 2);
+	assert_variable(node_array_index(outer->call.args, 0), "k");
+
+	Node *inner = node_array_index(outer->call.args, 1);
+	g_assert_cmpint(inner->type, ==, NODE_CALL);
+	assert_variable(inner->call.fn, "add-k__lifted_0");
+	assert_variable(node_array_index(inner->call.args, 0), "k");
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_keep_escaping_lambda(void)
+{
+	char *source_code = "(def (f k)"
+						"  (let ((add-k (lambda (x) (+ x k))))"
+						"    add-k))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	g_assert_cmpint(node_array->_array->len, ==, 1);
+	Node *f = node_array_index(node_array, 0)->def.binding->value_expr;
+	Node *let_node = node_array_index(f->function.body, 0);
+	g_assert_cmpint(let_node->type, ==, NODE_LET);
+	g_assert_cmpint(let_node->let.bindings->_array->len, ==, 1);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_keep_lambda_with_shadowed_capture(void)
+{
+	// The call site sees a different k than the lambda captured.
+	char *source_code = "(def (f k)"
+						"  (let ((add-k (lambda (x) (+ x k))))"
+						"    (let ((k (add-k k)))"
+						"      (add-k k))))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	g_assert_cmpint(node_array->_array->len, ==, 1);
+	Node *f = node_array_index(node_array, 0)->def.binding->value_expr;
+	Node *let_node = node_array_index(f->function.body, 0);
+	g_assert_cmpint(let_node->type, ==, NODE_LET);
+	g_assert_cmpint(let_node->let.bindings->_array->len, ==, 1);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/lambda_lift/called", test_lift_called_lambda);
+	g_test_add_func("/lambda_lift/escaping",
+					test_keep_escaping_lambda);
+	g_test_add_func("/lambda_lift/shadowed_capture",
+					test_keep_lambda_with_shadowed_capture);
+
+	return g_test_run();
+}
@@ -0,0 +1,227 @@
+#include <glib.h>
+
+#include "optimizer.h"
+#include "parser.h"
+
+#define SETUP_TEST(source, p_ctx, p_nodes)                           \
+	p_ctx = parser_create(source);                                   \
+	p_nodes = parser_parse(p_ctx);                                   \
+	parser_print_errors(p_ctx);                                      \
+	optimizer_run(p_nodes)
+
+#define CLEANUP_TEST(p_ctx, p_nodes)                                 \
+	node_array_free(p_nodes);                                        \
+	parser_cleanup(p_ctx)
+
+static void assert_int_literal(Node *node, int expected)
+{
+	g_assert_nonnull(node);
+	g_assert_cmpint(node->type, ==, NODE_LITERAL);
+	g_assert_cmpint(node->literal.lit_type, ==, LIT_INT);
+	g_assert_cmpint(node->literal.i_val, ==, expected);
+}
+
+static void test_fold_arithmetic(void)
+{
+	char *source_code = "(+ 1 2 3) (* 2 (- 10 4)) (+ 1.5 2)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	g_assert_cmpint(node_array->_array->len, ==, 3);
+	assert_int_literal(node_array_index(node_array, 0), 6);
+	assert_int_literal(node_array_index(node_array, 1), 12);
+
+	Node *sum = node_array_index(node_array, 2);
+	g_assert_cmpint(sum->type, ==, NODE_LITERAL);
+	g_assert_cmpint(sum->literal.lit_type, ==, LIT_FLOAT);
+	g_assert_cmpfloat(sum->literal.f_val, ==, 3.5);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_fold_keeps_overflow_at_runtime(void)
+{
+	char *source_code = "(* 100000 100000)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	Node *product = node_array_index(node_array, 0);
+	g_assert_cmpint(product->type, ==, NODE_CALL);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_fold_equal(void)
+{
+	char *source_code = "(= 3 (+ 1 2)) (= 1 1.0) (= 1 2)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	for (guint i = 0; i < 3; i++)
+	{
+		Node *n = node_array_index(node_array, i);
+		g_assert_cmpint(n->type, ==, NODE_LITERAL);
+		g_assert_cmpint(n->literal.lit_type, ==, LIT_BOOL);
+		g_assert_true(n->literal.b_val == (i < 2));
+	}
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_fold_order(void)
+{
+	char *source_code = "(< 1 2) (>= 2.5 2) (<= 3 3) (> 1 (+ 1 1))"
+						"(< 2 1.5)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	bool expected[] = {true, true, true, false, false};
+	for (guint i = 0; i < G_N_ELEMENTS(expected); i++)
+	{
+		Node *n = node_array_index(node_array, i);
+		g_assert_cmpint(n->type, ==, NODE_LITERAL);
+		g_assert_cmpint(n->literal.lit_type, ==, LIT_BOOL);
+		g_assert_true(n->literal.b_val == expected[i]);
+	}
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_propagate_let_constant(void)
+{
+	char *source_code = "(def (f y) y)"
+						"(let ((x (+ 2 3)) (z (f 1)))"
+						"  (f (* x 2))"
+						"  (lambda (a) (+ a x z)))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	Node *let_node = node_array_index(node_array, 1);
+	g_assert_cmpint(let_node->type, ==, NODE_LET);
+	g_assert_cmpint(let_node->let.bindings->_array->len, ==, 1);
+	g_assert_cmpstr(
+		var_binding_array_index(let_node->let.bindings, 0)->name, ==,
+		"z");
+
+	Node *call = node_array_index(let_node->let.body, 0);
+	g_assert_cmpint(call->type, ==, NODE_CALL);
+	assert_int_literal(node_array_index(call->call.args, 0), 10);
+
+	Node *lambda = node_array_index(let_node->let.body, 1);
+	g_assert_cmpint(lambda->type, ==, NODE_FUNCTION);
+	StringArray *free_vars = lambda->function.free_var_names;
+	g_assert_cmpint(free_vars->_array->len, ==, 1);
+	g_assert_cmpstr(string_array_index(free_vars, 0), ==, "z");
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_propagate_respects_shadowing(void)
+{
+	char *source_code = "(let ((x 1))"
+						"  (lambda (x) (+ x 1)))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	// The let is gone, its only binding having been propagated.
+	Node *lambda = node_array_index(node_array, 0);
+	g_assert_cmpint(lambda->type, ==, NODE_FUNCTION);
+
+	Node *sum = node_array_index(lambda->function.body, 0);
+	g_assert_cmpint(sum->type, ==, NODE_CALL);
+	Node *arg = node_array_index(sum->call.args, 0);
+	g_assert_cmpint(arg->type, ==, NODE_VARIABLE);
+	g_assert_cmpstr(arg->variable.name, ==, "x");
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_propagate_global_constant(void)
+{
+	char *source_code = "(def limit 10)"
+						"(def other 1)"
+						"(+ limit other)"
+						"(def other 2)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	Node *sum = node_array_index(node_array, 2);
+	g_assert_cmpint(sum->type, ==, NODE_CALL);
+	assert_int_literal(node_array_index(sum->call.args, 0), 10);
+	Node *other = node_array_index(sum->call.args, 1);
+	g_assert_cmpint(other->type, ==, NODE_VARIABLE);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_propagate_float_constant(void)
+{
+	char *source_code = "(def scale 2.5)"
+						"(let ((r 1.5)) (* scale r))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	Node *product = node_array_index(node_array, 1);
+	g_assert_cmpint(product->type, ==, NODE_LITERAL);
+	g_assert_cmpint(product->literal.lit_type, ==, LIT_FLOAT);
+	g_assert_cmpfloat(product->literal.f_val, ==, 3.75);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_drop_dead_if_branch(void)
+{
+	char *source_code = "(if (= 1 1) 10 20)"
+						"(if #f 10 (+ 10 10))"
+						"(if #f 10)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	assert_int_literal(node_array_index(node_array, 0), 10);
+	assert_int_literal(node_array_index(node_array, 1), 20);
+	Node *no_else = node_array_index(node_array, 2);
+	g_assert_cmpint(no_else->type, ==, NODE_IF);
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/optimizer/fold/arithmetic",
+					test_fold_arithmetic);
+	g_test_add_func("/optimizer/fold/overflow",
+					test_fold_keeps_overflow_at_runtime);
+	g_test_add_func("/optimizer/fold/equal", test_fold_equal);
+	g_test_add_func("/optimizer/fold/order", test_fold_order);
+	g_test_add_func("/optimizer/propagate/let",
+					test_propagate_let_constant);
+	g_test_add_func("/optimizer/propagate/shadowing",
+					test_propagate_respects_shadowing);
+	g_test_add_func("/optimizer/propagate/global",
+					test_propagate_global_constant);
+	g_test_add_func("/optimizer/propagate/float",
+					test_propagate_float_constant);
+	g_test_add_func("/optimizer/dead_if", test_drop_dead_if_branch);
+
+	return g_test_run();
+}
@@ -338,6 +338,75 @@ static void test_closure_free_var_capture(void)
 	CLEANUP_TEST(parser, node_array);
 }
 
+static void test_closure_nested_free_var_capture(void)
+{
+	// x is used only by the inner lambda, so the outer one must
+	// capture it too in order to pass it on
+	char *source_code =
+		"(let ((x 10)) (lambda (y) (lambda (z) (+ x y z))))";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	g_assert_cmpint(parser->errors->len, ==, 0);
+
+	Node *let_node = node_array_index(node_array, 0);
+	Node *outer = node_array_index(let_node->let.body, 0);
+	g_assert_cmpint(outer->type, ==, NODE_FUNCTION);
+	StringArray *outer_free = outer->function.free_var_names;
+	g_assert_cmpint(outer_free->_array->len, ==, 1);
+	g_assert_cmpstr(string_array_index(outer_free, 0), ==, "x");
+
+	Node *inner = node_array_index(outer->function.body, 0);
+	g_assert_cmpint(inner->type, ==, NODE_FUNCTION);
+	StringArray *inner_free = inner->function.free_var_names;
+	g_assert_cmpint(inner_free->_array->len, ==, 2);
+	g_assert_cmpstr(string_array_index(inner_free, 0), ==, "x");
+	g_assert_cmpstr(string_array_index(inner_free, 1), ==, "y");
+
+	CLEANUP_TEST(parser, node_array);
+}
+
+static void test_quote_datum(void)
+{
+	char *source_code = "'(foo (1 #t) 'bar)";
+	ParserContext *parser;
+	NodeArray *node_array;
+
+	SETUP_TEST(source_code, parser, node_array);
+
+	g_assert_cmpint(parser->errors->len, ==, 0);
+	g_assert_cmpint(node_array->_array->len, ==, 1);
+
+	Node *list = node_array_index(node_array, 0);
+	g_assert_cmpint(list->type, ==, NODE_QUOTE);
+	g_assert_null(list->quote.quoted_expr);
+	g_assert_cmpint(list->quote.elements->_array->len, ==, 3);
+
+	// foo is read as a symbol, not looked up as a variable
+	Node *foo = node_array_index(list->quote.elements, 0);
+	g_assert_cmpint(foo->type, ==, NODE_QUOTE);
+	g_assert_cmpint(foo->quote.quoted_expr->literal.lit_type, ==,
+					LIT_SYMBOL);
+	g_assert_cmpstr(foo->quote.quoted_expr->literal.s_val, ==, "foo");
+
+	Node *inner = node_array_index(list->quote.elements, 1);
+	g_assert_cmpint(inner->quote.elements->_array->len, ==, 2);
+	Node *flag = node_array_index(inner->quote.elements, 1);
+	g_assert_cmpint(flag->quote.quoted_expr->literal.lit_type, ==,
+					LIT_BOOL);
+
+	// 'bar reads as (quote bar)
+	Node *quoted = node_array_index(list->quote.elements, 2);
+	g_assert_cmpint(quoted->quote.elements->_array->len, ==, 2);
+	Node *head = node_array_index(quoted->quote.elements, 0);
+	g_assert_cmpstr(head->quote.quoted_expr->literal.s_val, ==,
+					"quote");
+
+	CLEANUP_TEST(parser, node_array);
+}
+
 int main(int argc, char **argv)
 {
 	g_test_init(&argc, &argv, NULL);
@@ -352,11 +421,14 @@ int main(int argc, char **argv)
 					test_funcdef_with_params);
 	g_test_add_func("/parser/closure/free_var_capture",
 					test_closure_free_var_capture);
+	g_test_add_func("/parser/closure/nested_free_var_capture",
+					test_closure_nested_free_var_capture);
 	g_test_add_func("/parser/let", test_let_multiple_body_exprs);
 	g_test_add_func("/parser/def", test_def);
 	g_test_add_func("/parser/deffunc",
 					test_def_named_function_recursive);
 	g_test_add_func("/parser/if", test_ifexpr);
+	g_test_add_func("/parser/quote", test_quote_datum);
 
 	return g_test_run();
 }
\ No newline at end of file
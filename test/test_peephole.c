@@ -0,0 +1,136 @@
+#include "peephole.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static AsmOperand reg(enum Register r)
+{
+	return (AsmOperand){.kind = ASM_OPERAND_REG, .reg = r};
+}
+
+static AsmOperand imm(int64_t value)
+{
+	return (AsmOperand){.kind = ASM_OPERAND_IMM, .value = value};
+}
+
+static AsmOperand label(const char *name)
+{
+	return (AsmOperand){.kind = ASM_OPERAND_LABEL, .label = name};
+}
+
+static void append(GArray *code,
+				   AsmOpcode opcode,
+				   AsmOperand dest,
+				   AsmOperand src)
+{
+	AsmInstr instr = {.opcode = opcode, .dest = dest, .src = src};
+	g_array_append_val(code, instr);
+}
+
+static const AsmOperand NONE = {.kind = ASM_OPERAND_NONE};
+
+// Runs the pass and checks the listing that is left.
+static void assert_rewritten(GArray *code,
+							 const char *expected,
+							 long expected_hits)
+{
+	PeepholeStats stats = {0};
+	peephole_run(code, &stats);
+
+	char *buffer = NULL;
+	size_t size = 0;
+	FILE *out = open_memstream(&buffer, &size);
+	for (guint i = 0; i < code->len; i++)
+	{
+		asm_instr_print(&g_array_index(code, AsmInstr, i), out);
+	}
+	fclose(out);
+	g_assert_cmpstr(buffer, ==, expected);
+	free(buffer);
+
+	long hits = 0;
+	for (int i = 0; i < PEEPHOLE_PATTERN_COUNT; i++)
+	{
+		hits += stats.hits[i];
+	}
+	g_assert_cmpint(hits, ==, expected_hits);
+	g_array_free(code, TRUE);
+}
+
+static GArray *new_code(void)
+{
+	return g_array_new(FALSE, FALSE, sizeof(AsmInstr));
+}
+
+static void test_argument_through_stack(void)
+{
+	GArray *code = new_code();
+	append(code, ASM_MOV, reg(REG_RAX), imm(5));
+	append(code, ASM_PUSH, reg(REG_RAX), NONE);
+	append(code, ASM_POP, reg(REG_RDI), NONE);
+	append(code, ASM_CALL, label("f"), NONE);
+	append(code, ASM_RET, NONE, NONE);
+	assert_rewritten(code, "\tmov rdi, 5\n\tcall f\n\tret\n", 2);
+}
+
+static void test_jump_to_next(void)
+{
+	GArray *code = new_code();
+	append(code, ASM_JMP, label("done"), NONE);
+	append(code, ASM_LABEL, label("done"), NONE);
+	append(code, ASM_JMP, label("top"), NONE);
+	append(code, ASM_LABEL, label("done2"), NONE);
+	append(code, ASM_RET, NONE, NONE);
+	assert_rewritten(code, "done:\n\tjmp top\ndone2:\n\tret\n", 1);
+}
+
+static void test_dead_store(void)
+{
+	GArray *code = new_code();
+	append(code, ASM_MOV, reg(REG_RAX), imm(1));
+	append(code, ASM_MOV, reg(REG_RAX), imm(2));
+	append(code, ASM_RET, NONE, NONE);
+	assert_rewritten(code, "\tmov rax, 2\n\tret\n", 1);
+}
+
+static void test_keep_value_live_across_jump(void)
+{
+	GArray *code = new_code();
+	append(code, ASM_MOV, reg(REG_RAX), imm(1));
+	append(code, ASM_JMP, label("elsewhere"), NONE);
+	append(code, ASM_MOV, reg(REG_RAX), imm(2));
+	append(code, ASM_RET, NONE, NONE);
+	assert_rewritten(code,
+					 "\tmov rax, 1\n\tjmp elsewhere\n"
+					 "\tmov rax, 2\n\tret\n",
+					 0);
+}
+
+static void test_keep_value_read_by_call(void)
+{
+	GArray *code = new_code();
+	append(code, ASM_MOV, reg(REG_RDI), reg(REG_RAX));
+	append(code, ASM_CALL, label("f"), NONE);
+	append(code, ASM_MOV, reg(REG_RDI), imm(0));
+	append(code, ASM_RET, NONE, NONE);
+	assert_rewritten(code,
+					 "\tmov rdi, rax\n\tcall f\n"
+					 "\tmov rdi, 0\n\tret\n",
+					 0);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/peephole/argument_through_stack",
+					test_argument_through_stack);
+	g_test_add_func("/peephole/jump_to_next", test_jump_to_next);
+	g_test_add_func("/peephole/dead_store", test_dead_store);
+	g_test_add_func("/peephole/keep_value_live_across_jump",
+					test_keep_value_live_across_jump);
+	g_test_add_func("/peephole/keep_value_read_by_call",
+					test_keep_value_read_by_call);
+
+	return g_test_run();
+}
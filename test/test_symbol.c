@@ -0,0 +1,62 @@
+#include <glib.h>
+
+#include "symbol.h"
+
+static void test_intern_same_name(void)
+{
+	LispValue *a = lisp_intern("alpha");
+	LispValue *b = lisp_intern("alpha");
+	LispValue *c = lisp_intern("beta");
+
+	g_assert_true(a == b);
+	g_assert_true(a != c);
+	g_assert_cmpint(a->type, ==, LISP_SYMBOL);
+	g_assert_cmpstr(a->as.s_val, ==, "alpha");
+}
+
+static void test_intern_copies_name(void)
+{
+	char name[] = "gamma";
+	LispValue *a = lisp_intern(name);
+	name[0] = 'G';
+
+	g_assert_cmpstr(a->as.s_val, ==, "gamma");
+	g_assert_true(lisp_intern("gamma") == a);
+	g_assert_true(lisp_intern("Gamma") != a);
+}
+
+static void test_static_symbols_win(void)
+{
+	static LispValue static_delta = {.type = LISP_SYMBOL,
+									 .as.s_val = "delta"};
+	LispValue *table[] = {&static_delta};
+	lisp_symbols_init(table, 1);
+
+	g_assert_true(lisp_intern("delta") == &static_delta);
+}
+
+static void test_table_grows(void)
+{
+	LispValue *first = lisp_intern("sym0");
+	for (int i = 1; i < 2000; i++)
+	{
+		char name[16];
+		g_snprintf(name, sizeof(name), "sym%d", i);
+		lisp_intern(name);
+	}
+
+	g_assert_true(lisp_intern("sym0") == first);
+	g_assert_cmpstr(lisp_intern("sym1999")->as.s_val, ==, "sym1999");
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/symbol/same_name", test_intern_same_name);
+	g_test_add_func("/symbol/copies_name", test_intern_copies_name);
+	g_test_add_func("/symbol/static", test_static_symbols_win);
+	g_test_add_func("/symbol/grows", test_table_grows);
+
+	return g_test_run();
+}
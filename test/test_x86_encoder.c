@@ -0,0 +1,276 @@
+#include "object_file.h"
+#include "x86_encoder.h"
+#include <elf.h>
+#include <glib.h>
+
+// Compares the text section with the expected bytes, then empties it
+// for the next instruction.
+static void assert_text_bytes(ObjectFile *obj,
+							  const uint8_t *expected,
+							  size_t len)
+{
+	GByteArray *text = obj->sections[OBJECT_SECTION_TEXT];
+	g_assert_cmpmem(text->data, text->len, expected, len);
+	g_byte_array_set_size(text, 0);
+}
+
+#define ASSERT_ENCODED(obj, ...)                                     \
+	do                                                               \
+	{                                                                \
+		const uint8_t expected[] = {__VA_ARGS__};                    \
+		assert_text_bytes(obj, expected, sizeof(expected));          \
+	} while (0)
+
+static ObjectRelocation *reloc_at(ObjectFile *obj, guint i)
+{
+	return &g_array_index(obj->relocations, ObjectRelocation, i);
+}
+
+static void test_encode_moves(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	x86_encode_mov_reg_reg(obj, REG_RAX, REG_RCX);
+	ASSERT_ENCODED(obj, 0x48, 0x89, 0xC8);
+	x86_encode_mov_reg_reg(obj, REG_R10, REG_RBP);
+	ASSERT_ENCODED(obj, 0x49, 0x89, 0xEA);
+
+	x86_encode_mov_reg_membase(obj, REG_RAX, REG_RBP, -8);
+	ASSERT_ENCODED(obj, 0x48, 0x8B, 0x45, 0xF8);
+	x86_encode_mov_membase_reg(obj, REG_RSP, 16, REG_R12);
+	ASSERT_ENCODED(obj, 0x4C, 0x89, 0x64, 0x24, 0x10);
+	x86_encode_mov_reg_membase(obj, REG_RAX, REG_R12, 8);
+	ASSERT_ENCODED(obj, 0x49, 0x8B, 0x44, 0x24, 0x08);
+	// [r13] has no form without a displacement
+	x86_encode_mov_reg_membase(obj, REG_RAX, REG_R13, 0);
+	ASSERT_ENCODED(obj, 0x49, 0x8B, 0x45, 0x00);
+	x86_encode_mov_reg_membase(obj, REG_RDX, REG_RDX, 4096);
+	ASSERT_ENCODED(obj, 0x48, 0x8B, 0x92, 0x00, 0x10, 0x00, 0x00);
+	x86_encode_lea_reg_membase(obj, REG_RCX, REG_RAX, 24);
+	ASSERT_ENCODED(obj, 0x48, 0x8D, 0x48, 0x18);
+
+	x86_encode_mov_reg_imm(obj, REG_RAX, 60);
+	ASSERT_ENCODED(obj, 0xB8, 0x3C, 0x00, 0x00, 0x00);
+	x86_encode_mov_reg_imm(obj, REG_R9, 5);
+	ASSERT_ENCODED(obj, 0x41, 0xB9, 0x05, 0x00, 0x00, 0x00);
+	x86_encode_mov_reg_imm(obj, REG_RAX, -2);
+	ASSERT_ENCODED(obj, 0x48, 0xC7, 0xC0, 0xFE, 0xFF, 0xFF, 0xFF);
+	x86_encode_mov_reg_imm(obj, REG_RAX, 0x123456789);
+	ASSERT_ENCODED(obj, 0x48, 0xB8, 0x89, 0x67, 0x45, 0x23, 0x01,
+				   0x00, 0x00, 0x00);
+
+	object_file_free(obj);
+}
+
+static void test_encode_arithmetic(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	x86_encode_alu_reg_reg(obj, X86_ALU_ADD, REG_RAX, REG_RSI);
+	ASSERT_ENCODED(obj, 0x48, 0x01, 0xF0);
+	x86_encode_alu_reg_reg(obj, X86_ALU_SUB, REG_R8, REG_RAX);
+	ASSERT_ENCODED(obj, 0x49, 0x29, 0xC0);
+	x86_encode_alu_reg_reg(obj, X86_ALU_CMP, REG_RDI, REG_RSI);
+	ASSERT_ENCODED(obj, 0x48, 0x39, 0xF7);
+	x86_encode_alu_reg_reg(obj, X86_ALU_XOR, REG_RAX, REG_RAX);
+	ASSERT_ENCODED(obj, 0x48, 0x31, 0xC0);
+	x86_encode_alu_reg_reg(obj, X86_ALU_AND, REG_RAX, REG_RSI);
+	ASSERT_ENCODED(obj, 0x48, 0x21, 0xF0);
+	x86_encode_imul_reg_reg(obj, REG_RAX, REG_RCX);
+	ASSERT_ENCODED(obj, 0x48, 0x0F, 0xAF, 0xC1);
+
+	x86_encode_alu_reg_imm(obj, X86_ALU_ADD, REG_RSP, 8);
+	ASSERT_ENCODED(obj, 0x48, 0x83, 0xC4, 0x08);
+	x86_encode_alu_reg_imm(obj, X86_ALU_SUB, REG_RAX, 1000);
+	ASSERT_ENCODED(obj, 0x48, 0x81, 0xE8, 0xE8, 0x03, 0x00, 0x00);
+	x86_encode_alu_reg_imm(obj, X86_ALU_OR, REG_RAX, 1);
+	ASSERT_ENCODED(obj, 0x48, 0x83, 0xC8, 0x01);
+	x86_encode_alu_reg_imm(obj, X86_ALU_CMP, REG_R11, -8);
+	ASSERT_ENCODED(obj, 0x49, 0x83, 0xFB, 0xF8);
+	x86_encode_cmp_reg_membase(obj, REG_RCX, REG_RDX, 8);
+	ASSERT_ENCODED(obj, 0x48, 0x3B, 0x4A, 0x08);
+
+	x86_encode_sar_reg_imm(obj, REG_RAX, 1);
+	ASSERT_ENCODED(obj, 0x48, 0xD1, 0xF8);
+	x86_encode_sar_reg_imm(obj, REG_RAX, 3);
+	ASSERT_ENCODED(obj, 0x48, 0xC1, 0xF8, 0x03);
+	x86_encode_test_reg_imm(obj, REG_RAX, 1);
+	ASSERT_ENCODED(obj, 0x48, 0xF7, 0xC0, 0x01, 0x00, 0x00, 0x00);
+
+	object_file_free(obj);
+}
+
+static void test_encode_floats(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	x86_encode_movsd_reg_membase(obj, REG_XMM0, REG_RSP, 8);
+	ASSERT_ENCODED(obj, 0xF2, 0x0F, 0x10, 0x44, 0x24, 0x08);
+	x86_encode_movsd_membase_reg(obj, REG_RAX, 8, REG_XMM0);
+	ASSERT_ENCODED(obj, 0xF2, 0x0F, 0x11, 0x40, 0x08);
+	x86_encode_sse_reg_reg(obj, X86_SSE_ADD, REG_XMM0, REG_XMM1);
+	ASSERT_ENCODED(obj, 0xF2, 0x0F, 0x58, 0xC1);
+	x86_encode_sse_reg_reg(obj, X86_SSE_DIV, REG_XMM9, REG_XMM2);
+	ASSERT_ENCODED(obj, 0xF2, 0x44, 0x0F, 0x5E, 0xCA);
+	x86_encode_sse_reg_reg(obj, X86_SSE_MUL, REG_XMM1, REG_XMM10);
+	ASSERT_ENCODED(obj, 0xF2, 0x41, 0x0F, 0x59, 0xCA);
+	x86_encode_sse_reg_reg(obj, X86_SSE_SUB, REG_XMM3, REG_XMM4);
+	ASSERT_ENCODED(obj, 0xF2, 0x0F, 0x5C, 0xDC);
+	x86_encode_cvtsi2sd_reg_reg(obj, REG_XMM0, REG_RAX);
+	ASSERT_ENCODED(obj, 0xF2, 0x48, 0x0F, 0x2A, 0xC0);
+	x86_encode_cvtsi2sd_reg_reg(obj, REG_XMM1, REG_R9);
+	ASSERT_ENCODED(obj, 0xF2, 0x49, 0x0F, 0x2A, 0xC9);
+
+	object_file_free(obj);
+}
+
+static void test_encode_stack_and_control(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	x86_encode_push_reg(obj, REG_RBX);
+	ASSERT_ENCODED(obj, 0x53);
+	x86_encode_push_reg(obj, REG_R12);
+	ASSERT_ENCODED(obj, 0x41, 0x54);
+	x86_encode_pop_reg(obj, REG_R15);
+	ASSERT_ENCODED(obj, 0x41, 0x5F);
+	x86_encode_push_imm(obj, 42);
+	ASSERT_ENCODED(obj, 0x6A, 0x2A);
+	x86_encode_push_imm(obj, 1000);
+	ASSERT_ENCODED(obj, 0x68, 0xE8, 0x03, 0x00, 0x00);
+	x86_encode_push_membase(obj, REG_RBP, -8);
+	ASSERT_ENCODED(obj, 0xFF, 0x75, 0xF8);
+	x86_encode_push_membase(obj, REG_R12, 8);
+	ASSERT_ENCODED(obj, 0x41, 0xFF, 0x74, 0x24, 0x08);
+
+	x86_encode_call_reg(obj, REG_RAX);
+	ASSERT_ENCODED(obj, 0xFF, 0xD0);
+	x86_encode_call_reg(obj, REG_R11);
+	ASSERT_ENCODED(obj, 0x41, 0xFF, 0xD3);
+	x86_encode_jmp_membase(obj, REG_R12, 8);
+	ASSERT_ENCODED(obj, 0x41, 0xFF, 0x64, 0x24, 0x08);
+	x86_encode_ret(obj);
+	ASSERT_ENCODED(obj, 0xC3);
+	x86_encode_syscall(obj);
+	ASSERT_ENCODED(obj, 0x0F, 0x05);
+
+	object_file_free(obj);
+}
+
+static void test_resolve_local_branches(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	object_file_define(obj, OBJECT_SECTION_TEXT, "top");
+	x86_encode_jcc_label(obj, X86_CC_E, "bottom");
+	x86_encode_jmp_label(obj, "top");
+	object_file_define(obj, OBJECT_SECTION_TEXT, "bottom");
+	x86_encode_ret(obj);
+	g_assert_cmpint(obj->relocations->len, ==, 2);
+
+	g_assert_true(object_file_resolve(obj));
+	g_assert_cmpint(obj->relocations->len, ==, 0);
+	ASSERT_ENCODED(obj, 0x0F, 0x84, 0x05, 0x00, 0x00, 0x00, // je +5
+				   0xE9, 0xF5, 0xFF, 0xFF, 0xFF,			// jmp -11
+				   0xC3);
+
+	object_file_free(obj);
+}
+
+static void test_keep_external_relocations(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	object_file_declare_global(obj, "lisp_add");
+	x86_encode_call_label(obj, "lisp_add");
+	x86_encode_mov_reg_rip(obj, REG_RAX, "global_var_0", 0);
+	x86_encode_mov_reg_address(obj, REG_RDX, "L_float_1", 8);
+	object_file_define(obj, OBJECT_SECTION_DATA, "global_var_0");
+	object_file_append_reloc(obj, OBJECT_SECTION_DATA,
+							 OBJECT_RELOC_ABS64, "L_float_1", 0);
+	object_file_define(obj, OBJECT_SECTION_RODATA, "L_float_1");
+
+	g_assert_true(object_file_resolve(obj));
+	g_assert_cmpint(obj->relocations->len, ==, 4);
+
+	ObjectRelocation *call = reloc_at(obj, 0);
+	g_assert_cmpstr(call->symbol->name, ==, "lisp_add");
+	g_assert_cmpint(call->kind, ==, OBJECT_RELOC_PC32);
+	g_assert_cmpint(call->offset, ==, 1);
+	g_assert_cmpint(call->addend, ==, -4);
+
+	// mov rax, [rel global_var_0] is 48 8B 05 <disp32>
+	ObjectRelocation *load = reloc_at(obj, 1);
+	g_assert_cmpint(load->kind, ==, OBJECT_RELOC_PC32);
+	g_assert_cmpint(load->offset, ==, 5 + 3);
+
+	// mov rdx, imm64 is 48 BA <imm64>
+	ObjectRelocation *address = reloc_at(obj, 2);
+	g_assert_cmpint(address->kind, ==, OBJECT_RELOC_ABS64);
+	g_assert_cmpint(address->offset, ==, 5 + 7 + 2);
+	g_assert_cmpint(address->addend, ==, 8);
+
+	ObjectRelocation *pointer = reloc_at(obj, 3);
+	g_assert_cmpint(pointer->section, ==, OBJECT_SECTION_DATA);
+	g_assert_cmpint(pointer->kind, ==, OBJECT_RELOC_ABS64);
+
+	object_file_free(obj);
+}
+
+static void test_reject_undefined_symbol(void)
+{
+	ObjectFile *obj = object_file_create();
+
+	x86_encode_call_label(obj, "nowhere");
+	g_assert_false(object_file_resolve(obj));
+
+	object_file_free(obj);
+}
+
+static void test_write_elf_header(void)
+{
+	ObjectFile *obj = object_file_create();
+	object_file_declare_global(obj, "main");
+	object_file_define(obj, OBJECT_SECTION_TEXT, "main");
+	x86_encode_ret(obj);
+	g_assert_true(object_file_resolve(obj));
+
+	const char *filename = "test_x86_encoder.tmp.o";
+	g_assert_true(object_file_write_elf(obj, filename));
+
+	Elf64_Ehdr ehdr;
+	FILE *file = fopen(filename, "rb");
+	g_assert_nonnull(file);
+	g_assert_cmpint(fread(&ehdr, sizeof(ehdr), 1, file), ==, 1);
+	fclose(file);
+	remove(filename);
+
+	g_assert_cmpmem(ehdr.e_ident, SELFMAG, ELFMAG, SELFMAG);
+	g_assert_cmpint(ehdr.e_ident[EI_CLASS], ==, ELFCLASS64);
+	g_assert_cmpint(ehdr.e_type, ==, ET_REL);
+	g_assert_cmpint(ehdr.e_machine, ==, EM_X86_64);
+	g_assert_cmpint(ehdr.e_shentsize, ==, sizeof(Elf64_Shdr));
+
+	object_file_free(obj);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/x86_encoder/moves", test_encode_moves);
+	g_test_add_func("/x86_encoder/arithmetic",
+					test_encode_arithmetic);
+	g_test_add_func("/x86_encoder/floats", test_encode_floats);
+	g_test_add_func("/x86_encoder/stack_and_control",
+					test_encode_stack_and_control);
+	g_test_add_func("/x86_encoder/local_branches",
+					test_resolve_local_branches);
+	g_test_add_func("/x86_encoder/external_relocations",
+					test_keep_external_relocations);
+	g_test_add_func("/x86_encoder/undefined_symbol",
+					test_reject_undefined_symbol);
+	g_test_add_func("/x86_encoder/elf_header", test_write_elf_header);
+
+	return g_test_run();
+}